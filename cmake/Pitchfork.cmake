@@ -1,9 +1,26 @@
+# Pitchfork's CMake modules are fetched once for each PF_VERSION, and kept in a local cache. The
+# server lists the modules, and their SHA-256, in a manifest.txt beside them. Every module is
+# checked against it when it is fetched, and again whenever the cache is used: A cache whose
+# modules all match is used without a single download, so a configure only needs the server the
+# first time, or when a cached module was damaged.
+#
+# PF_URL_BASE, and each of PF_MIRRORS (which are tried first, in order), may be an http(s)://
+# or file:// URL, or the path of a local directory. For a local source, the cache is also
+# refreshed when its manifest changes.
 set(_pf_url http://localhost:8000/pf-cmake)
 if(DEFINED PF_URL_BASE)
     set(_pf_url "${PF_URL_BASE}")
 endif()
 set(PF_URL_BASE "${_pf_url}" CACHE STRING "Base URL to download Pitchfork files")
-set(_PF_BASEDIR "${CMAKE_BINARY_DIR}/_pf" CACHE PATH "Directory for Pitchfork files")
+set(PF_MIRRORS "" CACHE STRING "Base URLs to try for Pitchfork files before PF_URL_BASE")
+set(PF_MANIFEST_SHA256 "" CACHE STRING "If set, the SHA-256 that the Pitchfork manifest must have")
+
+# The cache may be shared between build directories
+set(_pf_basedir "${CMAKE_BINARY_DIR}/_pf")
+if(DEFINED ENV{PF_CACHE_DIR})
+    set(_pf_basedir "$ENV{PF_CACHE_DIR}")
+endif()
+set(_PF_BASEDIR "${_pf_basedir}" CACHE PATH "Directory for Pitchfork files")
 
 if(NOT DEFINED PF_VERSION)
     set(PF_VERSION 0.1.0)
@@ -11,21 +28,201 @@ endif()
 
 set(_PF_DIR "${_PF_BASEDIR}/${PF_VERSION}" CACHE INTERNAL "Directory for Pitchfork files")
 set(_PF_ENTRY_FILE "${_PF_DIR}/entry.cmake")
+set(_PF_MANIFEST_FILE "${_PF_DIR}/manifest.txt")
 set(PF_URL "${PF_URL_BASE}/${PF_VERSION}" CACHE STRING "URL for Pitchfork at requested version")
 
-if(NOT EXISTS "${_PF_ENTRY_FILE}" OR TRUE)
-    file(
-        DOWNLOAD "${PF_URL}/entry.cmake"
-        "${_PF_ENTRY_FILE}.tmp"
-        STATUS pair
-        )
+# Set `out` to the URL for `location`, which may be the path of a local directory
+function(_pf_resolve_url location out)
+    if(location MATCHES "^[a-zA-Z][a-zA-Z0-9+.-]*://")
+        set(url "${location}")
+    else()
+        get_filename_component(path "${location}" ABSOLUTE)
+        if(path MATCHES "^/")
+            set(url "file://${path}")
+        else()
+            # A Windows drive path
+            set(url "file:///${path}")
+        endif()
+    endif()
+    set("${out}" "${url}" PARENT_SCOPE)
+endfunction()
+
+# Set `out` to the local directory of a file:// URL, or to an empty string for any other URL
+function(_pf_local_dir url out)
+    set(path)
+    if(url MATCHES "^file://(.*)$")
+        set(path "${CMAKE_MATCH_1}")
+        if(path MATCHES "^/[a-zA-Z]:")
+            string(SUBSTRING "${path}" 1 -1 path)
+        endif()
+    endif()
+    set("${out}" "${path}" PARENT_SCOPE)
+endfunction()
+
+# Read a manifest, which has a line of `<sha256>  <file>` (as written by sha256sum) for each
+# module. Sets `<prefix>_FILES`, and `<prefix>_SHA256_<file>` for each of them, or `<prefix>_ERROR`
+# if the manifest is malformed.
+function(_pf_read_manifest manifest prefix)
+    set(files)
+    set(error)
+    file(STRINGS "${manifest}" lines)
+    foreach(line IN LISTS lines)
+        if(line MATCHES "^#" OR line STREQUAL "")
+            continue()
+        endif()
+        if(NOT line MATCHES "^([0-9a-fA-F]+) [ *]([a-zA-Z0-9_.-]+)$")
+            set(error "Invalid line in ${manifest}: ${line}")
+            break()
+        endif()
+        string(TOLOWER "${CMAKE_MATCH_1}" hash)
+        set(fname "${CMAKE_MATCH_2}")
+        string(LENGTH "${hash}" length)
+        # Modules are written into the cache by name, so they may not name any other directory
+        if(NOT length EQUAL 64 OR fname MATCHES "^\\.+$")
+            set(error "Invalid line in ${manifest}: ${line}")
+            break()
+        endif()
+        list(APPEND files "${fname}")
+        set("${prefix}_SHA256_${fname}" "${hash}" PARENT_SCOPE)
+    endforeach()
+    if(NOT error AND NOT "entry.cmake" IN_LIST files)
+        set(error "${manifest} does not list entry.cmake")
+    endif()
+    set("${prefix}_FILES" "${files}" PARENT_SCOPE)
+    set("${prefix}_ERROR" "${error}" PARENT_SCOPE)
+endfunction()
+
+# Set `out` to whether the cache holds every module of its manifest, unchanged
+function(_pf_cache_valid out)
+    set("${out}" FALSE PARENT_SCOPE)
+    if(NOT EXISTS "${_PF_MANIFEST_FILE}")
+        return()
+    endif()
+    if(PF_MANIFEST_SHA256)
+        file(SHA256 "${_PF_MANIFEST_FILE}" hash)
+        string(TOLOWER "${PF_MANIFEST_SHA256}" expected)
+        if(NOT hash STREQUAL expected)
+            return()
+        endif()
+    endif()
+    _pf_read_manifest("${_PF_MANIFEST_FILE}" cached)
+    if(cached_ERROR)
+        return()
+    endif()
+    foreach(fname IN LISTS cached_FILES)
+        if(NOT EXISTS "${_PF_DIR}/${fname}")
+            return()
+        endif()
+        file(SHA256 "${_PF_DIR}/${fname}" hash)
+        if(NOT hash STREQUAL cached_SHA256_${fname})
+            return()
+        endif()
+    endforeach()
+    set("${out}" TRUE PARENT_SCOPE)
+endfunction()
+
+# Set `out` to whether the first source that is a local directory has a manifest other than the
+# cached one. Reading it needs no network, and lets the cache follow a local copy as it changes.
+function(_pf_local_source_changed urls out)
+    set("${out}" FALSE PARENT_SCOPE)
+    foreach(url IN LISTS urls)
+        _pf_local_dir("${url}" dir)
+        if(dir AND EXISTS "${dir}/manifest.txt")
+            file(SHA256 "${dir}/manifest.txt" source_hash)
+            file(SHA256 "${_PF_MANIFEST_FILE}" cached_hash)
+            if(NOT source_hash STREQUAL cached_hash)
+                set("${out}" TRUE PARENT_SCOPE)
+            endif()
+            return()
+        endif()
+    endforeach()
+endfunction()
+
+# Download `url` to `dest`, checking that it has the SHA-256 `hash` if that is not empty. Sets
+# `out` to an empty string on success, or else to the error.
+function(_pf_fetch_file url dest hash out)
+    set(args)
+    if(hash)
+        set(args EXPECTED_HASH "SHA256=${hash}")
+    endif()
+    file(DOWNLOAD "${url}" "${dest}" STATUS pair ${args})
     list(GET pair 0 rc)
     list(GET pair 1 msg)
-    if(NOT rc EQUAL 0)
-        file(REMOVE "${_PF_ENTRY_FILE}")
-        message(FATAL_ERROR "Failed to download Pitchfork modules [${rc}]: ${msg}")
+    if(rc EQUAL 0)
+        set("${out}" "" PARENT_SCOPE)
+    else()
+        file(REMOVE "${dest}")
+        set("${out}" "${url} [${rc}]: ${msg}" PARENT_SCOPE)
+    endif()
+endfunction()
+
+# Fetch the manifest at `url`, and every module it lists, into the cache. Nothing is moved into
+# place until all of them have been verified, and the manifest is moved last, so the cache is
+# never left with a manifest whose modules are missing. Sets `out` to an empty string on success,
+# or else to the error.
+function(_pf_fetch_modules url out)
+    file(MAKE_DIRECTORY "${_PF_DIR}")
+    set(manifest_tmp "${_PF_MANIFEST_FILE}.tmp")
+    _pf_fetch_file("${url}/manifest.txt" "${manifest_tmp}" "${PF_MANIFEST_SHA256}" error)
+    if(NOT error)
+        _pf_read_manifest("${manifest_tmp}" fetched)
+        set(error "${fetched_ERROR}")
+    endif()
+    set(fetched)
+    if(NOT error)
+        foreach(fname IN LISTS fetched_FILES)
+            _pf_fetch_file("${url}/${fname}"
+                           "${_PF_DIR}/${fname}.tmp"
+                           "${fetched_SHA256_${fname}}"
+                           error)
+            if(error)
+                break()
+            endif()
+            list(APPEND fetched "${fname}")
+        endforeach()
+    endif()
+    if(error)
+        foreach(fname IN LISTS fetched)
+            file(REMOVE "${_PF_DIR}/${fname}.tmp")
+        endforeach()
+        file(REMOVE "${manifest_tmp}")
+    else()
+        foreach(fname IN LISTS fetched)
+            file(RENAME "${_PF_DIR}/${fname}.tmp" "${_PF_DIR}/${fname}")
+        endforeach()
+        file(RENAME "${manifest_tmp}" "${_PF_MANIFEST_FILE}")
+    endif()
+    set("${out}" "${error}" PARENT_SCOPE)
+endfunction()
+
+set(_pf_urls)
+foreach(_pf_location IN LISTS PF_MIRRORS)
+    _pf_resolve_url("${_pf_location}" _pf_location)
+    list(APPEND _pf_urls "${_pf_location}/${PF_VERSION}")
+endforeach()
+_pf_resolve_url("${PF_URL}" _pf_location)
+list(APPEND _pf_urls "${_pf_location}")
+
+_pf_cache_valid(_pf_valid)
+if(_pf_valid)
+    _pf_local_source_changed("${_pf_urls}" _pf_changed)
+    if(_pf_changed)
+        set(_pf_valid FALSE)
+    endif()
+endif()
+
+if(NOT _pf_valid)
+    set(_pf_errors)
+    foreach(_pf_location IN LISTS _pf_urls)
+        _pf_fetch_modules("${_pf_location}" _pf_error)
+        if(NOT _pf_error)
+            break()
+        endif()
+        string(APPEND _pf_errors "\n  ${_pf_error}")
+    endforeach()
+    if(_pf_error)
+        message(FATAL_ERROR "Failed to download Pitchfork modules:${_pf_errors}")
     endif()
-    file(RENAME "${_PF_ENTRY_FILE}.tmp" "${_PF_ENTRY_FILE}")
 endif()
 
 include("${_PF_ENTRY_FILE}")
@@ -147,33 +147,41 @@ function(_pf_auto)
     # Private inc dir is always the same:
     set(priv_inc_dir "${PROJECT_SOURCE_DIR}/src")
 
-    # Get our source files
-    file(GLOB_RECURSE
-        sources
-        RELATIVE "${PROJECT_SOURCE_DIR}/src"
-        CONFIGURE_DEPENDS
-        "${PROJECT_SOURCE_DIR}/src/*"
-        )
-    # Maintain three different source classifications
-    set(exe_sources)
-    set(lib_sources)
-    set(test_sources)
-    # Find them
-    foreach(file IN LISTS sources)
-        get_filename_component(fname "${file}" NAME)
-        if(fname STREQUAL file)
-            # File is not in subdirectory. It is an executable
-            list(APPEND exe_sources "src/${file}")
-        elseif(fname MATCHES "\\.test\\.[cC][a-zA-Z]+^")
-            list(APPEND test_sources "src/${file}")
-        else()
-            list(APPEND lib_sources "src/${file}")
+    # Get our source files. `pf update` lists them in cmake/pf_sources.cmake, already classified,
+    # which saves globbing the tree here and on every build after. Without it, we glob.
+    get_filename_component(manifest "${PROJECT_SOURCE_DIR}/cmake/pf_sources.cmake" ABSOLUTE)
+    if(EXISTS "${manifest}")
+        include("${manifest}")
+        set(exe_sources ${PF_EXE_SOURCES})
+        set(lib_sources ${PF_LIB_SOURCES})
+    else()
+        file(GLOB_RECURSE
+            sources
+            RELATIVE "${PROJECT_SOURCE_DIR}/src"
+            CONFIGURE_DEPENDS
+            "${PROJECT_SOURCE_DIR}/src/*"
+            )
+        # Maintain three different source classifications
+        set(exe_sources)
+        set(lib_sources)
+        set(test_sources)
+        # Find them
+        foreach(file IN LISTS sources)
+            get_filename_component(fname "${file}" NAME)
+            if(fname STREQUAL file)
+                # File is not in subdirectory. It is an executable
+                list(APPEND exe_sources "src/${file}")
+            elseif(fname MATCHES "\\.test\\.[cC][a-zA-Z]+^")
+                list(APPEND test_sources "src/${file}")
+            else()
+                list(APPEND lib_sources "src/${file}")
+            endif()
+        endforeach()
+        # Add all headers to the library sources
+        if(NOT pub_inc_dir STREQUAL priv_inc_dir)
+            file(GLOB_RECURSE includes "${pub_inc_dir}/*")
+            list(APPEND lib_sources ${includes})
         endif()
-    endforeach()
-    # Add all headers to the library sources
-    if(NOT pub_inc_dir STREQUAL priv_inc_dir)
-        file(GLOB_RECURSE includes "${pub_inc_dir}/*")
-        list(APPEND lib_sources ${includes})
     endif()
 
     # Pull in external before we check for link targets
@@ -24,8 +24,12 @@ function(_pf_download url dest)
     endif()
 endfunction()
 
+# Pitchfork.cmake has already fetched and verified the modules in manifest.txt. They are only
+# downloaded here for an older Pitchfork.cmake, which fetches nothing but this file.
 foreach(fname IN ITEMS auto.cmake)
     get_filename_component(_pf_dest "${_PF_DIR}/${fname}" ABSOLUTE)
-    _pf_download("${PF_URL}/${fname}" "${_pf_dest}")
+    if(NOT EXISTS "${_pf_dest}")
+        _pf_download("${PF_URL}/${fname}" "${_pf_dest}")
+    endif()
     include("${_pf_dest}")
 endforeach()
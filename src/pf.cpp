@@ -7,11 +7,16 @@
 #include <pf/fs.hpp>
 #include <pf/new.hpp>
 #include <pf/pitchfork.hpp>
+#include <pf/serve.hpp>
+#include <pf/util/trace.hpp>
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <functional>
 #include <iostream>
 #include <iterator>
+#include <optional>
 #include <unordered_map>
 
 namespace fs = pf::fs;
@@ -34,29 +39,23 @@ std::string get_input_line() {
     return ret;
 }
 
-fs::path default_base_dir() {
-    auto ptr = std::getenv("PF_BASE_DIR");
-    if (ptr) {
-        return ptr;
-    }
-
-    // Attempt to detect the base directory
-    return pf::detect_base_dir()
-        // Just use the cwd if cannot detect base dir
-        .value_or(fs::current_path());
-}
-
 struct cli_common {
     args::ArgumentParser&           parser;
     std::shared_ptr<spdlog::logger> console = spdlog::stdout_color_mt("console");
+    // Memoizes filesystem queries for the duration of the command
+    pf::stat_cache stats;
     // Flags that are not subcommand-specific:
     args::HelpFlag help{parser, "help", "Print this help message", {'h', "help"}};
+    args::Flag     verbose{parser, "verbose", "Print additional diagnostics", {'v', "verbose"}};
     // base-dir determines where projects will live
     path_flag base_dir_arg{parser,
                            "base_dir",
                            "The base directory for projects\n[env: PF_BASE_DIR]",
-                           {'B', "base-dir"},
-                           default_base_dir()};
+                           {'B', "base-dir"}};
+    path_flag trace_file{parser,
+                         "file",
+                         "Write a Chrome trace of where the time went to this file",
+                         {"trace"}};
 
     args::Group cmd_group{parser, "Available Commands"};
 
@@ -64,12 +63,35 @@ struct cli_common {
         : parser{args} {}
 
     fs::path get_base_dir() {
-        auto base_dir = base_dir_arg.Get();
-        if (!base_dir.empty()) {
-            return fs::absolute(base_dir);
+        if (!_base_dir) {
+            _base_dir = _find_base_dir();
+        }
+        return *_base_dir;
+    }
+
+private:
+    // Detecting the base directory can take many filesystem queries, so it is done on demand
+    std::optional<fs::path> _base_dir;
+
+    fs::path _find_base_dir() {
+        if (base_dir_arg) {
+            auto base_dir = base_dir_arg.Get();
+            if (!base_dir.empty()) {
+                return fs::absolute(base_dir);
+            }
+            // Just use the cwd if the base dir provided was empty
+            return fs::current_path();
         }
-        // Just use the cwd if the base dir provided was empty
-        return fs::current_path();
+
+        auto ptr = std::getenv("PF_BASE_DIR");
+        if (ptr) {
+            return *ptr ? fs::absolute(ptr) : fs::current_path();
+        }
+
+        // Attempt to detect the base directory
+        return pf::detect_base_dir(fs::current_path(), stats)
+            // Just use the cwd if cannot detect base dir
+            .value_or(fs::current_path());
     }
 };
 
@@ -94,7 +116,7 @@ public:
         }
 
         for (fs::path child : fs::directory_iterator{base_dir}) {
-            if (!fs::is_directory(child, ec)) {
+            if (!fs::is_directory(_cli.stats.status(child, ec))) {
                 if (ec) {
                     _cli.console->warn("Failed to enumerate item ({}): {}", child, ec.message());
                 }
@@ -237,6 +259,67 @@ private:
                                                                "The build system to generate",
                                                                {'b', "build-system"},
                                                                _bs_map};
+    path_flag _manifest{_cmd,
+                        "manifest",
+                        "Create every project listed in the given .json or .csv file",
+                        {"from-manifest"}};
+    args::ValueFlag<unsigned> _jobs{_cmd,
+                                    "jobs",
+                                    "Number of projects to create at once with --from-manifest "
+                                    "(0: one per CPU)",
+                                    {'j', "jobs"},
+                                    0};
+
+    int _run_manifest() {
+        using seconds = std::chrono::duration<double>;
+
+        auto const manifest = _manifest.Get();
+        auto const start    = std::chrono::steady_clock::now();
+
+        std::vector<pf::manifest_entry> entries;
+        try {
+            entries = pf::read_manifest(manifest, _cli.get_base_dir());
+        } catch (const std::exception& e) {
+            _cli.console->error("Failed to read manifest {}: {}", manifest.string(), e.what());
+            return 1;
+        }
+
+        std::size_t                     n_failed = 0;
+        std::vector<pf::manifest_entry> valid;
+        for (auto& entry : entries) {
+            if (entry.params) {
+                valid.push_back(std::move(entry));
+            } else {
+                ++n_failed;
+                _cli.console->error("Row {}: {}", entry.row, entry.error);
+            }
+        }
+
+        std::vector<pf::new_project_params> all;
+        all.reserve(valid.size());
+        for (auto const& entry : valid) {
+            all.push_back(*entry.params);
+        }
+        auto const errors = pf::create_projects(all, _jobs.Get());
+        for (auto i = 0u; i < errors.size(); ++i) {
+            if (!errors[i].empty()) {
+                ++n_failed;
+                _cli.console->error("Row {}: Failed to create project {}: {}",
+                                    valid[i].row,
+                                    all[i].name,
+                                    errors[i]);
+            }
+        }
+
+        auto const elapsed   = seconds{std::chrono::steady_clock::now() - start};
+        auto const n_created = entries.size() - n_failed;
+        _cli.console->info("Created {} of {} projects in {:.2f}s ({:.0f} projects/s)",
+                           n_created,
+                           entries.size(),
+                           elapsed.count(),
+                           n_created / elapsed.count());
+        return n_failed == 0 ? 0 : 1;
+    }
 
 public:
     explicit cmd_new(cli_common& gl)
@@ -245,6 +328,9 @@ public:
     explicit operator bool() const { return !!_cmd; }
 
     int run() {
+        if (_manifest) {
+            return _run_manifest();
+        }
 
         // Get the project name
         auto pr_name = get_string_value(_name, "Name for the new project");
@@ -303,6 +389,135 @@ public:
     }
 };
 
+class cmd_diff {
+private:
+    cli_common&    _cli;
+    args::Command  _cmd{_cli.cmd_group,
+                       "diff",
+                       "Compare existing projects with what `new` would generate for them"};
+    args::HelpFlag _help{_cmd, "help", "Print help for the `diff` subcommand", {'h', "help"}};
+    string_flag    _name{_cmd, "name", "Name of the project", {"name"}};
+    string_flag _namespace{_cmd, "namespace", "The root namespace of the project", {"namespace"}};
+    toggle_flag _split_headers{_cmd, "split-headers", "Headers are separate from source files"};
+    toggle_flag _gen_tests{_cmd, "tests", "The project has a tests/ directory"};
+    toggle_flag _gen_third_party{_cmd, "third-party", "The project has a third_party/ directory"};
+    toggle_flag _gen_examples{_cmd, "examples", "The project has an examples/ directory"};
+    toggle_flag _gen_extras{_cmd, "extras", "The project has an extras/ directory"};
+    string_flag _first_file_stem{_cmd,
+                                 "first-file",
+                                 "Stem of the first file in the root namespace (No extension)",
+                                 {"first-file"}};
+    string_flag _build_system{_cmd,
+                              "build-system",
+                              "The build system the project was generated with",
+                              {'b', "build-system"}};
+    path_flag   _manifest{_cmd,
+                        "manifest",
+                        "Compare every project listed in the given .json or .csv file",
+                        {"from-manifest"}};
+    args::ValueFlag<unsigned> _jobs{_cmd,
+                                    "jobs",
+                                    "Number of projects to compare at once (0: one per CPU)",
+                                    {'j', "jobs"},
+                                    0};
+
+    // Unlike `new`, nothing is prompted for: Anything not given takes the same default as in a
+    // manifest, so a single project is described as a single manifest row.
+    pf::manifest_entry _entry_from_flags() {
+        pf::manifest_fields fields;
+        std::pair<const char*, string_flag*> const values[] = {
+            {"name", &_name},
+            {"namespace", &_namespace},
+            {"first_file", &_first_file_stem},
+            {"build_system", &_build_system},
+        };
+        for (auto [key, flag] : values) {
+            if (*flag) {
+                fields.emplace_back(key, flag->Get());
+            }
+        }
+        std::pair<const char*, toggle_flag*> const toggles[] = {
+            {"split_headers", &_split_headers},
+            {"tests", &_gen_tests},
+            {"third_party", &_gen_third_party},
+            {"examples", &_gen_examples},
+            {"extras", &_gen_extras},
+        };
+        for (auto [key, flag] : toggles) {
+            if (flag->state() != toggle_flag::unset) {
+                fields.emplace_back(key, flag->state() == toggle_flag::enabled ? "true" : "false");
+            }
+        }
+        return pf::make_manifest_entry(1, fields, _cli.get_base_dir());
+    }
+
+public:
+    explicit cmd_diff(cli_common& gl)
+        : _cli{gl} {}
+
+    explicit operator bool() const { return !!_cmd; }
+
+    int run() {
+        using seconds = std::chrono::duration<double>;
+
+        if (!_manifest && !_name) {
+            _cli.console->error("Name the project to compare with --name, or pass --from-manifest");
+            return 1;
+        }
+        auto const start = std::chrono::steady_clock::now();
+
+        std::vector<pf::manifest_entry> entries;
+        if (_manifest) {
+            try {
+                entries = pf::read_manifest(_manifest.Get(), _cli.get_base_dir());
+            } catch (const std::exception& e) {
+                _cli.console->error("Failed to read manifest {}: {}",
+                                    _manifest.Get().string(),
+                                    e.what());
+                return 1;
+            }
+        } else {
+            entries.push_back(_entry_from_flags());
+        }
+
+        std::size_t                         n_failed = 0;
+        std::vector<pf::new_project_params> all;
+        for (auto const& entry : entries) {
+            if (entry.params) {
+                all.push_back(*entry.params);
+            } else {
+                ++n_failed;
+                _cli.console->error("Row {}: {}", entry.row, entry.error);
+            }
+        }
+
+        auto const  results    = pf::diff_projects(all, _jobs.Get());
+        std::size_t n_compared = 0;
+        std::size_t n_drifted  = 0;
+        for (auto i = 0u; i < results.size(); ++i) {
+            if (!results[i].error.empty()) {
+                ++n_failed;
+                _cli.console->error("Failed to compare project {}: {}",
+                                    all[i].name,
+                                    results[i].error);
+                continue;
+            }
+            ++n_compared;
+            if (results[i].diff) {
+                ++n_drifted;
+                std::cout << all[i].directory.string() << ":\n" << results[i].diff;
+            }
+        }
+
+        auto const elapsed = seconds{std::chrono::steady_clock::now() - start};
+        _cli.console->info("Compared {} projects in {:.2f}s: {} differ from their templates",
+                           n_compared,
+                           elapsed.count(),
+                           n_drifted);
+        return n_failed == 0 && n_drifted == 0 ? 0 : 1;
+    }
+};
+
 class cmd_update {
 private:
     cli_common&    _cli;
@@ -316,6 +531,131 @@ private:
                                                                "The build system to update",
                                                                {'b', "build-system"},
                                                                _bs_map};
+    args::ValueFlag<unsigned> _jobs{_cmd,
+                                    "jobs",
+                                    "Number of threads used to scan for sources (0: one per CPU)",
+                                    {'j', "jobs"},
+                                    0};
+    args::Flag _no_index{_cmd,
+                         "no-index",
+                         "Do not read or write the source index in .pf/index",
+                         {"no-index"}};
+    args::Flag _all{_cmd,
+                    "all",
+                    "Update every project below the base directory, --jobs at a time",
+                    {"all"}};
+    args::Flag _watch{_cmd,
+                      "watch",
+                      "Keep running, and update again whenever source files are added or removed",
+                      {"watch"}};
+    args::Flag _from_git_index{_cmd,
+                               "from-git-index",
+                               "Take the sources that git tracks from its index, without a walk",
+                               {"from-git-index"}};
+    args::Flag _untracked{_cmd,
+                          "untracked",
+                          "With --from-git-index, also walk for sources that git does not track",
+                          {"untracked"}};
+    args::ValueFlagList<std::string> _sources{_cmd,
+                                              "glob",
+                                              "Select (or with a leading !, leave out) sources "
+                                              "matching this glob, after those of pitchfork.json",
+                                              {"sources"}};
+
+    int _run_watch(fs::path const& project_dir, std::vector<std::string> const& extra_sources) {
+        // How long the tree must be quiet before we update, so bursts cause a single update
+        constexpr std::chrono::milliseconds settle{100};
+
+        // A project built with pf_auto() need not have a src/CMakeLists.txt
+        auto const            manifest = pf::source_manifest::wanted(project_dir);
+        std::vector<fs::path> roots;
+        if (!manifest || fs::exists(project_dir / "src" / "CMakeLists.txt")) {
+            roots.push_back(project_dir / "src");
+        }
+        if (fs::exists(project_dir / "tests")) {
+            roots.push_back(project_dir / "tests");
+        }
+        // The manifest lists every file below src/ and include/, so they are watched as well
+        auto watched = roots;
+        if (manifest) {
+            for (auto const& dir : {project_dir / "src", project_dir / "include"}) {
+                if (fs::is_directory(dir)
+                    && std::find(watched.begin(), watched.end(), dir) == watched.end()) {
+                    watched.push_back(dir);
+                }
+            }
+        }
+
+        try {
+            auto const patterns
+                = pf::source_patterns_for(pf::load_project_config(project_dir), extra_sources);
+            pf::source_watcher watcher{watched, manifest ? pf::source_patterns{{"*"}} : patterns};
+            _cli.console->info("Watching {} directories for changes. Press Ctrl+C to stop.",
+                               watcher.watch_count());
+            auto const update = [&](fs::path const& root) {
+                auto const sources
+                    = manifest ? watcher.sources(root, patterns) : watcher.sources(root);
+                return pf::update_source_files(root / "CMakeLists.txt", sources);
+            };
+            // Catch anything that changed after the initial update, but before we were watching
+            for (auto const& root : roots) {
+                update(root);
+            }
+            pf::update_source_manifest(project_dir);
+            while (true) {
+                auto const changed = watcher.wait_for_changes(settle);
+                for (auto const& root : changed) {
+                    if (std::find(roots.begin(), roots.end(), root) != roots.end()) {
+                        update(root);
+                        _cli.console->info("Sources changed, updated {}",
+                                           (root / "CMakeLists.txt").string());
+                    }
+                }
+                if (manifest && !changed.empty() && pf::update_source_manifest(project_dir)) {
+                    _cli.console->info("Sources changed, updated {}",
+                                       pf::source_manifest::path(project_dir).string());
+                }
+            }
+        } catch (const std::runtime_error& e) {
+            _cli.console->error("Failed to watch project in {}: {}", project_dir, e.what());
+            return 1;
+        }
+    }
+
+    int _run_all(pf::update_options const& opts) {
+        using ms = std::chrono::duration<double, std::milli>;
+
+        auto const base_dir = _cli.get_base_dir();
+        auto const start    = std::chrono::steady_clock::now();
+        auto const results  = pf::update_all_projects(base_dir, opts);
+        auto const elapsed  = std::chrono::steady_clock::now() - start;
+
+        std::size_t n_failed = 0;
+        for (auto const& result : results) {
+            auto const name = fs::relative(result.project_dir, base_dir).string();
+            if (!result.index_error.empty()) {
+                _cli.console->warn("{}: Failed to write source index: {}",
+                                   name,
+                                   result.index_error);
+            }
+            if (result.ok()) {
+                _cli.console->info("{}: Updated in {:.1f}ms", name, ms{result.elapsed}.count());
+            } else {
+                ++n_failed;
+                _cli.console->error("{}: Failed to update: {}", name, result.error);
+            }
+        }
+
+        _cli.console->info("Updated {} of {} projects in {:.1f}ms",
+                           results.size() - n_failed,
+                           results.size(),
+                           ms{elapsed}.count());
+        if (n_failed != 0) {
+            _cli.console->error("{} project(s) failed to update", n_failed);
+            return 1;
+        }
+        return 0;
+    }
 
 public:
     explicit cmd_update(cli_common& gl)
@@ -336,25 +676,43 @@ public:
             return 1;
         }
 
-        // Update existing source files
-        try {
-            auto const base_dir = _cli.get_base_dir();
-
-            auto const            src_dir = base_dir / "src";
-            std::vector<fs::path> sources = pf::glob_sources(src_dir);
-            pf::update_source_files(src_dir / "CMakeLists.txt", sources);
+        pf::update_options opts;
+        opts.jobs              = _jobs.Get();
+        opts.use_index         = !_no_index;
+        opts.stats             = &_cli.stats;
+        opts.from_git_index    = _from_git_index;
+        opts.include_untracked = _untracked;
+        for (auto const& glob : _sources) {
+            opts.source_patterns.push_back(glob);
+        }
 
-            auto const tests_dir = base_dir / "tests";
-            if (fs::exists(tests_dir)) {
-                std::vector<fs::path> test_sources = pf::glob_sources(tests_dir);
-                pf::update_source_files(tests_dir / "CMakeLists.txt", test_sources);
+        if (_untracked && !_from_git_index) {
+            _cli.console->error("--untracked requires --from-git-index");
+            return 1;
+        }
+        if (_all) {
+            if (_watch) {
+                _cli.console->error("--watch cannot be combined with --all");
+                return 1;
             }
-        } catch (const std::system_error& e) {
+            return _run_all(opts);
+        }
+
+        auto const result = pf::update_project(_cli.get_base_dir(), opts);
+        if (!result.index_error.empty()) {
+            _cli.console->warn("Failed to write source index ({}): {}",
+                               pf::source_index::default_path(result.project_dir),
+                               result.index_error);
+        }
+        if (!result.ok()) {
             _cli.console->error("Failed to update project in {}: {}",
-                                _cli.get_base_dir(),
-                                e.what());
+                                result.project_dir,
+                                result.error);
             return 1;
         }
+        if (_watch) {
+            return _run_watch(result.project_dir, opts.source_patterns);
+        }
         return 0;
     }
 };
@@ -364,13 +722,56 @@ private:
     cli_common&    _cli;
     args::Command  _cmd{_cli.cmd_group, "query", "Query the project"};
     args::HelpFlag _help{_cmd, "help", "Print help for the `query` subcommand", {'h', "help"}};
-    args::Positional<std::string> _id{
+    path_flag      _build_dir{_cmd,
+                         "build_dir",
+                         "The build directory whose CMakeCache.txt to query (Default: The nearest "
+                         "directory with a CMakeCache.txt, or <base-dir>/build)",
+                         {"build-dir"}};
+    args::PositionalList<std::string> _ids{
         _cmd,
         "id",
-        "Obtain this information. Valid values:\n"
-        "* project.root",
+        "Obtain this information, printing one line per id. Valid values:\n"
+        "* project.root\n"
+        "* cache.<KEY> (The value of <KEY> in the CMake cache)",
     };
 
+    std::optional<pf::cmake_cache> _cache;
+
+    fs::path _find_cache_file() {
+        if (_build_dir) {
+            return fs::absolute(_build_dir.Get()) / "CMakeCache.txt";
+        }
+        auto found = std::find_if(pf::ascending_iterator{fs::current_path()},
+                                  pf::ascending_iterator{},
+                                  [&](auto const& dir) {
+                                      return _cli.stats.exists(dir / "CMakeCache.txt");
+                                  });
+        if (found != pf::ascending_iterator{}) {
+            return *found / "CMakeCache.txt";
+        }
+        return _cli.get_base_dir() / "build" / "CMakeCache.txt";
+    }
+
+    // Loaded at most once, no matter how many keys are queried
+    pf::cmake_cache& _get_cache() {
+        if (!_cache) {
+            _cache = pf::cmake_cache::load(_find_cache_file());
+        }
+        return *_cache;
+    }
+
+    int _query_cache(std::string_view key) {
+        auto entry = _get_cache().find(key);
+        if (!entry) {
+            // Keep the output lines aligned with the ids
+            std::cout << '\n';
+            _cli.console->error("No entry `{}` in the CMake cache", key);
+            return 1;
+        }
+        std::cout << entry->value << '\n';
+        return 0;
+    }
+
 public:
     explicit cmd_query(cli_common& gl)
         : _cli{gl} {}
@@ -385,19 +786,80 @@ public:
                  return 0;
              }},
         };
+        constexpr std::string_view CachePrefix = "cache.";
 
-        auto const id = _id.Get();
-
-        auto query = queries.find(id);
-        if (query == queries.end()) {
-            _cli.console->error(
-                "Invalid id `{}`. Valid values:\n"
-                "* project.root",
-                id);
+        if (_ids.Get().empty()) {
+            _cli.console->error("No id given to query");
             return 1;
         }
 
-        return query->second(*this);
+        int rc = 0;
+        for (auto const& id : _ids.Get()) {
+            if (id.compare(0, CachePrefix.size(), CachePrefix) == 0) {
+                try {
+                    auto const key = std::string_view{id}.substr(CachePrefix.size());
+                    rc             = std::max(rc, _query_cache(key));
+                } catch (const std::system_error& e) {
+                    _cli.console->error("Failed to read the CMake cache: {}", e.what());
+                    return 1;
+                }
+                continue;
+            }
+
+            auto query = queries.find(id);
+            if (query == queries.end()) {
+                _cli.console->error(
+                    "Invalid id `{}`. Valid values:\n"
+                    "* project.root\n"
+                    "* cache.<KEY>",
+                    id);
+                return 1;
+            }
+            rc = std::max(rc, query->second(*this));
+        }
+        return rc;
+    }
+};
+
+class cmd_serve {
+private:
+    cli_common&    _cli;
+    args::Command  _cmd{_cli.cmd_group,
+                       "serve",
+                       "Answer JSON-RPC requests on stdin, keeping project state in memory"};
+    args::HelpFlag _help{_cmd, "help", "Print help for the `serve` subcommand", {'h', "help"}};
+    args::ValueFlag<unsigned> _jobs{_cmd,
+                                    "jobs",
+                                    "Number of threads used to create projects (0: one per CPU)",
+                                    {'j', "jobs"},
+                                    0};
+
+public:
+    explicit cmd_serve(cli_common& gl)
+        : _cli{gl} {}
+
+    explicit operator bool() const { return !!_cmd; }
+
+    int run() {
+        // stdout carries the responses, so diagnostics must go elsewhere
+        auto log = spdlog::stderr_color_mt("serve");
+
+        pf::server_options opts;
+        opts.jobs = _jobs.Get();
+        if (_cli.base_dir_arg || std::getenv("PF_BASE_DIR")) {
+            // Otherwise, the base directory is detected anew for each request
+            opts.base_dir = _cli.get_base_dir();
+        }
+
+        std::ios::sync_with_stdio(false);
+        pf::server server{opts};
+        try {
+            server.run(std::cin, std::cout);
+        } catch (const std::exception& e) {
+            log->error("Stopped serving: {}", e.what());
+            return 1;
+        }
+        return 0;
     }
 };
 
@@ -410,8 +872,10 @@ int main(int argc, char** argv) {
     // Subcommands
     cmd_list   list{args};
     cmd_new    new_{args};
+    cmd_diff   diff{args};
     cmd_update update{args};
     cmd_query  query{args};
+    cmd_serve  serve{args};
 
     try {
         parser.ParseCLI(argc, argv);
@@ -423,15 +887,27 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    if (args.verbose) {
+        args.console->set_level(spdlog::level::debug);
+    }
+    if (args.trace_file) {
+        pf::trace::start();
+    }
+
+    int rc = 0;
     try {
         if (list) {
-            return list.run();
+            rc = list.run();
         } else if (new_) {
-            return new_.run();
+            rc = new_.run();
+        } else if (diff) {
+            rc = diff.run();
         } else if (update) {
-            return update.run();
+            rc = update.run();
         } else if (query) {
-            return query.run();
+            rc = query.run();
+        } else if (serve) {
+            rc = serve.run();
         } else {
             assert(false && "No subcommand selected?");
             std::terminate();
@@ -439,4 +915,19 @@ int main(int argc, char** argv) {
     } catch (const reached_eof&) {
         return 2;
     }
+
+    args.console->debug("Filesystem queries: {} ({} answered from cache)",
+                        args.stats.lookups(),
+                        args.stats.syscalls_avoided());
+    if (args.trace_file) {
+        std::error_code ec;
+        pf::trace::save(args.trace_file.Get(), ec);
+        if (ec) {
+            args.console->error("Failed to write the trace to {}: {}",
+                                args.trace_file.Get(),
+                                ec.message());
+            return rc == 0 ? 1 : rc;
+        }
+    }
+    return rc;
 }
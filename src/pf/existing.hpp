@@ -1,7 +1,11 @@
 #ifndef PF_EXISTING_HPP_INCLUDED
 #define PF_EXISTING_HPP_INCLUDED
 
+#include <pf/existing/cmake_cache.hpp>
 #include <pf/existing/detect_base_dir.hpp>
+#include <pf/existing/project_config.hpp>
+#include <pf/existing/source_manifest.hpp>
+#include <pf/existing/update_project.hpp>
 #include <pf/existing/update_source_files.hpp>
 
 #endif  // PF_EXISTING_HPP_INCLUDED
@@ -0,0 +1,279 @@
+#include "./cmake_cache.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+
+namespace fs = pf::fs;
+
+namespace {
+
+constexpr char          IndexMagic[8] = {'P', 'F', 'C', 'C', 'I', 'D', 'X', '\0'};
+constexpr std::uint32_t ByteOrderMark = 0x01020304;
+
+// A cache modified within this window of being indexed may be modified again within the same
+// timestamp tick, so its index is not saved.
+constexpr std::int64_t RacyWindowNs = 2'000'000'000;
+
+/**
+ * On-disk layout of the index. All integers are in host byte order. The header is followed by
+ * `record_count` records and `bucket_count` buckets.
+ */
+struct index_header {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint64_t cache_size;
+    std::int64_t  cache_mtime_ns;
+    std::uint32_t record_count;
+    std::uint32_t bucket_count;
+};
+
+static_assert(sizeof(index_header) == 40);
+static_assert(sizeof(pf::cmake_cache::record) == 24);
+
+std::uint32_t hash_key(std::string_view key) noexcept {
+    // FNV-1a
+    std::uint32_t hash = 2166136261u;
+    for (unsigned char c : key) {
+        hash = (hash ^ c) * 16777619u;
+    }
+    return hash;
+}
+
+std::int64_t to_ns(fs::file_time_type time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+bool is_trailing_space(char c) noexcept { return c == ' ' || c == '\t' || c == '\r'; }
+
+}  // namespace
+
+/**
+ * Split the file into entries. The lines and separators are found with memchr, which is
+ * vectorized by every major C library, so each byte of the file is only scanned once or twice.
+ */
+void pf::cmake_cache::_parse() {
+    auto const        content = _file.view();
+    const char* const begin   = content.data();
+    const char* const end     = begin + content.size();
+
+    for (const char* line = begin; line < end;) {
+        auto line_end = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (!line_end) {
+            line_end = end;
+        }
+        auto const next = line_end + 1;
+
+        // Skip blank lines and comments
+        auto const is_comment
+            = *line == '#' || (*line == '/' && line + 1 < line_end && line[1] == '/');
+        if (line == line_end || *line == '\r' || is_comment) {
+            line = next;
+            continue;
+        }
+
+        record rec{};
+        const char* key_begin = line;
+        const char* key_end   = nullptr;
+        const char* rest      = nullptr;
+        if (*line == '"') {
+            // A quoted key may contain any character but the quote
+            key_begin = line + 1;
+            key_end   = static_cast<const char*>(std::memchr(key_begin, '"', line_end - key_begin));
+            if (!key_end) {
+                line = next;
+                continue;
+            }
+            rest = key_end + 1;
+        }
+        auto const eq = static_cast<const char*>(
+            std::memchr(rest ? rest : line, '=', line_end - (rest ? rest : line)));
+        if (!eq) {
+            line = next;
+            continue;
+        }
+        if (!rest) {
+            // The key is everything up to the first ':', or to the '=' if the entry has no type
+            key_end = static_cast<const char*>(std::memchr(line, ':', eq - line));
+            if (!key_end) {
+                key_end = eq;
+            }
+            rest = key_end;
+        }
+        if (rest < eq && *rest == ':') {
+            rec.type_offset = static_cast<std::uint32_t>(rest + 1 - begin);
+            rec.type_size   = static_cast<std::uint32_t>(eq - (rest + 1));
+        }
+
+        auto value_end = line_end;
+        while (value_end > eq + 1 && is_trailing_space(value_end[-1])) {
+            --value_end;
+        }
+        rec.key_offset   = static_cast<std::uint32_t>(key_begin - begin);
+        rec.key_size     = static_cast<std::uint32_t>(key_end - key_begin);
+        rec.value_offset = static_cast<std::uint32_t>(eq + 1 - begin);
+        rec.value_size   = static_cast<std::uint32_t>(value_end - (eq + 1));
+        _records.push_back(rec);
+
+        line = next;
+    }
+}
+
+void pf::cmake_cache::_build_buckets() {
+    std::size_t n_buckets = 16;
+    while (n_buckets < _records.size() * 2) {
+        n_buckets *= 2;
+    }
+    _buckets.assign(n_buckets, 0);
+
+    auto const mask = n_buckets - 1;
+    for (auto i = 0u; i < _records.size(); ++i) {
+        auto const key  = _key(_records[i]);
+        auto       slot = ::hash_key(key) & mask;
+        // Later entries replace earlier ones with the same key
+        while (_buckets[slot] != 0 && _key(_records[_buckets[slot] - 1]) != key) {
+            slot = (slot + 1) & mask;
+        }
+        _buckets[slot] = i + 1;
+    }
+}
+
+std::optional<pf::cmake_cache_entry> pf::cmake_cache::find(std::string_view key) const {
+    if (_buckets.empty()) {
+        return std::nullopt;
+    }
+    auto const mask = _buckets.size() - 1;
+    for (auto slot = ::hash_key(key) & mask; _buckets[slot] != 0; slot = (slot + 1) & mask) {
+        auto const& rec = _records[_buckets[slot] - 1];
+        if (_key(rec) == key) {
+            auto const content = _file.view();
+            return cmake_cache_entry{
+                content.substr(rec.key_offset, rec.key_size),
+                content.substr(rec.type_offset, rec.type_size),
+                content.substr(rec.value_offset, rec.value_size),
+            };
+        }
+    }
+    return std::nullopt;
+}
+
+bool pf::cmake_cache::_load_index(const fs::path& index_file,
+                                  std::uint64_t   size,
+                                  std::int64_t    mtime_ns) {
+    std::error_code ec;
+    auto const      index = pf::map_file(index_file, ec);
+    if (ec || index.size() < sizeof(index_header)) {
+        return false;
+    }
+    index_header header;
+    std::memcpy(&header, index.data(), sizeof header);
+    if (std::memcmp(header.magic, IndexMagic, sizeof IndexMagic) != 0
+        || header.version != format_version || header.byte_order != ByteOrderMark
+        || header.cache_size != size || header.cache_mtime_ns != mtime_ns) {
+        return false;
+    }
+
+    auto const records_size = std::size_t{header.record_count} * sizeof(record);
+    auto const buckets_size = std::size_t{header.bucket_count} * sizeof(std::uint32_t);
+    if (index.size() != sizeof header + records_size + buckets_size
+        || (header.bucket_count & (header.bucket_count - 1)) != 0
+        || header.bucket_count <= header.record_count) {
+        return false;
+    }
+
+    _records.resize(header.record_count);
+    _buckets.resize(header.bucket_count);
+    std::memcpy(_records.data(), index.data() + sizeof header, records_size);
+    std::memcpy(_buckets.data(), index.data() + sizeof header + records_size, buckets_size);
+
+    // Don't trust offsets that point outside of the file
+    for (auto const& rec : _records) {
+        if (std::uint64_t{rec.key_offset} + rec.key_size > size
+            || std::uint64_t{rec.type_offset} + rec.type_size > size
+            || std::uint64_t{rec.value_offset} + rec.value_size > size) {
+            _records.clear();
+            _buckets.clear();
+            return false;
+        }
+    }
+    // find() probes until it reaches an empty bucket, so there must be one
+    auto has_empty = false;
+    for (auto bucket : _buckets) {
+        if (bucket > _records.size()) {
+            has_empty = false;
+            break;
+        }
+        has_empty = has_empty || bucket == 0;
+    }
+    if (!has_empty) {
+        _records.clear();
+        _buckets.clear();
+        return false;
+    }
+    return true;
+}
+
+void pf::cmake_cache::_save_index(const fs::path& index_file,
+                                  std::uint64_t   size,
+                                  std::int64_t    mtime_ns) const {
+    index_header header{};
+    std::memcpy(header.magic, IndexMagic, sizeof IndexMagic);
+    header.version        = format_version;
+    header.byte_order     = ByteOrderMark;
+    header.cache_size     = size;
+    header.cache_mtime_ns = mtime_ns;
+    header.record_count   = static_cast<std::uint32_t>(_records.size());
+    header.bucket_count   = static_cast<std::uint32_t>(_buckets.size());
+
+    std::string content;
+    content.reserve(sizeof header + _records.size() * sizeof(record)
+                    + _buckets.size() * sizeof(std::uint32_t));
+    content.append(reinterpret_cast<const char*>(&header), sizeof header);
+    content.append(reinterpret_cast<const char*>(_records.data()),
+                   _records.size() * sizeof(record));
+    content.append(reinterpret_cast<const char*>(_buckets.data()),
+                   _buckets.size() * sizeof(std::uint32_t));
+
+    // The index is only an optimization, so failing to write it is not an error
+    std::error_code ec;
+    pf::write_file(index_file, content, pf::write_mode::atomic_if_changed, ec);
+}
+
+pf::cmake_cache pf::cmake_cache::load(const fs::path&  cache_file,
+                                      index_mode       mode,
+                                      std::error_code& ec) {
+    cmake_cache ret;
+
+    auto const mtime = fs::last_write_time(cache_file, ec);
+    if (ec) {
+        return ret;
+    }
+    ret._file = pf::map_file(cache_file, ec);
+    if (ec) {
+        return ret;
+    }
+    if (ret._file.size() > UINT32_MAX) {
+        ec = std::make_error_code(std::errc::file_too_large);
+        return ret;
+    }
+
+    auto const size       = std::uint64_t{ret._file.size()};
+    auto const mtime_ns   = ::to_ns(mtime);
+    auto const index_file = index_path(cache_file);
+    if (ret._load_index(index_file, size, mtime_ns)) {
+        ret._from_index = true;
+        return ret;
+    }
+
+    ret._parse();
+    ret._build_buckets();
+
+    std::error_code dir_ec;
+    auto const      is_racy = ::to_ns(fs::file_time_type::clock::now()) - mtime_ns < RacyWindowNs;
+    if (mode == index_mode::read_write && !is_racy
+        && fs::is_directory(index_file.parent_path(), dir_ec)) {
+        ret._save_index(index_file, size, mtime_ns);
+    }
+    return ret;
+}
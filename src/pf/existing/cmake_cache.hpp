@@ -0,0 +1,101 @@
+#ifndef PF_EXISTING_CMAKE_CACHE_HPP_INCLUDED
+#define PF_EXISTING_CMAKE_CACHE_HPP_INCLUDED
+
+#include <pf/fs.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace pf {
+
+struct cmake_cache_entry {
+    std::string_view key;
+    // Empty if the entry has no type
+    std::string_view type;
+    std::string_view value;
+};
+
+/**
+ * A read-only view of the entries of a CMakeCache.txt.
+ *
+ * The file is mapped and split into entries in a single pass, and the entries are indexed by a
+ * hash table of offsets into the file. The index is saved in the build directory's CMakeFiles/
+ * (if there is one) along with the size and mtime of the cache, so that later loads of an
+ * unchanged cache only need to read the index rather than parse the file again.
+ */
+class cmake_cache {
+public:
+    /// Bump this whenever the layout of the saved index changes
+    static constexpr std::uint32_t format_version = 1;
+
+    /// Where the index for the given cache file is saved
+    static fs::path index_path(const fs::path& cache_file) {
+        return cache_file.parent_path() / "CMakeFiles" / "pf-cache.index";
+    }
+
+    enum class index_mode {
+        /// Use the saved index, and write it anew if it is missing or stale
+        read_write,
+        /// Use the saved index if it is current, but never write it
+        read_only,
+    };
+
+    /**
+     * Load the given CMakeCache.txt, using (or, as `mode` allows, writing) the saved index. Fills
+     * out `ec` if the cache file cannot be read. Failures to read or write the index are not
+     * errors.
+     */
+    static cmake_cache load(const fs::path& cache_file, index_mode mode, std::error_code& ec);
+    static cmake_cache load(const fs::path& cache_file, std::error_code& ec) {
+        return load(cache_file, index_mode::read_write, ec);
+    }
+    static cmake_cache load(const fs::path& cache_file, index_mode mode = index_mode::read_write) {
+        std::error_code ec;
+        auto            ret = load(cache_file, mode, ec);
+        if (ec) {
+            throw std::system_error{ec, "Reading CMake cache: " + cache_file.string()};
+        }
+        return ret;
+    }
+
+    /// Find the entry with the given key. If the key appears more than once, the last one wins.
+    std::optional<cmake_cache_entry> find(std::string_view key) const;
+
+    /// The number of entries in the cache
+    std::size_t size() const noexcept { return _records.size(); }
+
+    /// `true` if the entries were read from a saved index rather than by parsing the file
+    bool loaded_from_index() const noexcept { return _from_index; }
+
+    struct record {
+        std::uint32_t key_offset;
+        std::uint32_t key_size;
+        std::uint32_t type_offset;
+        std::uint32_t type_size;
+        std::uint32_t value_offset;
+        std::uint32_t value_size;
+    };
+
+private:
+    mapped_file                _file;
+    std::vector<record>        _records;
+    // Open-addressed hash table of (index + 1) into `_records`, with zero marking an empty slot
+    std::vector<std::uint32_t> _buckets;
+    bool                       _from_index = false;
+
+    std::string_view _key(const record& rec) const noexcept {
+        return _file.view().substr(rec.key_offset, rec.key_size);
+    }
+
+    void _parse();
+    void _build_buckets();
+    bool _load_index(const fs::path& index_file, std::uint64_t size, std::int64_t mtime_ns);
+    void _save_index(const fs::path& index_file, std::uint64_t size, std::int64_t mtime_ns) const;
+};
+
+}  // namespace pf
+
+#endif  // PF_EXISTING_CMAKE_CACHE_HPP_INCLUDED
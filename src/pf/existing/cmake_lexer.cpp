@@ -0,0 +1,133 @@
+#include "./cmake_lexer.hpp"
+
+#include <algorithm>
+
+namespace {
+
+constexpr bool is_space(char c) noexcept { return c == ' ' || c == '\t' || c == '\r'; }
+
+}  // namespace
+
+// Returns the size of the bracket opening at `pos` (`[[`, `[=[`, ...), or zero if there is none
+std::size_t pf::cmake_lexer::_bracket_open_size(std::size_t pos) const noexcept {
+    if (pos >= _input.size() || _input[pos] != '[') {
+        return 0;
+    }
+    auto after_eq = _input.find_first_not_of('=', pos + 1);
+    if (after_eq == _input.npos || _input[after_eq] != '[') {
+        return 0;
+    }
+    return after_eq + 1 - pos;
+}
+
+// Returns the end of the bracket content beginning after an opening of `open_size` characters
+std::size_t pf::cmake_lexer::_scan_bracket(std::size_t pos, std::size_t open_size) const noexcept {
+    // The closing bracket has the same number of '=' as the opening one
+    auto const n_eq = open_size - 2;
+    while (true) {
+        pos = _input.find(']', pos);
+        if (pos == _input.npos) {
+            return _input.size();
+        }
+        auto const eq_end = std::min(_input.find_first_not_of('=', pos + 1), _input.size());
+        if (eq_end - (pos + 1) == n_eq && eq_end < _input.size() && _input[eq_end] == ']') {
+            return eq_end + 1;
+        }
+        ++pos;
+    }
+}
+
+// Returns the end of the quoted argument whose opening quote is at `pos`
+std::size_t pf::cmake_lexer::_scan_quoted(std::size_t pos) const noexcept {
+    ++pos;
+    while (true) {
+        pos = _input.find_first_of("\"\\", pos);
+        if (pos == _input.npos) {
+            return _input.size();
+        }
+        if (_input[pos] == '"') {
+            return pos + 1;
+        }
+        // Skip the escaped character
+        pos += 2;
+        if (pos >= _input.size()) {
+            return _input.size();
+        }
+    }
+}
+
+std::size_t pf::cmake_lexer::_scan_unquoted(std::size_t pos) const noexcept {
+    auto const start = pos;
+    while (pos < _input.size()) {
+        auto c = _input[pos];
+        if (is_space(c) || c == '\n' || c == '(' || c == ')' || c == '#') {
+            break;
+        } else if (c == '\\') {
+            pos = std::min(pos + 2, _input.size());
+        } else if (c == '"') {
+            // Legacy unquoted arguments may contain quoted sections, as in -Dfoo="bar baz"
+            pos = _scan_quoted(pos);
+        } else {
+            ++pos;
+        }
+    }
+    // Always make progress, even on a stray character
+    return std::max(pos, start + 1);
+}
+
+pf::cmake_token pf::cmake_lexer::next() noexcept {
+    using kind = cmake_token_kind;
+
+    auto const start = _pos;
+    if (start >= _input.size()) {
+        return cmake_token{kind::eof, _input.substr(_input.size()), _input.size()};
+    }
+
+    auto tok = kind::unquoted_argument;
+    auto end = start + 1;
+    switch (_input[start]) {
+    case '\n':
+        tok = kind::newline;
+        break;
+    case ' ':
+    case '\t':
+    case '\r':
+        tok = kind::whitespace;
+        while (end < _input.size() && is_space(_input[end])) {
+            ++end;
+        }
+        break;
+    case '(':
+        tok = kind::open_paren;
+        break;
+    case ')':
+        tok = kind::close_paren;
+        break;
+    case '#':
+        if (auto open_size = _bracket_open_size(start + 1)) {
+            tok = kind::bracket_comment;
+            end = _scan_bracket(start + 1 + open_size, open_size);
+        } else {
+            tok = kind::line_comment;
+            end = std::min(_input.find('\n', start), _input.size());
+        }
+        break;
+    case '"':
+        tok = kind::quoted_argument;
+        end = _scan_quoted(start);
+        break;
+    case '[':
+        if (auto open_size = _bracket_open_size(start)) {
+            tok = kind::bracket_argument;
+            end = _scan_bracket(start + open_size, open_size);
+            break;
+        }
+        [[fallthrough]];
+    default:
+        end = _scan_unquoted(start);
+        break;
+    }
+
+    _pos = end;
+    return cmake_token{tok, _input.substr(start, end - start), start};
+}
@@ -0,0 +1,56 @@
+#ifndef PF_EXISTING_CMAKE_LEXER_HPP_INCLUDED
+#define PF_EXISTING_CMAKE_LEXER_HPP_INCLUDED
+
+#include <cstddef>
+#include <string_view>
+
+namespace pf {
+
+enum class cmake_token_kind {
+    eof,
+    newline,
+    whitespace,
+    line_comment,
+    bracket_comment,
+    open_paren,
+    close_paren,
+    bracket_argument,
+    quoted_argument,
+    // Also used for command names, which the lexer does not distinguish from arguments
+    unquoted_argument,
+};
+
+struct cmake_token {
+    cmake_token_kind kind = cmake_token_kind::eof;
+    std::string_view text;
+    // Offset of the token within the lexer's input
+    std::size_t offset = 0;
+};
+
+/**
+ * Splits CMake code into tokens. Every byte of the input belongs to exactly one token, so the
+ * input can be reconstructed by concatenating the tokens' text.
+ *
+ * The lexer is lenient: Unterminated strings, brackets, and comments extend to the end of the
+ * input rather than raising an error.
+ */
+class cmake_lexer {
+    std::string_view _input;
+    std::size_t      _pos = 0;
+
+    std::size_t _bracket_open_size(std::size_t pos) const noexcept;
+    std::size_t _scan_bracket(std::size_t pos, std::size_t open_size) const noexcept;
+    std::size_t _scan_quoted(std::size_t pos) const noexcept;
+    std::size_t _scan_unquoted(std::size_t pos) const noexcept;
+
+public:
+    explicit cmake_lexer(std::string_view input)
+        : _input(input) {}
+
+    /// Get the next token. Returns a token of kind `eof` once the input is exhausted.
+    cmake_token next() noexcept;
+};
+
+}  // namespace pf
+
+#endif  // PF_EXISTING_CMAKE_LEXER_HPP_INCLUDED
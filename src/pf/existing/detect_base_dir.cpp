@@ -1,8 +1,9 @@
 #include "./detect_base_dir.hpp"
 
+#include <pf/existing/cmake_cache.hpp>
+#include <pf/util/trace.hpp>
+
 #include <algorithm>
-#include <fstream>
-#include <string>
 #include <utility>
 
 #include <boost/range/iterator_range.hpp>
@@ -11,41 +12,42 @@ namespace fs = pf::fs;
 
 namespace {
 std::optional<fs::path> parse_cmakecache_homedir(fs::path const& cmakecache) {
-    std::string line;
-
-    std::fstream file = pf::open(cmakecache, std::ios::in);
-
-    while (std::getline(file, line)) {
-        // Equivalent to the non-existent:
-        // if (line.starts_with("..."))
-        if (line.rfind("CMAKE_HOME_DIRECTORY:", 0) == 0) {
-            auto index = line.find('=');
-            line.erase(line.begin(), line.begin() + index + 1);
-            return fs::path{line};
-        }
+    // Only looked at in passing, so nothing is written to the build directory, and a cache that
+    // cannot be read names no project
+    std::error_code ec;
+    auto const      cache
+        = pf::cmake_cache::load(cmakecache, pf::cmake_cache::index_mode::read_only, ec);
+    if (ec) {
+        return std::nullopt;
     }
-
-    return std::nullopt;
+    auto const entry = cache.find("CMAKE_HOME_DIRECTORY");
+    if (!entry) {
+        return std::nullopt;
+    }
+    return fs::path{entry->value};
 }
 }  // namespace
 
-std::optional<fs::path> pf::detect_base_dir(fs::path from_dir) {
+std::optional<fs::path> pf::detect_base_dir(fs::path from_dir, stat_cache& stats) {
+    pf::trace::span span{"detect_base_dir", from_dir};
     auto cur_dir = std::find_if(pf::ascending_iterator{from_dir},
                                 pf::ascending_iterator{},
-                                [](auto const& dir) {
-                                    return fs::exists(dir / "CMakeLists.txt")
-                                        || fs::exists(dir / "CMakeCache.txt");
+                                [&](auto const& dir) {
+                                    return stats.exists(dir / "CMakeLists.txt")
+                                        || stats.exists(dir / "CMakeCache.txt");
                                 });
 
     if (cur_dir == pf::ascending_iterator{}) {
         return std::nullopt;
     }
 
-    if (fs::exists(*cur_dir / "CMakeLists.txt")) {
+    // The first search already looked this up, so `stats` answers it without a system call. The
+    // search for the topmost CMakeLists.txt below looks at the parents of `cur_dir`, which are new.
+    if (stats.exists(*cur_dir / "CMakeLists.txt")) {
         return *std::find_if(pf::ascending_iterator{*cur_dir},
                              pf::ascending_iterator{},
-                             [](auto const& path) {
-                                 return !fs::exists(path.parent_path() / "CMakeLists.txt");
+                             [&](auto const& path) {
+                                 return !stats.exists(path.parent_path() / "CMakeLists.txt");
                              });
     }
 
@@ -2,12 +2,23 @@
 #define PF_EXISTING_DETECT_BASE_DIR_HPP_INCLUDED
 
 #include <optional>
+#include <utility>
 
 #include <pf/fs.hpp>
 
 namespace pf {
 
-std::optional<fs::path> detect_base_dir(fs::path from_dir = fs::current_path());
+/**
+ * Find the root of the project containing `from_dir`: The highest directory of the innermost chain
+ * of directories containing a CMakeLists.txt, or the source directory recorded in the nearest
+ * CMakeCache.txt. Filesystem queries go through `stats`.
+ */
+std::optional<fs::path> detect_base_dir(fs::path from_dir, stat_cache& stats);
+
+inline std::optional<fs::path> detect_base_dir(fs::path from_dir = fs::current_path()) {
+    stat_cache stats;
+    return detect_base_dir(std::move(from_dir), stats);
+}
 
 }  // namespace pf
 
@@ -0,0 +1,57 @@
+#include "./project_config.hpp"
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <sstream>
+#include <stdexcept>
+
+pf::project_config pf::load_project_config(fs::path const& project_root) {
+    namespace pt = boost::property_tree;
+
+    auto const      file = project_config::default_path(project_root);
+    std::error_code ec;
+    auto const      content = pf::map_file(file, ec);
+    if (ec == std::errc::no_such_file_or_directory) {
+        return project_config{};
+    }
+    if (ec) {
+        throw std::system_error{ec, "Failed to read " + file.string()};
+    }
+
+    pt::ptree          root;
+    std::istringstream in{std::string{content.view()}};
+    try {
+        pt::read_json(in, root);
+    } catch (const pt::json_parser_error& e) {
+        throw std::runtime_error(file.string() + ": Invalid JSON on line "
+                                 + std::to_string(e.line()) + ": " + e.message());
+    }
+
+    project_config config;
+    for (auto const& [key, value] : root) {
+        if (key != "sources") {
+            throw std::runtime_error(file.string() + ": Unknown setting `" + key + "`");
+        }
+        // Array elements have no key, and strings have no children
+        if (!value.data().empty()) {
+            throw std::runtime_error(file.string() + ": `sources` must be an array of strings");
+        }
+        for (auto const& [index, glob] : value) {
+            if (!index.empty() || !glob.empty()) {
+                throw std::runtime_error(file.string()
+                                         + ": `sources` must be an array of strings");
+            }
+            config.sources.push_back(glob.data());
+        }
+    }
+    return config;
+}
+
+pf::source_patterns pf::source_patterns_for(project_config const&           config,
+                                            std::vector<std::string> const& extra) {
+    auto globs = source_patterns::default_globs();
+    globs.insert(globs.end(), config.sources.begin(), config.sources.end());
+    globs.insert(globs.end(), extra.begin(), extra.end());
+    return source_patterns{std::move(globs)};
+}
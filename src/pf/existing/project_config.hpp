@@ -0,0 +1,46 @@
+#ifndef PF_EXISTING_PROJECT_CONFIG_HPP_INCLUDED
+#define PF_EXISTING_PROJECT_CONFIG_HPP_INCLUDED
+
+#include <pf/fs.hpp>
+
+#include <string>
+#include <vector>
+
+namespace pf {
+
+/**
+ * The settings of an existing project, kept in a `pitchfork.json` at its root. For example:
+ *
+ *     {
+ *         "sources": ["*.cu", "!generated/"]
+ *     }
+ *
+ * - `sources`: Globs that select the files listed as sources in src/ and tests/, relative to those
+ *   directories. These apply after the default globs (see `source_patterns`), so they may add to
+ *   or exclude from the usual C and C++ files.
+ */
+struct project_config {
+    std::vector<std::string> sources;
+
+    /// The location of the config file of a project
+    static fs::path default_path(fs::path const& project_root) {
+        return project_root / "pitchfork.json";
+    }
+};
+
+/**
+ * Read the config of the project at `project_root`. A project without a config file has the
+ * default settings. Throws `std::runtime_error` if the file cannot be read or understood.
+ */
+project_config load_project_config(fs::path const& project_root);
+
+/**
+ * Compile the globs that select a project's sources: The defaults, then those of `config`, and
+ * then `extra`. Throws `std::runtime_error` if one of the globs is malformed.
+ */
+source_patterns source_patterns_for(project_config const&           config,
+                                    std::vector<std::string> const& extra);
+
+}  // namespace pf
+
+#endif  // PF_EXISTING_PROJECT_CONFIG_HPP_INCLUDED
@@ -0,0 +1,160 @@
+#include "./source_manifest.hpp"
+
+#include <pf/existing/cmake_lexer.hpp>
+#include <pf/util/trace.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <vector>
+
+namespace fs = pf::fs;
+
+namespace {
+
+// Whether `cmake` invokes `command`, whose name is in lower case
+bool calls_command(std::string_view cmake, std::string_view command) {
+    pf::cmake_lexer lexer{cmake};
+    // Outside of any invocation, an unquoted argument can only be the name of a command
+    int  depth   = 0;
+    bool matched = false;
+    for (auto tok = lexer.next(); tok.kind != pf::cmake_token_kind::eof; tok = lexer.next()) {
+        switch (tok.kind) {
+        case pf::cmake_token_kind::open_paren:
+            if (depth++ == 0 && matched) {
+                return true;
+            }
+            break;
+        case pf::cmake_token_kind::close_paren:
+            depth = std::max(depth - 1, 0);
+            break;
+        case pf::cmake_token_kind::unquoted_argument:
+            if (depth == 0) {
+                // Command names are not case-sensitive
+                matched = std::equal(tok.text.begin(),
+                                     tok.text.end(),
+                                     command.begin(),
+                                     command.end(),
+                                     [](unsigned char lhs, unsigned char rhs) {
+                                         return std::tolower(lhs) == rhs;
+                                     });
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+// The relative paths of the regular files below `dir`, in order
+std::vector<std::string> files_below(fs::path const& dir) {
+    std::vector<std::string> files;
+    std::error_code          ec;
+    for (fs::recursive_directory_iterator it{dir, ec}, stop; !ec && it != stop;
+         it.increment(ec)) {
+        std::error_code type_ec;
+        if (it->is_regular_file(type_ec)) {
+            files.push_back(it->path().lexically_relative(dir).generic_string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+/**
+ * Append `root/path` as a bracket argument, which CMake takes as it is: A path may hold spaces,
+ * quotes, `#`, `$` or parentheses. The argument gets as many `=` as it takes for the path not to
+ * end it early.
+ */
+void append_bracket_argument(std::string& out, std::string_view root, std::string_view path) {
+    std::string close = "]]";
+    if (path.find(']') != path.npos) {
+        // The path must not hold the closing bracket, nor end with the start of one
+        auto const ends_early = [&] {
+            return (std::string{path} + close).find(close) != path.size();
+        };
+        while (ends_early()) {
+            close.insert(1, "=");
+        }
+    }
+    out.push_back('[');
+    out.append(close, 1, close.size() - 2);
+    out.push_back('[');
+    out.append(root);
+    out.push_back('/');
+    out.append(path);
+    out.append(close);
+}
+
+void append_list(std::string& out, std::string_view var, std::string const& entries) {
+    out.append("set(");
+    out.append(var);
+    out.push_back('\n');
+    out.append(entries);
+    out.append("    )\n");
+}
+
+}  // namespace
+
+bool pf::source_manifest::wanted(fs::path const& project_dir) {
+    std::error_code ec;
+    if (fs::exists(path(project_dir), ec)) {
+        return true;
+    }
+    auto const cmakelists = pf::slurp_file(project_dir / "CMakeLists.txt", ec);
+    return !ec && ::calls_command(cmakelists, "pf_auto");
+}
+
+pf::source_manifest pf::source_manifest::collect(fs::path const& project_dir) {
+    pf::trace::span     span{"source_manifest::collect", project_dir};
+    pf::source_manifest manifest;
+    for (auto const& file : ::files_below(project_dir / "src")) {
+        manifest.add("src", file);
+    }
+    // pf_auto() only globs include/ if it is there, and uses src/ for public headers otherwise
+    auto const      include_dir = project_dir / "include";
+    std::error_code ec;
+    if (fs::is_directory(include_dir, ec)) {
+        for (auto const& file : ::files_below(include_dir)) {
+            manifest.add("include", file);
+        }
+    }
+    return manifest;
+}
+
+pf::source_manifest::kind pf::source_manifest::classify(std::string_view root,
+                                                        std::string_view path) noexcept {
+    if (root != "src") {
+        return kind::lib;
+    }
+    return path.find('/') == path.npos ? kind::exe : kind::lib;
+}
+
+void pf::source_manifest::add(std::string_view root, std::string_view path) {
+    auto& list = classify(root, path) == kind::exe ? _exe : _lib;
+    list.append("    ");
+    ::append_bracket_argument(list, root, path);
+    list.push_back('\n');
+}
+
+std::string pf::source_manifest::render() const {
+    std::string out;
+    out.reserve(_exe.size() + _lib.size() + 256);
+    out.append("# Generated by `pf update`: The sources of the project, for pf_auto(), so that it\n"
+               "# need not glob for them. Paths are relative to the project directory.\n");
+    ::append_list(out, "PF_EXE_SOURCES", _exe);
+    ::append_list(out, "PF_LIB_SOURCES", _lib);
+    return out;
+}
+
+bool pf::source_manifest::write(fs::path const& project_dir) const {
+    pf::trace::span span{"source_manifest::write", project_dir};
+    return pf::write_file(path(project_dir), render(), pf::write_mode::atomic_if_changed);
+}
+
+bool pf::update_source_manifest(fs::path const& project_dir) {
+    if (!source_manifest::wanted(project_dir)) {
+        return false;
+    }
+    return source_manifest::collect(project_dir).write(project_dir);
+}
@@ -0,0 +1,82 @@
+#ifndef PF_EXISTING_SOURCE_MANIFEST_HPP_INCLUDED
+#define PF_EXISTING_SOURCE_MANIFEST_HPP_INCLUDED
+
+#include <string>
+#include <string_view>
+
+#include <pf/fs.hpp>
+
+namespace pf {
+
+/**
+ * The sources of a project built with `pf_auto()` (see extras/pf-cmake/auto.cmake), sorted into
+ * the targets it defines, so that CMake need not glob for them.
+ *
+ * The manifest is CMake code that sets `PF_EXE_SOURCES` and `PF_LIB_SOURCES` to paths relative
+ * to the project directory. `pf_auto()` includes it if it exists, and only globs the tree if it
+ * does not. The manifest lists every file that glob would find, classified as it would classify
+ * them, so source patterns play no part in it. Each path is written as a bracket argument, and is
+ * read back exactly. Even so, a `;` or an unbalanced square bracket in a name splits or merges the
+ * list entries when the lists are used, as it does for the paths `file(GLOB)` finds.
+ *
+ * Sources are rendered into the lists as they are added, so a manifest takes about as much memory
+ * as the file it is written to.
+ */
+class source_manifest {
+public:
+    enum class kind {
+        /// A file directly within src/, which is built into an executable of the same name
+        exe,
+        /// Any other file below src/, or below include/, which is built into the library
+        lib,
+    };
+
+    /// Where `pf_auto()` looks for the manifest of a project
+    static fs::path path(fs::path const& project_dir) {
+        return project_dir / "cmake" / "pf_sources.cmake";
+    }
+
+    /**
+     * Whether the project in `project_dir` should have a manifest: If it has one already, or if
+     * its CMakeLists.txt calls `pf_auto()`.
+     */
+    static bool wanted(fs::path const& project_dir);
+
+    /**
+     * Collect every regular file below src/ of the project in `project_dir`, and below include/
+     * if it is a directory, as `pf_auto()` would glob for them. Files are added in order.
+     */
+    static source_manifest collect(fs::path const& project_dir);
+
+    /// The kind of `path`, which is relative to the directory `root` (either src/ or include/)
+    static kind classify(std::string_view root, std::string_view path) noexcept;
+
+    /// Add `path`, relative to the directory `root` of the project, to the list of its kind
+    void add(std::string_view root, std::string_view path);
+
+    /// The CMake code of the manifest
+    std::string render() const;
+
+    /**
+     * Write the manifest of the project in `project_dir`. The file is only rewritten if its
+     * content changes, so CMake only reconfigures when sources are added or removed. Returns
+     * `true` if the file was rewritten.
+     */
+    bool write(fs::path const& project_dir) const;
+
+private:
+    // The rendered entries of each list
+    std::string _exe;
+    std::string _lib;
+};
+
+/**
+ * Collect and write the manifest of the project in `project_dir`, if it is `wanted`. Every command
+ * that updates the sources of a project calls this, so the manifest does not go stale. Returns
+ * `true` if the file was rewritten.
+ */
+bool update_source_manifest(fs::path const& project_dir);
+
+}  // namespace pf
+
+#endif  // PF_EXISTING_SOURCE_MANIFEST_HPP_INCLUDED
@@ -0,0 +1,175 @@
+#include "./update_project.hpp"
+
+#include <pf/existing/project_config.hpp>
+#include <pf/existing/source_manifest.hpp>
+#include <pf/existing/update_source_files.hpp>
+#include <pf/util/task_pool.hpp>
+#include <pf/util/trace.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+
+namespace fs = pf::fs;
+
+namespace {
+
+bool is_project(fs::path const& dir) {
+    std::error_code ec;
+    return fs::is_regular_file(dir / "src" / "CMakeLists.txt", ec)
+        || fs::is_regular_file(pf::source_manifest::path(dir), ec);
+}
+
+class batch_update {
+    pf::update_options                     _project_opts;
+    pf::task_pool                          _pool;
+    std::mutex                             _results_mutex;
+    std::vector<pf::project_update_result> _results;
+
+    void _update(fs::path const& project_dir) {
+        auto result = pf::update_project(project_dir, _project_opts);
+        std::lock_guard lk{_results_mutex};
+        _results.push_back(std::move(result));
+    }
+
+    void _walk(fs::path const& dir) {
+        if (::is_project(dir)) {
+            _update(dir);
+            return;
+        }
+        std::error_code ec;
+        if (fs::exists(dir / "CMakeCache.txt", ec)) {
+            // A build directory: Anything in here is generated, not a project of its own
+            return;
+        }
+        // Directories we cannot read cannot contain projects we could update, so skip them
+        for (fs::directory_iterator it{dir, ec}, stop; !ec && it != stop; it.increment(ec)) {
+            auto const& entry = *it;
+            auto const  name  = entry.path().filename().string();
+            if (name.empty() || name[0] == '.') {
+                continue;
+            }
+            if (!entry.is_symlink(ec) && entry.is_directory(ec)) {
+                _pool.submit([this, subdir = entry.path()] { _walk(subdir); });
+            }
+        }
+    }
+
+public:
+    batch_update(pf::update_options const& project_opts, unsigned jobs)
+        : _project_opts{project_opts}
+        , _pool{jobs} {}
+
+    std::vector<pf::project_update_result> run(fs::path const& base_dir) {
+        _pool.submit([this, base_dir] { _walk(base_dir); });
+        _pool.wait();
+        std::sort(_results.begin(), _results.end(), [](auto const& lhs, auto const& rhs) {
+            return lhs.project_dir < rhs.project_dir;
+        });
+        return std::move(_results);
+    }
+};
+
+}  // namespace
+
+pf::project_update_result pf::update_project(fs::path const&       project_dir,
+                                             update_options const& opts) {
+    pf::trace::span       span{"update_project", project_dir};
+    project_update_result result;
+    result.project_dir = project_dir;
+
+    auto const start = std::chrono::steady_clock::now();
+
+    pf::glob_options glob_opts;
+    glob_opts.jobs  = opts.jobs;
+    glob_opts.stats = opts.stats;
+    try {
+        auto const patterns
+            = pf::source_patterns_for(pf::load_project_config(project_dir), opts.source_patterns);
+        glob_opts.patterns = &patterns;
+
+        // The tree is only walked for sources that the git index does not have
+        auto const walk       = !opts.from_git_index || opts.include_untracked;
+        auto const index_path = pf::source_index::default_path(project_dir);
+        auto       index      = opts.use_index && walk
+                       ? pf::source_index::load(project_dir, index_path)
+                       : pf::source_index{project_dir};
+
+        std::optional<pf::git_index> git_index;
+        // The project directory, relative to the working tree
+        std::string git_prefix;
+        if (opts.from_git_index) {
+            auto const repo = pf::find_git_repository(project_dir);
+            if (!repo) {
+                throw std::runtime_error("Not in a git repository: " + project_dir.string());
+            }
+            git_index  = pf::git_index::load(repo->index_file(), repo->hash_size);
+            git_prefix = fs::weakly_canonical(project_dir)
+                             .lexically_relative(repo->work_tree)
+                             .generic_string();
+            git_prefix = git_prefix == "." ? "" : git_prefix + "/";
+        }
+
+        // Sources are streamed into a set relative to their directory, which is what the
+        // CMakeLists.txt lists, and which only takes so much memory
+        auto const find_sources = [&](fs::path const& dir) {
+            pf::path_set sources{opts.source_memory_limit};
+            auto const   add = [&](pf::source_entry const& source) {
+                sources.insert_in(source.dir, source.name);
+            };
+            if (git_index) {
+                auto const root = git_prefix + dir.filename().string();
+                pf::for_each_tracked_source(*git_index, root, patterns, add);
+            }
+            if (walk) {
+                index.for_each_source(dir, glob_opts, add);
+            }
+            return sources;
+        };
+        auto const exists = [&](fs::path const& path) {
+            return opts.stats ? opts.stats->exists(path) : fs::exists(path);
+        };
+
+        // A project built with pf_auto() need not have a src/CMakeLists.txt at all
+        auto const src_dir  = project_dir / "src";
+        auto const manifest = pf::source_manifest::wanted(project_dir);
+        if (!manifest || exists(src_dir / "CMakeLists.txt")) {
+            pf::update_source_files(src_dir / "CMakeLists.txt", find_sources(src_dir));
+        }
+
+        auto const tests_dir = project_dir / "tests";
+        if (exists(tests_dir)) {
+            pf::update_source_files(tests_dir / "CMakeLists.txt", find_sources(tests_dir));
+        }
+
+        if (manifest) {
+            pf::update_source_manifest(project_dir);
+        }
+
+        if (opts.use_index && index.dirty()) {
+            std::error_code ec;
+            index.save(index_path, ec);
+            if (ec) {
+                // Not fatal: The next update will just have to scan everything again
+                result.index_error = ec.message();
+            }
+        }
+    } catch (const std::exception& e) {
+        // Such as std::system_error, errors in the project's config, or std::bad_alloc. Whatever
+        // it is, it belongs to this project, and must not stop the others from being updated.
+        result.error = e.what();
+    }
+
+    result.elapsed = std::chrono::steady_clock::now() - start;
+    return result;
+}
+
+std::vector<pf::project_update_result> pf::update_all_projects(fs::path const&       base_dir,
+                                                               update_options const& opts) {
+    // The pool runs one project per thread, so each project is scanned serially
+    auto project_opts = opts;
+    project_opts.jobs = 1;
+    return ::batch_update{project_opts, opts.jobs}.run(base_dir);
+}
@@ -0,0 +1,77 @@
+#ifndef PF_EXISTING_UPDATE_PROJECT_HPP_INCLUDED
+#define PF_EXISTING_UPDATE_PROJECT_HPP_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <pf/fs.hpp>
+
+namespace pf {
+
+struct update_options {
+    /**
+     * For a single project, the number of threads used to scan for sources. For
+     * `update_all_projects`, the number of projects updated at once. Zero means one per CPU.
+     */
+    unsigned jobs = 0;
+    /// Read and write the project's source index (see `source_index::default_path`)
+    bool use_index = true;
+    /// If set, filesystem queries are made through this cache
+    stat_cache* stats = nullptr;
+    /// Globs that select sources, applied after those of each project's config
+    std::vector<std::string> source_patterns;
+    /**
+     * The memory that the sources of each CMakeLists.txt may take up before they are spilled to
+     * temporary files (see `path_set`)
+     */
+    std::size_t source_memory_limit = path_set::default_memory_limit;
+    /**
+     * Take the sources from the index of the git repository that holds the project (see
+     * `git_index`), rather than walking the tree. This only finds sources that git tracks.
+     */
+    bool from_git_index = false;
+    /**
+     * With `from_git_index`, also walk the tree for sources that git does not track yet. The walk
+     * uses the source index, if `use_index` is set, so it only lists directories that changed.
+     */
+    bool include_untracked = false;
+};
+
+struct project_update_result {
+    fs::path                            project_dir;
+    std::chrono::steady_clock::duration elapsed{};
+    /// Why the project could not be updated. Empty on success.
+    std::string error;
+    /// Why the source index could not be saved. This does not cause the update to fail.
+    std::string index_error;
+
+    bool ok() const noexcept { return error.empty(); }
+};
+
+/**
+ * Update the source lists in src/CMakeLists.txt, and in tests/CMakeLists.txt if there is a tests/
+ * directory, of the project rooted at `project_dir`. The sources are selected by the globs of the
+ * project's config (see `project_config`) and `opts`. Failures are reported in the result rather
+ * than thrown.
+ *
+ * For a project built with `pf_auto()`, its `source_manifest` is also updated (see
+ * `update_source_manifest`), and src/CMakeLists.txt is only updated if there is one.
+ */
+project_update_result update_project(fs::path const& project_dir, update_options const& opts);
+
+/**
+ * Find every project below `base_dir` (any directory with a src/CMakeLists.txt, or with a
+ * `source_manifest`) and update it as with `update_project`. Hidden directories, CMake build
+ * directories, and the contents of projects are not searched for further projects.
+ *
+ * Discovery and the updates share a single thread pool, so updates start as soon as a project is
+ * found. Each project is scanned by a single thread. The results are sorted by project directory.
+ */
+std::vector<project_update_result> update_all_projects(fs::path const&       base_dir,
+                                                       update_options const& opts);
+
+}  // namespace pf
+
+#endif  // PF_EXISTING_UPDATE_PROJECT_HPP_INCLUDED
@@ -1,12 +1,11 @@
 #include "./update_source_files.hpp"
 
+#include <pf/existing/cmake_lexer.hpp>
+#include <pf/util/trace.hpp>
+
 #include <algorithm>
 #include <cctype>
-#include <fstream>
 #include <iterator>
-#include <sstream>
-#include <tuple>
-#include <utility>
 
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/spdlog.h>
@@ -15,70 +14,69 @@ namespace fs = pf::fs;
 
 namespace {
 
-std::vector<std::string> relative_source_strings(std::vector<fs::path> const& source_files,
-                                                 fs::path const&              base_dir) {
-    std::vector<std::string> source_strings;
-    source_strings.reserve(source_files.size());
-
-    std::transform(source_files.begin(),
-                   source_files.end(),
-                   std::back_inserter(source_strings),
-                   [&base_dir](auto const& path) {
-                       auto result = fs::relative(path, base_dir).string();
-                       // TODO: evaluate if replacing `\` in filenames might cause a problem
-                       std::replace(result.begin(), result.end(), '\\', '/');
-
-                       return result;
-                   });
-
-    return source_strings;
-}
-
-constexpr std::string_view SourcesComment = "# sources\n";
-
-auto find_next_function(std::string::iterator begin, std::string::iterator end) {
-    // BUG: fails for ( in a comment.
-    // TODO: use a proper CMake parser, or otherwise improve this
-    return std::find(begin, end, '(');
-}
-
-auto find_end_function(std::string::iterator begin, std::string::iterator end) {
-    return std::find(begin, end, ')');
-}
-
-// Assumes we are in the root location of a CMakeLists.txt
-auto find_insertion_indicator_comment(std::string::iterator begin_fn,
-                                      std::string::iterator end_fn) {
-    auto const insertion_comment
-        = std::search(begin_fn, end_fn, SourcesComment.begin(), SourcesComment.end());
-
-    return insertion_comment;
+/**
+ * Collect the sources relative to `base_dir`, with '/' separators. A source below `base_dir`, as
+ * are those found by globbing it, is made relative by dropping the prefix, rather than with
+ * `fs::relative`, which consults the filesystem.
+ */
+pf::path_trie relative_source_trie(std::vector<fs::path> const& source_files,
+                                   fs::path const&              base_dir) {
+    pf::trace::span span{"relative_source_trie"};
+    pf::path_trie   trie;
+
+#if !defined(_WIN32)
+    std::string_view const base        = base_dir.native();
+    auto                   prefix_size = base.size();
+    if (!base.empty() && base.back() != '/') {
+        ++prefix_size;
+    }
+#endif
+    for (auto const& path : source_files) {
+#if !defined(_WIN32)
+        std::string_view const native = path.native();
+        if (native.size() > prefix_size && native.substr(0, base.size()) == base
+            && native[prefix_size - 1] == '/') {
+            trie.insert(native.substr(prefix_size));
+            continue;
+        }
+#endif
+        auto result = fs::relative(path, base_dir).string();
+        // TODO: evaluate if replacing `\` in filenames might cause a problem
+        std::replace(result.begin(), result.end(), '\\', '/');
+        trie.insert(result);
+    }
+    return trie;
 }
 
-auto get_indent_at_indicator_comment(std::string::iterator                  insertion_comment,
-                                     std::string::iterator                  begin_fn,
-                                     [[maybe_unused]] std::string::iterator end_fn) {
-    auto const begin_of_line = std::find_if(std::make_reverse_iterator(insertion_comment),
-                                            std::make_reverse_iterator(begin_fn),
-                                            [](char c) { return c == '\n' || !std::isspace(c); })
-                                   .base();
-
-    auto indent_begin = begin_of_line;
-    auto indent_end   = insertion_comment;
-
-    return std::string{indent_begin, indent_end};
-}
+constexpr std::string_view SourcesComment = "# sources";
+
+// A source list to be replaced: Everything in [begin, end) is dropped in favor of the sources
+struct source_list_edit {
+    std::size_t      begin;
+    std::size_t      end;
+    std::string_view indent;
+    // The existing list is empty, so we need to insert a newline to separate it from the ')'
+    bool needs_newline;
+};
+
+/**
+ * Find the source list within the command invocation whose first argument token is at
+ * `args_begin` and whose closing parenthesis is at `close_paren`. The list begins after the
+ * `# sources` line comment at `comment`.
+ */
+source_list_edit find_source_list(std::string_view cmakelists,
+                                  std::size_t      comment,
+                                  std::size_t      args_begin,
+                                  std::size_t      close_paren) {
+    // The indent is the whitespace leading up to the comment on its line
+    auto indent_begin = comment;
+    while (indent_begin > args_begin && cmakelists[indent_begin - 1] != '\n'
+           && std::isspace(static_cast<unsigned char>(cmakelists[indent_begin - 1]))) {
+        --indent_begin;
+    }
 
-auto find_insertion_location(std::string::iterator                  insertion_comment,
-                             [[maybe_unused]] std::string::iterator begin_fn,
-                             [[maybe_unused]] std::string::iterator end_fn) {
-    return std::next(insertion_comment, SourcesComment.size());
-}
+    auto const list_begin = comment + SourcesComment.size() + 1;
 
-auto erase_existing_sources(std::string&          cmakelists,
-                            std::string::iterator insertion_point,
-                            std::string::iterator begin_fn,
-                            std::string::iterator end_fn) {
     // We don't delete until the end of the ')', but until the last source-list character,
     // meaning:
     // ...
@@ -88,67 +86,117 @@ auto erase_existing_sources(std::string&          cmakelists,
     // ... Gets turned into:
     // # sources
     //  )
-    auto last_source_list_char = std::find_if_not(std::make_reverse_iterator(end_fn),
-                                                  std::make_reverse_iterator(begin_fn),
-                                                  [](char c) { return std::isblank(c); });
-    if (*last_source_list_char == '\n') {
-        ++last_source_list_char;
+    auto list_end = close_paren;
+    while (list_end > args_begin
+           && std::isblank(static_cast<unsigned char>(cmakelists[list_end - 1]))) {
+        --list_end;
+    }
+    if (cmakelists[list_end - 1] == '\n') {
+        --list_end;
     }
 
-    if (last_source_list_char.base() <= insertion_point) {
+    auto const indent = cmakelists.substr(indent_begin, comment - indent_begin);
+    if (list_end <= list_begin) {
         // If the source list is empty, we need to ensure there's a newline separating it
         // from the rest
-        return cmakelists.insert(insertion_point, '\n');
+        return {list_begin, list_begin, indent, true};
     }
-    return cmakelists.erase(insertion_point, last_source_list_char.base());
+    return {list_begin, list_end, indent, false};
 }
 
-auto insert_sources(std::string&                    cmakelists,
-                    std::string::iterator           insertion_point,
-                    std::vector<std::string> const& sources,
-                    std::string const&              indent) {
-    bool first_iteration = true;
-
-    for (auto const& source : sources) {
-        if (!first_iteration) {
-            insertion_point = std::next(cmakelists.insert(insertion_point, '\n'));
-        } else {
-            first_iteration = false;
+/**
+ * Find every source list in the file, using at most one per top-level command invocation.
+ */
+std::vector<source_list_edit> find_source_lists(std::string_view cmakelists) {
+    using kind = pf::cmake_token_kind;
+
+    std::vector<source_list_edit> edits;
+
+    pf::cmake_lexer lexer{cmakelists};
+    int             depth      = 0;
+    std::size_t     args_begin = 0;
+    std::size_t     comment    = cmakelists.npos;
+    std::size_t     candidate  = cmakelists.npos;
+    for (auto tok = lexer.next(); tok.kind != kind::eof; tok = lexer.next()) {
+        // The comment only counts if nothing follows it on its line
+        if (tok.kind == kind::newline && candidate != cmakelists.npos
+            && comment == cmakelists.npos) {
+            comment = candidate;
+        }
+        candidate = cmakelists.npos;
+
+        switch (tok.kind) {
+        case kind::line_comment:
+            if (depth > 0 && tok.text == SourcesComment) {
+                candidate = tok.offset;
+            }
+            break;
+        case kind::open_paren:
+            if (depth++ == 0) {
+                args_begin = tok.offset + 1;
+                comment    = cmakelists.npos;
+            }
+            break;
+        case kind::close_paren:
+            if (depth > 0 && --depth == 0 && comment != cmakelists.npos) {
+                edits.push_back(find_source_list(cmakelists, comment, args_begin, tok.offset));
+            }
+            break;
+        default:
+            break;
         }
-
-        insertion_point
-            = std::next(cmakelists.insert(insertion_point, indent.begin(), indent.end()),
-                        indent.size());
-        insertion_point
-            = std::next(cmakelists.insert(insertion_point, source.begin(), source.end()),
-                        source.size());
     }
-
-    return insertion_point;
+    return edits;
 }
 
-std::pair<std::string::iterator, std::string::iterator>
-write_sources(std::string&                    cmakelists,
-              std::vector<std::string> const& source_strings,
-              std::string::iterator           insertion_comment,
-              std::string::iterator           begin_fn,
-              std::string::iterator           end_fn) {
-    std::string const indent
-        = ::get_indent_at_indicator_comment(insertion_comment, begin_fn, end_fn);
-    auto insertion_point = ::find_insertion_location(insertion_comment, begin_fn, end_fn);
-
-    // Note: invalidates other iterators
-    insertion_point = ::erase_existing_sources(cmakelists, insertion_point, begin_fn, end_fn);
-
-    auto const end_insertion
-        = ::insert_sources(cmakelists, insertion_point, source_strings, indent);
-    return std::pair{end_insertion, cmakelists.end()};
-}
+/**
+ * Replace the source lists with the sources passed to the callback given to `for_each_source`,
+ * which is called once to size the output, and once more for each list.
+ */
+template <typename ForEachSource>
+std::string rewrite_source_lists(std::string_view cmakelists, ForEachSource&& for_each_source) {
+    pf::trace::span span{"rewrite_source_lists"};
+    auto const      edits = ::find_source_lists(cmakelists);
+
+    // Size the output up front, so it is written in a single pass without reallocating
+    std::size_t n_sources = 0;
+    std::size_t list_size = 0;
+    for_each_source([&](std::string_view source) {
+        ++n_sources;
+        list_size += source.size() + 1;
+    });
+    std::size_t out_size = cmakelists.size();
+    for (auto const& edit : edits) {
+        out_size += list_size + n_sources * edit.indent.size() + 1;
+        out_size -= edit.end - edit.begin;
+    }
 
-}  // namespace
+    std::string out;
+    out.reserve(out_size);
+    std::size_t pos = 0;
+    for (auto const& edit : edits) {
+        out.append(cmakelists, pos, edit.begin - pos);
+        bool first_iteration = true;
+        for_each_source([&](std::string_view source) {
+            if (!first_iteration) {
+                out.push_back('\n');
+            }
+            first_iteration = false;
+            out.append(edit.indent);
+            out.append(source);
+        });
+        if (edit.needs_newline) {
+            out.push_back('\n');
+        }
+        pos = edit.end;
+    }
+    out.append(cmakelists, pos);
+    return out;
+}
 
-void pf::update_source_files(fs::path const&              cmakelists_file,
-                             std::vector<fs::path> const& source_files) {
+template <typename Sources>
+bool update_source_files(fs::path const& cmakelists_file, Sources const& sources) {
+    pf::trace::span span{"update_source_files", cmakelists_file};
     if (!fs::exists(cmakelists_file)) {
         throw std::system_error{
             std::make_error_code(std::errc::no_such_file_or_directory),
@@ -156,32 +204,47 @@ void pf::update_source_files(fs::path const&              cmakelists_file,
         };
     }
 
-    std::string cmakelists = pf::slurp_file(cmakelists_file);
+    std::string updated;
+    {
+        // Unmap the file before we replace it
+        auto const cmakelists = pf::map_file(cmakelists_file);
+        updated               = pf::rewrite_source_lists(cmakelists.view(), sources);
+    }
 
-    std::vector<std::string> const source_strings
-        = ::relative_source_strings(source_files, cmakelists_file.parent_path());
+    return pf::write_file(cmakelists_file, updated, pf::write_mode::atomic_if_changed);
+}
 
-    std::string const cmakelists_cpy = cmakelists;
+}  // namespace
 
-    auto begin = cmakelists.begin();
-    auto end   = cmakelists.end();
+std::string pf::rewrite_source_lists(std::string_view                cmakelists,
+                                     std::vector<std::string> const& sources) {
+    return ::rewrite_source_lists(cmakelists, [&](auto&& fn) {
+        for (auto const& source : sources) {
+            fn(std::string_view{source});
+        }
+    });
+}
 
-    while (begin != end) {
-        auto const begin_fn          = ::find_next_function(begin, end);
-        auto const end_fn            = ::find_end_function(begin_fn, end);
-        auto const insertion_comment = ::find_insertion_indicator_comment(begin_fn, end_fn);
+std::string pf::rewrite_source_lists(std::string_view cmakelists, path_trie const& sources) {
+    return ::rewrite_source_lists(cmakelists, [&](auto&& fn) { sources.for_each(fn); });
+}
 
-        if (insertion_comment == end_fn) {
-            begin = end_fn;
-            continue;
-        }
+std::string pf::rewrite_source_lists(std::string_view cmakelists, path_set const& sources) {
+    // The runs are merged as the lists are written, so the sources are never all in memory at once
+    return ::rewrite_source_lists(cmakelists, [&](auto&& fn) { sources.for_each(fn); });
+}
 
-        std::tie(begin, end)
-            = ::write_sources(cmakelists, source_strings, insertion_comment, begin_fn, end_fn);
-    }
+bool pf::update_source_files(fs::path const& cmakelists_file, path_trie const& sources) {
+    return ::update_source_files(cmakelists_file, sources);
+}
 
-    if (cmakelists != cmakelists_cpy) {
-        std::fstream cmakelists_out = pf::open(cmakelists_file, std::ios::trunc | std::ios::out);
-        cmakelists_out << cmakelists;
-    }
+bool pf::update_source_files(fs::path const& cmakelists_file, path_set const& sources) {
+    return ::update_source_files(cmakelists_file, sources);
+}
+
+bool pf::update_source_files(fs::path const&              cmakelists_file,
+                             std::vector<fs::path> const& source_files) {
+    return pf::update_source_files(cmakelists_file,
+                                   ::relative_source_trie(source_files,
+                                                          cmakelists_file.parent_path()));
 }
@@ -1,13 +1,38 @@
 #ifndef PF_EXISTING_UPDATE_SOURCE_FILES_HPP_INCLUDED
 #define PF_EXISTING_UPDATE_SOURCE_FILES_HPP_INCLUDED
 
+#include <string>
+#include <string_view>
 #include <vector>
 
 #include <pf/fs.hpp>
 
 namespace pf {
 
-void update_source_files(fs::path const& cmakelists_file, std::vector<fs::path> const& sources);
+/**
+ * Replace the list following each `# sources` comment in the given CMake code with `sources`.
+ *
+ * The comment must be within a command invocation and end its line. The list runs from the line
+ * after the comment up to the invocation's closing parenthesis, and the new entries take the
+ * indentation of the comment. Only the first such comment in each invocation is used. Parentheses
+ * and comment markers within comments, strings, and bracket arguments are handled correctly.
+ */
+std::string rewrite_source_lists(std::string_view                cmakelists,
+                                 std::vector<std::string> const& sources);
+std::string rewrite_source_lists(std::string_view cmakelists, path_trie const& sources);
+std::string rewrite_source_lists(std::string_view cmakelists, path_set const& sources);
+
+/**
+ * Update the source lists in the given CMakeLists.txt (as with `rewrite_source_lists`) to refer
+ * to the given source files, in order. The paths in `sources` are relative to the directory of
+ * the CMakeLists.txt. The file is only rewritten if its content changes, and is replaced
+ * atomically when it is. Returns `true` if the file was rewritten.
+ */
+bool update_source_files(fs::path const& cmakelists_file, path_trie const& sources);
+bool update_source_files(fs::path const& cmakelists_file, path_set const& sources);
+
+/// As above, with the full paths of the sources. They are listed in order regardless.
+bool update_source_files(fs::path const& cmakelists_file, std::vector<fs::path> const& sources);
 
 }  // namespace pf
 
@@ -1,13 +1,50 @@
 #include "./file_template.hpp"
 
+#include <pf/util/trace.hpp>
+
+#include <cmrc/cmrc.hpp>
 #include <spdlog/fmt/ostr.h>
 
-std::string pf::template_renderer::render(const std::string& inpath) const {
-    auto res      = _fs.open(inpath);
-    auto mustache = kainjow::mustache::mustache{{res.begin(), res.end()}};
-    if (!mustache.is_valid()) {
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+CMRC_DECLARE(pf_templates);
+
+pf::compiled_template::compiled_template(const std::string& name, const std::string& source)
+    : _mustache(source) {
+    if (!_mustache.is_valid()) {
         throw std::runtime_error(
-            fmt::format("Error loading template file: {}: {}", inpath, mustache.error_message()));
+            fmt::format("Error loading template file: {}: {}", name, _mustache.error_message()));
     }
-    return mustache.render(_template_data);
+}
+
+const pf::compiled_template& pf::get_template(const std::string& respath) {
+    static std::shared_mutex mutex;
+    // Entries are never removed, and the nodes do not move, so references remain valid
+    static std::unordered_map<std::string, std::unique_ptr<const compiled_template>> cache;
+
+    {
+        std::shared_lock lk{mutex};
+        auto             found = cache.find(respath);
+        if (found != cache.end()) {
+            return *found->second;
+        }
+    }
+
+    // Parse outside of the lock. If another thread beats us to it, we use its copy instead.
+    pf::trace::span span{"parse_template", respath};
+    auto res    = cmrc::pf_templates::get_filesystem().open(respath);
+    auto parsed = std::make_unique<const compiled_template>(respath,
+                                                            std::string{res.begin(), res.end()});
+
+    std::unique_lock lk{mutex};
+    auto             inserted = cache.emplace(respath, std::move(parsed));
+    return *inserted.first->second;
+}
+
+std::string pf::template_renderer::render(const std::string& inpath) const {
+    pf::trace::span span{"render_template", inpath};
+    return pf::get_template(inpath).render(_context);
 }
@@ -3,27 +3,62 @@
 
 #include <pf/fs.hpp>
 
-#include <cmrc/cmrc.hpp>
 #include <kainjow/mustache.hpp>
 
+#include <ostream>
 #include <string>
 
 namespace pf {
 
-class template_renderer {
-    fs::path                  _base_dir;
-    kainjow::mustache::data   _template_data;
-    cmrc::embedded_filesystem _fs;
+/**
+ * The data that templates are rendered with. Only strings and booleans may be set, which keeps
+ * rendering free of side effects (see `compiled_template`).
+ */
+class render_context {
+    kainjow::mustache::data _data;
 
 public:
-    template_renderer(fs::path dir, cmrc::embedded_filesystem fs)
-        : _base_dir(dir)
-        , _fs(fs) {}
+    void set(const std::string& key, const std::string& value) { _data.set(key, value); }
+    // Without this, string literals would pick the `bool` overload
+    void set(const std::string& key, const char* value) { _data.set(key, std::string{value}); }
+    void set(const std::string& key, bool value) { _data.set(key, value); }
+
+    const kainjow::mustache::data& data() const noexcept { return _data; }
+};
+
+/**
+ * A parsed template. Rendering only modifies a mustache template when it encounters lambdas or
+ * partials, which a `render_context` cannot hold, so a compiled_template may be rendered from
+ * many threads at once.
+ */
+class compiled_template {
+    mutable kainjow::mustache::mustache _mustache;
+
+public:
+    /// Parse the template. Throws `std::runtime_error` if it is invalid.
+    compiled_template(const std::string& name, const std::string& source);
 
-    template <typename Key, typename What>
-    void set(Key&& k, What&& w) {
-        _template_data.set(k, std::forward<What>(w));
+    std::string render(const render_context& ctx) const { return _mustache.render(ctx.data()); }
+    /// Render straight into `out`, without building the whole result in memory
+    std::ostream& render(const render_context& ctx, std::ostream& out) const {
+        return _mustache.render(ctx.data(), out);
     }
+};
+
+/**
+ * Get the embedded template resource at `respath`, parsing it on first use. The templates are
+ * cached for the lifetime of the process. Safe to call from multiple threads.
+ */
+const compiled_template& get_template(const std::string& respath);
+
+class template_renderer {
+    fs::path              _base_dir;
+    const render_context& _context;
+
+public:
+    template_renderer(fs::path dir, const render_context& ctx)
+        : _base_dir(dir)
+        , _context(ctx) {}
 
     std::string render(const std::string& inpath) const;
     void        render_to_file(const std::string& respath, const fs::path& outpath) const {
@@ -34,4 +69,4 @@ public:
 
 }  // namespace pf
 
-#endif  // FILE_TEMPLATE_HPP_INCLUDED
\ No newline at end of file
+#endif  // FILE_TEMPLATE_HPP_INCLUDED
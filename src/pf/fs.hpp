@@ -3,6 +3,17 @@
 
 #include <pf/fs/ascending_iterator.hpp>
 #include <pf/fs/core.hpp>
+#include <pf/fs/dir_reader.hpp>
+#include <pf/fs/git_index.hpp>
 #include <pf/fs/glob.hpp>
+#include <pf/fs/ignore_rules.hpp>
+#include <pf/fs/path_set.hpp>
+#include <pf/fs/path_sort.hpp>
+#include <pf/fs/path_trie.hpp>
+#include <pf/fs/source_index.hpp>
+#include <pf/fs/source_patterns.hpp>
+#include <pf/fs/source_watcher.hpp>
+#include <pf/fs/stat_cache.hpp>
+#include <pf/fs/tree_diff.hpp>
 
 #endif  // PF_FS_HPP_INCLUDED
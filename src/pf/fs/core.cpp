@@ -1,6 +1,19 @@
 #include "./core.hpp"
 
-#include <sstream>
+#include <pf/util/trace.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <utility>
+
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace fs = pf::fs;
 
@@ -17,13 +30,347 @@ std::fstream pf::open(const fs::path& filepath, std::ios::openmode mode, std::er
     return ret;
 }
 
+pf::mapped_file::mapped_file(mapped_file&& other) noexcept
+    : _data(std::exchange(other._data, nullptr))
+    , _size(std::exchange(other._size, 0))
+    , _buffer(std::move(other._buffer))
+    , _mapped(std::exchange(other._mapped, false)) {
+    if (!_mapped) {
+        // The buffer's storage may have moved (or been stored inline)
+        _data = _buffer.data();
+    }
+}
+
+pf::mapped_file& pf::mapped_file::operator=(mapped_file&& other) noexcept {
+    // Our old contents are released when `tmp` is destroyed
+    mapped_file tmp{std::move(other)};
+    std::swap(_data, tmp._data);
+    std::swap(_size, tmp._size);
+    std::swap(_mapped, tmp._mapped);
+    _buffer.swap(tmp._buffer);
+    if (!_mapped) {
+        _data = _buffer.data();
+    }
+    return *this;
+}
+
+pf::mapped_file::~mapped_file() {
+#if !defined(_WIN32)
+    if (_mapped) {
+        ::munmap(const_cast<char*>(_data), _size);
+    }
+#endif
+}
+
+std::string pf::mapped_file::release_string() && {
+    if (!_mapped) {
+        _data = nullptr;
+        _size = 0;
+        return std::move(_buffer);
+    }
+    return std::string{view()};
+}
+
+#if defined(_WIN32)
+
+pf::mapped_file pf::map_file(const fs::path& path, std::error_code& ec) {
+    mapped_file ret;
+    auto        size = fs::file_size(path, ec);
+    if (ec) {
+        return ret;
+    }
+    auto file = pf::open(path, std::ios::in | std::ios::binary, ec);
+    if (ec) {
+        return ret;
+    }
+    ret._buffer.resize(size);
+    file.read(ret._buffer.data(), static_cast<std::streamsize>(size));
+    ret._data = ret._buffer.data();
+    ret._size = ret._buffer.size();
+    pf::trace::add(pf::trace::counter::bytes_read, ret._size);
+    return ret;
+}
+
+#else
+
+namespace {
+
+struct fd_closer {
+    int fd;
+    ~fd_closer() { ::close(fd); }
+};
+
+// Read until EOF, appending to `out`. Used when the size is not known up front.
+void read_all(int fd, std::string& out, std::error_code& ec) {
+    constexpr std::size_t chunk = 64 * 1024;
+    while (true) {
+        auto old_size = out.size();
+        out.resize(old_size + chunk);
+        auto n = ::read(fd, out.data() + old_size, chunk);
+        if (n < 0) {
+            if (errno == EINTR) {
+                out.resize(old_size);
+                continue;
+            }
+            ec = std::error_code{errno, std::system_category()};
+            return;
+        }
+        out.resize(old_size + static_cast<std::size_t>(n));
+        if (n == 0) {
+            return;
+        }
+    }
+}
+
+}  // namespace
+
+pf::mapped_file pf::map_file(const fs::path& path, std::error_code& ec) {
+    mapped_file ret;
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ec = std::error_code{errno, std::system_category()};
+        return ret;
+    }
+    fd_closer closer{fd};
+
+    struct ::stat st;
+    if (::fstat(fd, &st) != 0) {
+        ec = std::error_code{errno, std::system_category()};
+        return ret;
+    }
+
+    if (!S_ISREG(st.st_mode) || st.st_size == 0) {
+        // Pipes and the like: We cannot know the size ahead of time. Nor for the files of procfs,
+        // sysfs, and some FUSE filesystems, which report a size of zero whatever they hold.
+        read_all(fd, ret._buffer, ec);
+        ret._data = ret._buffer.data();
+        ret._size = ret._buffer.size();
+        pf::trace::add(pf::trace::counter::bytes_read, ret._size);
+        return ret;
+    }
+
+    auto const size = static_cast<std::size_t>(st.st_size);
+    if (size >= mapped_file::map_threshold) {
+        auto ptr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED) {
+            ret._data   = static_cast<const char*>(ptr);
+            ret._size   = size;
+            ret._mapped = true;
+            pf::trace::add(pf::trace::counter::bytes_read, size);
+            return ret;
+        }
+        // Fall back to reading the file if it cannot be mapped
+    }
+
+    ret._buffer.resize(size);
+    std::size_t n_read = 0;
+    while (n_read < size) {
+        auto n = ::read(fd, ret._buffer.data() + n_read, size - n_read);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ec = std::error_code{errno, std::system_category()};
+            return ret;
+        }
+        if (n == 0) {
+            // The file shrank after we checked its size
+            ret._buffer.resize(n_read);
+            break;
+        }
+        n_read += static_cast<std::size_t>(n);
+    }
+    ret._data = ret._buffer.data();
+    ret._size = ret._buffer.size();
+    pf::trace::add(pf::trace::counter::bytes_read, ret._size);
+    return ret;
+}
+
+#endif
+
 std::string pf::slurp_file(const fs::path& path, std::error_code& ec) {
-    auto file = pf::open(path, std::ios::in, ec);
+    auto file = pf::map_file(path, ec);
     if (ec) {
         return std::string{};
     }
+    return std::move(file).release_string();
+}
 
-    std::ostringstream out;
-    out << file.rdbuf();
-    return std::move(out).str();
+namespace {
+
+// Check whether the file already holds exactly `content`. A file that cannot be read differs.
+bool has_content(const fs::path& path, std::string_view content) {
+    std::error_code ec;
+    // Comparing sizes costs only a stat(), and rules out most changes
+    auto size = fs::file_size(path, ec);
+    if (ec || size != content.size()) {
+        return false;
+    }
+    auto existing = pf::map_file(path, ec);
+    return !ec && existing.view() == content;
+}
+
+// The file that a write to `path` lands in. Writing through a symlink writes to its target, where
+// a rename over the link would replace the link itself.
+fs::path write_target(fs::path path, std::error_code& ec) {
+    // As many links as Linux follows, so that a cycle is an error rather than a hang
+    for (auto hops = 0; hops < 40; ++hops) {
+        std::error_code status_ec;
+        if (!fs::is_symlink(fs::symlink_status(path, status_ec))) {
+            return path;
+        }
+        auto target = fs::read_symlink(path, ec);
+        if (ec) {
+            return {};
+        }
+        path = target.is_absolute() ? target : path.parent_path() / target;
+    }
+    ec = std::make_error_code(std::errc::too_many_symbolic_link_levels);
+    return {};
+}
+
+// Pick a name in the same directory as `path`, so that renaming it over `path` is atomic
+fs::path temp_path_for(const fs::path& path) {
+    static std::atomic<unsigned> counter{0};
+    auto                         tmp = path;
+    tmp += ".pf-tmp-";
+#if defined(_WIN32)
+    tmp += std::to_string(::_getpid());
+#else
+    tmp += std::to_string(::getpid());
+#endif
+    tmp += "-" + std::to_string(counter++);
+    return tmp;
+}
+
+#if defined(_WIN32)
+
+void write_atomic(const fs::path& path, std::string_view content, std::error_code& ec) {
+    auto const tmp = temp_path_for(path);
+    {
+        auto strm = pf::open(tmp, std::ios::out | std::ios::binary, ec);
+        if (ec) {
+            return;
+        }
+        strm.write(content.data(), static_cast<std::streamsize>(content.size()));
+        strm.flush();
+        if (!strm) {
+            ec = std::make_error_code(std::errc::io_error);
+        }
+    }
+    if (!ec) {
+        fs::rename(tmp, path, ec);
+    }
+    if (ec) {
+        std::error_code ignore;
+        fs::remove(tmp, ignore);
+    }
+}
+
+#else
+
+std::error_code last_error() { return std::error_code{errno, std::system_category()}; }
+
+// Write all of `content` to `fd`, retrying on short writes
+void write_all(int fd, std::string_view content, std::error_code& ec) {
+    while (!content.empty()) {
+        auto n = ::write(fd, content.data(), content.size());
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ec = last_error();
+            return;
+        }
+        content.remove_prefix(static_cast<std::size_t>(n));
+    }
+}
+
+void write_atomic(const fs::path& path, std::string_view content, std::error_code& ec) {
+    fs::path tmp;
+    int      fd = -1;
+    // O_EXCL guards against a leftover or concurrently created file of the same name
+    while (fd < 0) {
+        tmp = temp_path_for(path);
+        fd  = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (fd < 0 && errno != EEXIST) {
+            ec = last_error();
+            return;
+        }
+    }
+
+    write_all(fd, content, ec);
+    // Keep the permissions of the file we are replacing. New files get the default (umask'd) ones.
+    struct ::stat st;
+    if (!ec && ::stat(path.c_str(), &st) == 0 && ::fchmod(fd, st.st_mode & 07777) != 0) {
+        ec = last_error();
+    }
+    if (!ec && ::fsync(fd) != 0) {
+        ec = last_error();
+    }
+    if (::close(fd) != 0 && !ec) {
+        ec = last_error();
+    }
+    if (!ec && ::rename(tmp.c_str(), path.c_str()) != 0) {
+        ec = last_error();
+    }
+    if (ec) {
+        ::unlink(tmp.c_str());
+        return;
+    }
+
+    // Make the rename itself durable. This is best-effort, as not all filesystems support it.
+    auto dir = path.parent_path();
+    if (dir.empty()) {
+        dir = ".";
+    }
+    int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+}
+
+#endif
+
+}  // namespace
+
+bool pf::write_file(const fs::path&  path,
+                    std::string_view content,
+                    write_mode       mode,
+                    std::error_code& ec) {
+    if (mode == write_mode::overwrite) {
+        pf::write_file(path, content, ec);
+        if (!ec) {
+            pf::trace::add(pf::trace::counter::bytes_written, content.size());
+        }
+        return !ec;
+    }
+
+    if (::has_content(path, content)) {
+        ec = {};
+        return false;
+    }
+    auto const target = ::write_target(path, ec);
+    if (ec) {
+        return false;
+    }
+    std::error_code links_ec;
+    if (fs::hard_link_count(target, links_ec) > 1 && !links_ec) {
+        // A rename would only replace this one of the file's names, and split it from the others
+        pf::write_file(target, content, ec);
+    } else {
+        if (target.has_parent_path()) {
+            fs::create_directories(target.parent_path(), ec);
+            if (ec) {
+                return false;
+            }
+        }
+        ::write_atomic(target, content, ec);
+    }
+    if (!ec) {
+        pf::trace::add(pf::trace::counter::bytes_written, content.size());
+    }
+    return !ec;
 }
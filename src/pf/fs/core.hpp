@@ -1,9 +1,11 @@
 #ifndef PF_FS_CORE_HPP_INCLUDED
 #define PF_FS_CORE_HPP_INCLUDED
 
+#include <cstddef>
 #include <filesystem>
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <system_error>
 
 namespace pf {
@@ -53,6 +55,37 @@ void write_file(const fs::path& path, What&& w) {
     }
 }
 
+enum class write_mode {
+    /// Truncate the file and write the new content in place
+    overwrite,
+    /**
+     * Leave the file untouched (including its mtime) if it already has the given content.
+     * Otherwise, write to a temporary file in the same directory, flush it to disk, and rename it
+     * over the target, so readers see either the old or the new content but never a partial file.
+     * A symlink is written through, to its target. A file with more than one hard link is
+     * written in place, as a rename would split it from its other names.
+     */
+    atomic_if_changed,
+};
+
+/**
+ * Write the given content to a file, creating parent directories if necessary. Returns `true` if
+ * the file was written, or `false` if it was left untouched because its content was unchanged.
+ */
+bool write_file(const fs::path&  path,
+                std::string_view content,
+                write_mode       mode,
+                std::error_code& ec);
+
+inline bool write_file(const fs::path& path, std::string_view content, write_mode mode) {
+    std::error_code ec;
+    auto            written = pf::write_file(path, content, mode, ec);
+    if (ec) {
+        throw std::system_error{ec, "Failed to write file: " + path.string()};
+    }
+    return written;
+}
+
 /**
  * Slurp the entire contents of a file into a std::string.
  */
@@ -66,6 +99,55 @@ inline std::string slurp_file(const fs::path& path) {
     }
     return contents;
 }
+
+/**
+ * The read-only contents of a file. Large regular files are memory-mapped, while small files and
+ * non-regular files (such as pipes) are read into a buffer of exactly the required size.
+ *
+ * The view is only valid while the mapped_file is alive. The contents of a mapped file are
+ * undefined if it is modified by another process while mapped.
+ */
+class mapped_file {
+    const char* _data = nullptr;
+    std::size_t _size = 0;
+    // Non-empty for files that were read rather than mapped
+    std::string _buffer;
+    bool        _mapped = false;
+
+    friend mapped_file map_file(const fs::path&, std::error_code&);
+
+public:
+    /// Files smaller than this are read rather than mapped, as mapping costs more than a copy
+    static constexpr std::size_t map_threshold = 64 * 1024;
+
+    mapped_file() = default;
+    mapped_file(mapped_file&& other) noexcept;
+    mapped_file& operator=(mapped_file&& other) noexcept;
+    ~mapped_file();
+
+    const char*      data() const noexcept { return _data; }
+    std::size_t      size() const noexcept { return _size; }
+    std::string_view view() const noexcept { return std::string_view{_data, _size}; }
+    bool             is_mapped() const noexcept { return _mapped; }
+
+    /// Take the contents as a string. This is free if the file was not mapped.
+    std::string release_string() &&;
+};
+
+/**
+ * Map the contents of the given file. Fills out `ec` in case of failure.
+ */
+mapped_file map_file(const fs::path& path, std::error_code& ec);
+
+inline mapped_file map_file(const fs::path& path) {
+    std::error_code ec;
+    auto            file = pf::map_file(path, ec);
+    if (ec) {
+        throw std::system_error{ec, "Reading file: " + path.string()};
+    }
+    return file;
+}
+
 }  // namespace pf
 
 #endif  // PF_FS_CORE_HPP_INCLUDED
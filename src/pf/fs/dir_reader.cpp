@@ -0,0 +1,186 @@
+#include "./dir_reader.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace fs = pf::fs;
+
+#if !defined(__linux__)
+
+pf::dir_reader::dir_reader(fs::path) {
+    throw std::system_error{std::make_error_code(std::errc::not_supported),
+                            "Reading directories with getdents64 is only supported on Linux"};
+}
+
+pf::dir_reader::dir_reader(dir_reader const&, std::string const&, bool)
+    : dir_reader(fs::path{}) {}
+
+pf::dir_reader::~dir_reader() = default;
+
+bool pf::dir_reader::next(entry&) { return false; }
+
+fs::file_type pf::dir_reader::followed_type(entry const&) const { return fs::file_type::unknown; }
+
+#else
+
+namespace {
+
+// Large enough for a few thousand entries, so that most directories are read in a single call
+constexpr std::size_t BufferSize = 32 * 1024;
+
+// The layout getdents64 fills in. Not every libc declares it, so it is spelled out here.
+struct linux_dirent64 {
+    std::uint64_t  d_ino;
+    std::int64_t   d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[1];
+};
+
+fs::file_type type_of_mode(unsigned mode) {
+    switch (mode & S_IFMT) {
+    case S_IFDIR:
+        return fs::file_type::directory;
+    case S_IFREG:
+        return fs::file_type::regular;
+    case S_IFLNK:
+        return fs::file_type::symlink;
+    case S_IFIFO:
+        return fs::file_type::fifo;
+    case S_IFSOCK:
+        return fs::file_type::socket;
+    case S_IFCHR:
+        return fs::file_type::character;
+    case S_IFBLK:
+        return fs::file_type::block;
+    default:
+        return fs::file_type::unknown;
+    }
+}
+
+fs::file_type type_of_dirent(unsigned char d_type) {
+    switch (d_type) {
+    case DT_DIR:
+        return fs::file_type::directory;
+    case DT_REG:
+        return fs::file_type::regular;
+    case DT_LNK:
+        return fs::file_type::symlink;
+    case DT_FIFO:
+        return fs::file_type::fifo;
+    case DT_SOCK:
+        return fs::file_type::socket;
+    case DT_CHR:
+        return fs::file_type::character;
+    case DT_BLK:
+        return fs::file_type::block;
+    default:
+        return fs::file_type::none;
+    }
+}
+
+// The type of `name` within `dirfd`, asking for nothing but the type
+fs::file_type stat_type(int dirfd, char const* name, bool follow_symlink) {
+    int const flags = AT_NO_AUTOMOUNT | (follow_symlink ? 0 : AT_SYMLINK_NOFOLLOW);
+#if defined(STATX_TYPE)
+    struct statx st;
+    if (::statx(dirfd, name, flags, STATX_TYPE, &st) != 0) {
+        return fs::file_type::unknown;
+    }
+    return ::type_of_mode(st.stx_mode);
+#else
+    struct stat st;
+    if (::fstatat(dirfd, name, &st, flags) != 0) {
+        return fs::file_type::unknown;
+    }
+    return ::type_of_mode(st.st_mode);
+#endif
+}
+
+[[noreturn]] void throw_error(char const* what, fs::path const& path) {
+    throw fs::filesystem_error{what, path, std::error_code{errno, std::system_category()}};
+}
+
+int open_dir(int dirfd, char const* name, bool follow_symlink) {
+    int const flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC | (follow_symlink ? 0 : O_NOFOLLOW);
+    int       fd;
+    do {
+        fd = ::openat(dirfd, name, flags);
+    } while (fd < 0 && errno == EINTR);
+    return fd;
+}
+
+}  // namespace
+
+pf::dir_reader::dir_reader(fs::path dir)
+    : _path{std::move(dir)} {
+    _fd = ::open_dir(AT_FDCWD, _path.c_str(), true);
+    if (_fd < 0) {
+        ::throw_error("Failed to open directory", _path);
+    }
+}
+
+pf::dir_reader::dir_reader(dir_reader const& parent, std::string const& name, bool follow_symlink)
+    : _path{parent._path / name} {
+    _fd = ::open_dir(parent._fd, name.c_str(), follow_symlink);
+    if (_fd < 0) {
+        ::throw_error("Failed to open directory", _path);
+    }
+}
+
+pf::dir_reader::~dir_reader() { ::close(_fd); }
+
+bool pf::dir_reader::next(entry& out) {
+    while (true) {
+        if (_pos == _end) {
+            if (!_buf) {
+                _buf.reset(new char[BufferSize]);
+            }
+            auto const n = ::syscall(SYS_getdents64, _fd, _buf.get(), BufferSize);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                ::throw_error("Failed to read directory", _path);
+            }
+            if (n == 0) {
+                return false;
+            }
+            _pos = 0;
+            _end = static_cast<std::size_t>(n);
+        }
+
+        auto const* ent = reinterpret_cast<linux_dirent64 const*>(_buf.get() + _pos);
+        _pos += ent->d_reclen;
+        std::string_view const name{ent->d_name};
+        if (name == "." || name == "..") {
+            continue;
+        }
+        out.name = name;
+        out.type = ::type_of_dirent(ent->d_type);
+        if (out.type == fs::file_type::none) {
+            // The filesystem does not say, so it has to be asked
+            out.type = ::stat_type(_fd, ent->d_name, false);
+        }
+        return true;
+    }
+}
+
+fs::file_type pf::dir_reader::followed_type(entry const& ent) const {
+    if (ent.type != fs::file_type::symlink) {
+        return ent.type;
+    }
+    // Names returned by `next()` point into the buffer, and are null-terminated there
+    return ::stat_type(_fd, ent.name.data(), true);
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef PF_FS_DIR_READER_HPP_INCLUDED
+#define PF_FS_DIR_READER_HPP_INCLUDED
+
+#include <pf/fs/core.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace pf {
+
+/**
+ * Reads the entries of a directory straight from the kernel, for walks over large trees.
+ *
+ * Entries are read in bulk with getdents64, and their types come with them, so an entry only
+ * costs a `statx` on filesystems that do not report types. Subdirectories are opened relative to
+ * the descriptor of their parent, so descending into them does not resolve the full path again.
+ *
+ * Only supported on Linux. Elsewhere, the constructors throw `std::system_error` with
+ * `std::errc::not_supported`, and `supported` is false.
+ */
+class dir_reader {
+public:
+#if defined(__linux__)
+    static constexpr bool supported = true;
+#else
+    static constexpr bool supported = false;
+#endif
+
+    struct entry {
+        /// The name of the entry, valid until the next call to `next()`
+        std::string_view name;
+        /// The type of the entry itself, not of what a symlink points to. `unknown` if the entry
+        /// vanished before its type could be determined.
+        fs::file_type type = fs::file_type::none;
+    };
+
+    /// Open `dir`. Throws `fs::filesystem_error` if it cannot be opened.
+    explicit dir_reader(fs::path dir);
+    /**
+     * Open `name`, an entry of the directory read by `parent`. A symlink is only followed if
+     * `follow_symlink` is set. Throws `fs::filesystem_error` if it cannot be opened.
+     */
+    dir_reader(dir_reader const& parent, std::string const& name, bool follow_symlink = false);
+    ~dir_reader();
+
+    dir_reader(const dir_reader&) = delete;
+    dir_reader& operator=(const dir_reader&) = delete;
+
+    /// The path of the directory, as given when it was opened
+    fs::path const& path() const noexcept { return _path; }
+
+    /**
+     * Read the next entry into `out`, skipping `.` and `..`. Returns `false` at the end of the
+     * directory. Throws `fs::filesystem_error` if the directory cannot be read.
+     */
+    bool next(entry& out);
+
+    /// The type of what `ent`, the entry last read, points to if it is a symlink
+    fs::file_type followed_type(entry const& ent) const;
+
+private:
+    int                     _fd = -1;
+    fs::path                _path;
+    std::unique_ptr<char[]> _buf;
+    std::size_t             _pos = 0;
+    std::size_t             _end = 0;
+};
+
+}  // namespace pf
+
+#endif  // PF_FS_DIR_READER_HPP_INCLUDED
@@ -0,0 +1,296 @@
+#include "./git_index.hpp"
+
+#include <pf/fs/ascending_iterator.hpp>
+#include <pf/util/trace.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <string>
+
+namespace fs = pf::fs;
+
+namespace {
+
+// The signature, version, and entry count
+constexpr std::size_t HeaderSize = 12;
+// From the start of an entry to its object ID: Two timestamps, then six 32-bit fields
+constexpr std::size_t StatSize = 40;
+
+constexpr std::uint16_t ExtendedFlag     = 0x4000;
+constexpr std::uint16_t SkipWorktreeFlag = 0x4000;
+
+std::uint32_t read_be32(std::string_view data, std::size_t pos) {
+    auto const b = reinterpret_cast<unsigned char const*>(data.data() + pos);
+    return (std::uint32_t{b[0]} << 24) | (std::uint32_t{b[1]} << 16) | (std::uint32_t{b[2]} << 8)
+        | std::uint32_t{b[3]};
+}
+
+std::uint16_t read_be16(std::string_view data, std::size_t pos) {
+    auto const b = reinterpret_cast<unsigned char const*>(data.data() + pos);
+    return static_cast<std::uint16_t>((b[0] << 8) | b[1]);
+}
+
+/**
+ * Read the variable-length integer that starts a path in version 4, as git writes it: Seven bits
+ * per byte, most significant first, with each continuation also adding one. Returns false if it
+ * runs off the end of `data`.
+ */
+bool read_varint(std::string_view data, std::size_t& pos, std::uint64_t& value) {
+    if (pos >= data.size()) {
+        return false;
+    }
+    auto c = static_cast<unsigned char>(data[pos++]);
+    value  = c & 0x7f;
+    while (c & 0x80) {
+        if (pos >= data.size() || value > (~std::uint64_t{0} >> 8)) {
+            return false;
+        }
+        c     = static_cast<unsigned char>(data[pos++]);
+        value = ((value + 1) << 7) | (c & 0x7f);
+    }
+    return true;
+}
+
+std::string trimmed(std::string_view str) {
+    auto const first = str.find_first_not_of(" \t\r\n");
+    if (first == str.npos) {
+        return {};
+    }
+    return std::string{str.substr(first, str.find_last_not_of(" \t\r\n") - first + 1)};
+}
+
+// A .git file holds "gitdir: <path>", relative to the directory of the file
+std::optional<fs::path> read_gitdir_file(fs::path const& dot_git) {
+    std::error_code ec;
+    auto const      content = pf::slurp_file(dot_git, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    std::string_view const prefix = "gitdir:";
+    auto const             line   = ::trimmed(content);
+    if (line.compare(0, prefix.size(), prefix) != 0) {
+        return std::nullopt;
+    }
+    return dot_git.parent_path() / ::trimmed(std::string_view{line}.substr(prefix.size()));
+}
+
+// The object IDs are SHA-256 if the config of the repository sets extensions.objectFormat so
+std::size_t hash_size_of(fs::path const& git_dir) {
+    // Linked worktrees share the config of the main repository, which "commondir" points to
+    std::error_code ec;
+    auto            common_dir = git_dir;
+    auto const      commondir  = pf::slurp_file(git_dir / "commondir", ec);
+    if (!ec) {
+        common_dir = git_dir / ::trimmed(commondir);
+    }
+    ec.clear();
+    auto config = pf::slurp_file(common_dir / "config", ec);
+    if (ec) {
+        return 20;
+    }
+    std::transform(config.begin(), config.end(), config.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    std::string_view rest = config;
+    while (!rest.empty()) {
+        auto const eol  = std::min(rest.find('\n'), rest.size());
+        auto const line = ::trimmed(rest.substr(0, eol));
+        rest.remove_prefix(std::min(eol + 1, rest.size()));
+        if (line.compare(0, 12, "objectformat") == 0 && line.find("sha256") != line.npos) {
+            return 32;
+        }
+    }
+    return 20;
+}
+
+}  // namespace
+
+std::optional<pf::git_repository> pf::find_git_repository(fs::path const& dir) {
+    pf::trace::span span{"find_git_repository", dir};
+    for (ascending_iterator it{dir}, stop; it != stop; ++it) {
+        auto const      dot_git = *it / ".git";
+        std::error_code ec;
+        auto const      status = fs::status(dot_git, ec);
+
+        std::optional<fs::path> git_dir;
+        if (fs::is_directory(status)) {
+            git_dir = dot_git;
+        } else if (fs::is_regular_file(status)) {
+            git_dir = ::read_gitdir_file(dot_git);
+        }
+        if (git_dir) {
+            git_repository repo;
+            repo.work_tree = *it;
+            repo.git_dir   = git_dir->lexically_normal();
+            repo.hash_size = ::hash_size_of(repo.git_dir);
+            return repo;
+        }
+    }
+    return std::nullopt;
+}
+
+/**
+ * Decode the entries in order, passing each to `fn(entry, next)` along with the offset just past
+ * it, until `fn` returns false. Throws if an entry does not fit in the file.
+ */
+template <typename Fn>
+void pf::git_index::_decode(Fn&& fn) const {
+    auto const data = _file.view();
+    auto const fail = [&](std::string const& what) {
+        throw std::runtime_error(_path.string() + ": Malformed git index: " + what);
+    };
+
+    // Up to the flags, which are followed by the extended flags (if any), then the path
+    auto const  fixed_size = StatSize + _hash_size + 2;
+    auto const  data_end   = data.size() - _hash_size;
+    std::size_t pos        = HeaderSize;
+    // In version 4, each path is given as a change to the one before it
+    std::string path;
+    for (std::size_t n = 0; n < _count; ++n) {
+        auto const start = pos;
+        if (data_end - pos < fixed_size) {
+            fail("Entry " + std::to_string(n) + " is truncated");
+        }
+        auto const mode  = ::read_be32(data, pos + 24);
+        auto const size  = ::read_be32(data, pos + 36);
+        auto const flags = ::read_be16(data, pos + StatSize + _hash_size);
+        pos += fixed_size;
+
+        std::uint16_t extended = 0;
+        if (flags & ExtendedFlag) {
+            if (_version < 3 || data_end - pos < 2) {
+                fail("Entry " + std::to_string(n) + " has bad extended flags");
+            }
+            extended = ::read_be16(data, pos);
+            pos += 2;
+        }
+
+        std::string_view name;
+        if (_version >= 4) {
+            std::uint64_t strip = 0;
+            if (!::read_varint(data, pos, strip) || strip > path.size()) {
+                fail("Entry " + std::to_string(n) + " has a bad path prefix");
+            }
+            auto const nul = data.find('\0', pos);
+            if (nul == data.npos || nul >= data_end) {
+                fail("Entry " + std::to_string(n) + " is truncated");
+            }
+            path.resize(path.size() - static_cast<std::size_t>(strip));
+            path.append(data.substr(pos, nul - pos));
+            name = path;
+            pos  = nul + 1;
+        } else {
+            auto const nul = data.find('\0', pos);
+            if (nul == data.npos || nul >= data_end) {
+                fail("Entry " + std::to_string(n) + " is truncated");
+            }
+            name = data.substr(pos, nul - pos);
+            // Padded with one to eight NULs, to a multiple of eight bytes
+            pos = start + ((nul - start + 8) & ~std::size_t{7});
+            if (pos > data_end) {
+                fail("Entry " + std::to_string(n) + " is truncated");
+            }
+        }
+
+        entry const ent{name,
+                        mode,
+                        size,
+                        static_cast<unsigned>((flags >> 12) & 3),
+                        (extended & SkipWorktreeFlag) != 0};
+        if (!fn(ent, pos)) {
+            return;
+        }
+    }
+}
+
+pf::git_index pf::git_index::load(fs::path const& index_file, std::size_t hash_size) {
+    pf::trace::span span{"git_index::load", index_file};
+    git_index       ret;
+    ret._path      = index_file;
+    ret._hash_size = hash_size;
+    ret._file      = pf::map_file(index_file);
+
+    auto const data = ret._file.view();
+    auto const fail = [&](std::string const& what) {
+        throw std::runtime_error(index_file.string() + ": " + what);
+    };
+    if (data.size() < HeaderSize + hash_size || data.substr(0, 4) != "DIRC") {
+        fail("Not a git index");
+    }
+    ret._version = ::read_be32(data, 4);
+    if (ret._version < 2 || ret._version > 4) {
+        fail("Unsupported git index version " + std::to_string(ret._version));
+    }
+    ret._count = ::read_be32(data, 8);
+
+    // Check every entry up front, so iterating never finds a malformed one, and find where the
+    // extensions start
+    std::size_t end = HeaderSize;
+    ret._decode([&](entry const&, std::size_t next) {
+        end = next;
+        return true;
+    });
+
+    // Each extension is a signature, a size, and that many bytes, up to the checksum at the end
+    auto const data_end = data.size() - hash_size;
+    while (data_end - end >= 8) {
+        auto const signature = data.substr(end, 4);
+        if (signature == "link") {
+            fail("Split git indexes are not supported");
+        }
+        if (signature == "sdir") {
+            fail("Sparse git indexes are not supported");
+        }
+        auto const size = ::read_be32(data, end + 4);
+        if (data_end - end - 8 < size) {
+            fail("Malformed git index: Extension " + std::string{signature} + " is truncated");
+        }
+        end += 8 + size;
+    }
+    return ret;
+}
+
+void pf::git_index::for_each_below(std::string_view dir, entry_callback const& fn) const {
+    pf::trace::span span{"git_index::for_each_below"};
+    if (dir.empty()) {
+        _decode([&](entry const& ent, std::size_t) {
+            fn(ent);
+            return true;
+        });
+        return;
+    }
+    auto const prefix = std::string{dir} + '/';
+    _decode([&](entry const& ent, std::size_t) {
+        auto const cmp = ent.path.compare(0, prefix.size(), prefix);
+        if (cmp == 0) {
+            fn(ent);
+        }
+        // Paths are sorted by their bytes, so those below `dir` all start with its prefix, and
+        // none come after a path that sorts after it
+        return cmp <= 0;
+    });
+}
+
+void pf::for_each_tracked_source(git_index const&       index,
+                                 std::string_view       root,
+                                 source_patterns const& patterns,
+                                 source_callback const& fn) {
+    auto const  prefix_size = root.empty() ? 0 : root.size() + 1;
+    std::string last;
+    index.for_each_below(root, [&](git_index::entry const& ent) {
+        auto const path = ent.path.substr(prefix_size);
+        if (ent.mode == git_index::gitlink_mode || ent.skip_worktree || path == last
+            || !patterns.matches(path)) {
+            return;
+        }
+        // As with a walk, files directly within the root are never sources
+        auto const slash = path.rfind('/');
+        if (slash == path.npos) {
+            return;
+        }
+        // The stages of a conflicted path are next to each other
+        last.assign(path.data(), path.size());
+        fn(source_entry{path.substr(0, slash), path.substr(slash + 1)});
+    });
+}
@@ -0,0 +1,115 @@
+#ifndef PF_FS_GIT_INDEX_HPP_INCLUDED
+#define PF_FS_GIT_INDEX_HPP_INCLUDED
+
+#include <pf/fs/core.hpp>
+#include <pf/fs/glob.hpp>
+#include <pf/fs/source_patterns.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string_view>
+
+namespace pf {
+
+/// Where the files of a git repository are
+struct git_repository {
+    /// The root of the working tree
+    fs::path work_tree;
+    /// The .git directory, or that of a linked worktree
+    fs::path git_dir;
+    /// The size of an object ID: 20 bytes for SHA-1, or 32 for SHA-256
+    std::size_t hash_size = 20;
+
+    fs::path index_file() const { return git_dir / "index"; }
+};
+
+/**
+ * Find the repository whose working tree holds `dir`, by looking for a .git directory (or a .git
+ * file that points to one, as in submodules and linked worktrees) in `dir` and each of its
+ * parents. Returns `nullopt` if there is none.
+ */
+std::optional<git_repository> find_git_repository(fs::path const& dir);
+
+/**
+ * The paths tracked by git, read straight from the index file of a repository (.git/index),
+ * without running git.
+ *
+ * Versions 2 to 4 of the format are understood, including the prefix compression of paths in
+ * version 4. The file is mapped (see `map_file`) and entries are decoded as they are iterated,
+ * so loading an index costs a single pass over it to check that it is well-formed. Split and
+ * sparse indexes, which leave out some of the tracked paths, are refused.
+ *
+ * Entries are in the order git keeps them: by the bytes of their paths, so all paths below a
+ * directory are together.
+ */
+class git_index {
+public:
+    /// The mode git records for submodules, which have no file of their own
+    static constexpr std::uint32_t gitlink_mode = 0160000;
+
+    struct entry {
+        /// Relative to the working tree, with '/' separators
+        std::string_view path;
+        std::uint32_t    mode;
+        std::uint32_t    size;
+        /// Zero, unless the path has a merge conflict
+        unsigned stage;
+        /// Set for paths outside a sparse checkout, which are not in the working tree
+        bool skip_worktree;
+    };
+
+    using entry_callback = std::function<void(entry const&)>;
+
+    /**
+     * Load the index in `index_file`, whose object IDs are `hash_size` bytes. Throws
+     * `std::system_error` if it cannot be read, and `std::runtime_error` if it is malformed or
+     * uses a feature that is not supported.
+     */
+    static git_index load(fs::path const& index_file, std::size_t hash_size = 20);
+
+    /// The version of the format, from 2 to 4
+    std::uint32_t version() const noexcept { return _version; }
+    /// The number of entries
+    std::size_t size() const noexcept { return _count; }
+
+    /// Call `fn` with each entry in order. The entry is only valid for the duration of the call.
+    void for_each(entry_callback const& fn) const { for_each_below({}, fn); }
+
+    /**
+     * Call `fn` with each entry whose path is below the directory `dir`, in order. Iteration
+     * stops at the first path after them. `dir` is relative to the working tree, with '/'
+     * separators, and is empty for all entries.
+     */
+    void for_each_below(std::string_view dir, entry_callback const& fn) const;
+
+private:
+    fs::path      _path;
+    mapped_file   _file;
+    std::size_t   _hash_size = 20;
+    std::uint32_t _version   = 0;
+    std::size_t   _count     = 0;
+
+    template <typename Fn>
+    void _decode(Fn&& fn) const;
+};
+
+/**
+ * Call `fn` with each source file that `index` tracks below the directory `root`, which is
+ * relative to the working tree. These are the paths in subdirectories of `root` that `patterns`
+ * selects, leaving out submodules and paths outside a sparse checkout. Each path is passed once,
+ * even if it has a merge conflict.
+ *
+ * As with `for_each_source`, the directory of each source is relative to `root`. Unlike it, the
+ * sources come in the order of the index, and nothing is left out for being ignored, since git
+ * tracks it anyway.
+ */
+void for_each_tracked_source(git_index const&       index,
+                             std::string_view       root,
+                             source_patterns const& patterns,
+                             source_callback const& fn);
+
+}  // namespace pf
+
+#endif  // PF_FS_GIT_INDEX_HPP_INCLUDED
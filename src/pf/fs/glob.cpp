@@ -1,47 +1,343 @@
 #include "./glob.hpp"
 
+#include <pf/fs/dir_reader.hpp>
+#include <pf/fs/ignore_rules.hpp>
+#include <pf/fs/path_sort.hpp>
+#include <pf/util/task_pool.hpp>
+#include <pf/util/trace.hpp>
+
 #include <algorithm>
 #include <iterator>
-#include <unordered_set>
+#include <string>
+#include <string_view>
 
 namespace fs = pf::fs;
 
-std::vector<fs::path> pf::glob_sources(fs::path const& relative_to) {
-    std::vector<fs::path> sources;
+namespace {
+
+using state = pf::source_patterns::state;
+
+/**
+ * Reads a directory with `fs::directory_iterator`, with the same interface as `pf::dir_reader`.
+ * Entries are only told apart as directories, symlinks, and everything else, which is reported
+ * as `regular`. That much comes with the listing on most systems.
+ */
+class std_reader {
+    fs::path               _path;
+    fs::directory_iterator _it;
+    std::string            _name;
+
+public:
+    explicit std_reader(fs::path dir)
+        : _path{std::move(dir)}
+        , _it{_path} {}
+
+    std_reader(std_reader const& parent, std::string const& name, bool = false)
+        : std_reader(parent._path / name) {}
 
-    struct path_hash {
-        auto operator()(fs::path const& path) const {
-            return fs::hash_value(path);  //
+    fs::path const& path() const noexcept { return _path; }
+
+    bool next(pf::dir_reader::entry& out) {
+        if (_it == fs::directory_iterator{}) {
+            return false;
         }
+        auto const& entry = *_it;
+        _name             = entry.path().filename().string();
+        out.name          = _name;
+        if (entry.is_symlink()) {
+            out.type = fs::file_type::symlink;
+        } else {
+            out.type = entry.is_directory() ? fs::file_type::directory : fs::file_type::regular;
+        }
+        ++_it;
+        return true;
+    }
+
+    fs::file_type followed_type(pf::dir_reader::entry const& ent) const {
+        std::error_code ec;
+        return fs::status(_path / ent.name, ec).type();
+    }
+};
+
+// Check whether a top-level entry is a directory. These are followed even if they are symlinks.
+template <typename Reader>
+bool is_top_level_dir(Reader const&                root,
+                      pf::dir_reader::entry const& ent,
+                      pf::stat_cache*              stats) {
+    if (ent.type == fs::file_type::symlink) {
+        return stats ? stats->is_directory(root.path() / ent.name)
+                     : root.followed_type(ent) == fs::file_type::directory;
+    }
+    // The type comes with the listing, so this is free to check and remember. Only the top level
+    // is remembered: It is listed by a single thread, and it is what callers may look up again.
+    auto const is_dir = ent.type == fs::file_type::directory;
+    if (is_dir && stats) {
+        stats->remember(root.path() / ent.name, fs::file_type::directory);
+    }
+    return is_dir;
+}
+
+/**
+ * List the directory open in `reader` as `pf::detail::list_dir` does, and count it in the trace.
+ */
+template <typename Reader>
+pf::detail::dir_entries read_dir(Reader&                    reader,
+                                 bool                       top_level,
+                                 pf::source_patterns const& patterns,
+                                 state                      dir_state,
+                                 pf::stat_cache*            stats) {
+    // The directory's own .gitignore, or a CMakeCache.txt, may come after the entries they rule
+    // out, so nothing is ruled out until the listing is done
+    pf::detail::dir_entries ret;
+    std::int64_t            n_entries = 0;
+    pf::dir_reader::entry   ent;
+    while (reader.next(ent)) {
+        ++n_entries;
+        if (top_level) {
+            // Files directly within the root are never sources
+            if (::is_top_level_dir(reader, ent, stats)) {
+                ret.subdirs.emplace_back(ent.name);
+            }
+            continue;
+        }
+        // Same as recursive_directory_iterator: Do not follow symlinks to directories
+        if (ent.type == fs::file_type::directory) {
+            ret.subdirs.emplace_back(ent.name);
+            continue;
+        }
+        if (pf::marks_build_dir(ent.name)) {
+            // Whatever is in here was generated
+            ret              = {};
+            ret.is_build_dir = true;
+            break;
+        }
+        ret.has_ignore_file = ret.has_ignore_file || ent.name == pf::ignore_rules::file_name;
+        if (patterns.selected(patterns.advance(dir_state, ent.name))) {
+            ret.files.emplace_back(ent.name);
+        }
+    }
+    pf::trace::add(pf::trace::counter::directories_visited, 1);
+    pf::trace::add(pf::trace::counter::entries_examined, n_entries);
+    return ret;
+}
+
+// Walk depth-first, opening each directory relative to its parent, which is still open
+template <typename Reader, typename Emit>
+void walk_serial(fs::path const&            relative_to,
+                 pf::source_patterns const& patterns,
+                 pf::stat_cache*            stats,
+                 Emit&&                     emit) {
+    auto walk = [&](auto&            self,
+                    Reader&          reader,
+                    bool             top_level,
+                    state            dir_state,
+                    pf::ignore_rules rules) -> void {
+        pf::detail::visit_dir(reader.path(),
+                              ::read_dir(reader, top_level, patterns, dir_state, stats),
+                              dir_state,
+                              std::move(rules),
+                              patterns,
+                              emit,
+                              [&](std::string const& name, state sub, pf::ignore_rules sub_rules) {
+                                  // Top-level symlinks to directories are followed
+                                  Reader subdir{reader, name, top_level};
+                                  self(self, subdir, false, sub, std::move(sub_rules));
+                              });
     };
-    std::unordered_set<fs::path, path_hash> const SourceFileExtensions{
-        fs::path{".c"},
-        fs::path{".cc"},
-        fs::path{".cpp"},
-        fs::path{".cxx"},
-        fs::path{".c++"},
-        fs::path{".h"},
-        fs::path{".hh"},
-        fs::path{".hpp"},
-        fs::path{".hxx"},
-        fs::path{".h++"},
-    };
+    Reader root{relative_to};
+    walk(walk, root, true, patterns.start(), pf::ignore_rules::for_directory(relative_to));
+}
 
-    std::for_each(fs::directory_iterator{relative_to},
-                  fs::directory_iterator{},
-                  [&](fs::directory_entry const& top_level_entry) {
-                      if (top_level_entry.is_directory()) {
-                          std::copy_if(fs::recursive_directory_iterator{top_level_entry.path()},
-                                       fs::recursive_directory_iterator{},
-                                       std::back_inserter(sources),
-                                       [&](fs::directory_entry const& entry) {
-                                           return SourceFileExtensions.count(
-                                               entry.path().extension());
-                                       });
-                      }
-                  });
-
-    std::sort(sources.begin(), sources.end());
+/**
+ * Walk the tree with one task per directory on a work-stealing pool. `emit` is called from the
+ * workers, and must be safe to call concurrently.
+ *
+ * A task may run long after the directory above it was closed, so each opens its directory by
+ * its full path.
+ */
+template <typename Reader, typename Emit>
+void walk_parallel(pf::task_pool&             pool,
+                   fs::path const&            relative_to,
+                   pf::source_patterns const& patterns,
+                   pf::stat_cache*            stats,
+                   Emit&&                     emit) {
+    auto walk = [&](auto&            self,
+                    fs::path const&  dir,
+                    bool             top_level,
+                    state            dir_state,
+                    pf::ignore_rules rules) -> void {
+        Reader reader{dir};
+        pf::detail::visit_dir(dir,
+                              ::read_dir(reader, top_level, patterns, dir_state, stats),
+                              dir_state,
+                              std::move(rules),
+                              patterns,
+                              emit,
+                              [&](std::string const& name, state sub, pf::ignore_rules sub_rules) {
+                                  pool.submit([&self,
+                                               subdir    = dir / name,
+                                               sub,
+                                               sub_rules = std::move(sub_rules)]() mutable {
+                                      self(self, subdir, false, sub, std::move(sub_rules));
+                                  });
+                              });
+    };
+    auto rules = pf::ignore_rules::for_directory(relative_to);
+    try {
+        walk(walk, relative_to, true, patterns.start(), std::move(rules));
+    } catch (...) {
+        // The tasks already submitted refer to `walk`, so they must finish before it goes. Their
+        // own error, if any, is secondary to this one.
+        try {
+            pool.wait();
+        } catch (...) {
+        }
+        throw;
+    }
+    pool.wait();
+}
 
+/**
+ * Gather each worker's results into one, and sort them with the pool.
+ */
+std::vector<fs::path> sort_and_merge(pf::task_pool&                      pool,
+                                     fs::path const&                     relative_to,
+                                     std::vector<std::vector<fs::path>>& runs) {
+    std::size_t total = 0;
+    for (auto const& run : runs) {
+        total += run.size();
+    }
+    std::vector<fs::path> sources;
+    sources.reserve(total);
+    for (auto& run : runs) {
+        std::move(run.begin(), run.end(), std::back_inserter(sources));
+        run = {};
+    }
+    pf::sort_paths(sources, relative_to, &pool);
     return sources;
 }
+
+/**
+ * Glob into full paths. In parallel, each worker appends to its own buffer, so the only shared
+ * state during the walk is the pool itself.
+ */
+template <typename Reader>
+std::vector<fs::path> glob_paths(fs::path const&            relative_to,
+                                 pf::source_patterns const& patterns,
+                                 pf::glob_options const&    opts) {
+    if (opts.jobs == 1) {
+        std::vector<fs::path> sources;
+        ::walk_serial<Reader>(relative_to,
+                              patterns,
+                              opts.stats,
+                              [&](fs::path const& dir, std::vector<std::string> const& names) {
+                                  for (auto const& name : names) {
+                                      sources.push_back(dir / name);
+                                  }
+                              });
+        pf::sort_paths(sources, relative_to);
+        return sources;
+    }
+
+    // The workers write to `found` until the pool has finished with them, so it must outlive it
+    std::vector<std::vector<fs::path>> found;
+    pf::task_pool                      pool{opts.jobs};
+    found.resize(pool.size());
+    ::walk_parallel<Reader>(pool,
+                            relative_to,
+                            patterns,
+                            opts.stats,
+                            [&](fs::path const& dir, std::vector<std::string> const& names) {
+                                auto& out = found[pool.this_worker_index()];
+                                for (auto const& name : names) {
+                                    out.push_back(dir / name);
+                                }
+                            });
+    return ::sort_and_merge(pool, relative_to, found);
+}
+
+// Walk serially or in parallel, as `opts` asks, passing the sources in each directory to `emit`
+template <typename Reader, typename Emit>
+void walk(fs::path const&            relative_to,
+          pf::source_patterns const& patterns,
+          pf::glob_options const&    opts,
+          Emit&&                     emit) {
+    if (opts.jobs == 1) {
+        ::walk_serial<Reader>(relative_to, patterns, opts.stats, emit);
+    } else {
+        pf::task_pool pool{opts.jobs};
+        ::walk_parallel<Reader>(pool, relative_to, patterns, opts.stats, emit);
+    }
+}
+
+}  // namespace
+
+bool pf::is_source_file(fs::path const& path) {
+    return source_patterns::defaults().matches(path.filename().string());
+}
+
+std::vector<fs::path> pf::glob_sources(fs::path const& relative_to, glob_options const& opts) {
+    pf::trace::span span{"glob_sources", relative_to};
+    auto const&     patterns = opts.patterns ? *opts.patterns : source_patterns::defaults();
+    if (dir_reader::supported && !opts.use_std_filesystem) {
+        return ::glob_paths<dir_reader>(relative_to, patterns, opts);
+    }
+    return ::glob_paths<::std_reader>(relative_to, patterns, opts);
+}
+
+pf::detail::dir_entries pf::detail::list_dir(fs::path const&        dir,
+                                            bool                   top_level,
+                                            source_patterns const& patterns,
+                                            source_patterns::state dir_state,
+                                            glob_options const&    opts) {
+    if (dir_reader::supported && !opts.use_std_filesystem) {
+        dir_reader reader{dir};
+        return ::read_dir(reader, top_level, patterns, dir_state, opts.stats);
+    }
+    ::std_reader reader{dir};
+    return ::read_dir(reader, top_level, patterns, dir_state, opts.stats);
+}
+
+void pf::glob_sources(fs::path const& relative_to, glob_options const& opts, path_trie& out) {
+    pf::for_each_source(relative_to, opts, [&](source_entry const& source) {
+        out.insert_in(source.dir, source.name);
+    });
+}
+
+void pf::for_each_source(fs::path const&        relative_to,
+                         glob_options const&    opts,
+                         source_callback const& fn) {
+    pf::trace::span        span{"for_each_source", relative_to};
+    auto const&            patterns = opts.patterns ? *opts.patterns : source_patterns::defaults();
+    detail::source_emitter emit{relative_to, fn};
+    if (dir_reader::supported && !opts.use_std_filesystem) {
+        ::walk<dir_reader>(relative_to, patterns, opts, emit);
+    } else {
+        ::walk<::std_reader>(relative_to, patterns, opts, emit);
+    }
+}
+
+pf::detail::source_emitter::source_emitter(fs::path const& root, source_callback const& fn)
+    : _fn{fn}
+    , _root{root}
+    , _prefix_size{root.native().size()} {
+    // Paths below the root continue after a separator, unless the root ends with one
+    if (!root.native().empty() && root.native().back() != fs::path::preferred_separator) {
+        ++_prefix_size;
+    }
+}
+
+void pf::detail::source_emitter::operator()(fs::path const&                 dir,
+                                            std::vector<std::string> const& names) {
+#if defined(_WIN32)
+    auto const relative = dir.lexically_relative(_root).generic_string();
+#else
+    // `dir` was made by appending to the root, so what follows the root is the relative path
+    std::string_view relative = dir.native();
+    relative.remove_prefix(std::min(_prefix_size, relative.size()));
+#endif
+    std::lock_guard lk{_mutex};
+    for (auto const& name : names) {
+        _fn(source_entry{relative, name});
+    }
+}
@@ -2,9 +2,179 @@
 #define PF_FS_GLOB_HPP_INCLUDED
 
 #include <pf/fs/core.hpp>
+#include <pf/fs/ignore_rules.hpp>
+#include <pf/fs/path_trie.hpp>
+#include <pf/fs/source_patterns.hpp>
+#include <pf/fs/stat_cache.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace pf {
-std::vector<fs::path> glob_sources(fs::path const& relative_to);
+
+struct glob_options {
+    /**
+     * The number of threads used to traverse the directory tree. `1` walks the tree serially on
+     * the calling thread, and `0` uses one thread per hardware thread. The result is the same
+     * regardless of the number of jobs.
+     */
+    unsigned jobs = 1;
+    /**
+     * If set, the types of the top-level directories of the tree are looked up in and recorded
+     * to this cache, so that later queries for them need no further system calls.
+     */
+    stat_cache* stats = nullptr;
+    /**
+     * Selects the source files by their path relative to the root of the glob. If null,
+     * `source_patterns::defaults()` is used. Directories in which the patterns cannot select
+     * anything are not entered.
+     */
+    source_patterns const* patterns = nullptr;
+    /**
+     * Read directories with `fs::directory_iterator`, even where `dir_reader` is supported. The
+     * result is the same either way, so this is only of use to compare the two.
+     */
+    bool use_std_filesystem = false;
+};
+
+/**
+ * Determine whether the given path names a source file according to the default patterns, which
+ * only look at its extension.
+ */
+bool is_source_file(fs::path const& path);
+
+/**
+ * Find the source files in each subdirectory of `relative_to`. The returned paths are sorted, in
+ * the order described by `sort_paths`.
+ *
+ * What git ignores is left out, and so are CMake build directories (see `ignore_rules`). Such
+ * directories are not entered at all.
+ *
+ * Where it is supported, directories are read with `dir_reader`, so that no entry needs a stat of
+ * its own on most filesystems.
+ */
+std::vector<fs::path> glob_sources(fs::path const& relative_to, glob_options const& opts);
+
+inline std::vector<fs::path> glob_sources(fs::path const& relative_to) {
+    return glob_sources(relative_to, glob_options{});
 }
 
+/**
+ * As above, but add the sources to `out`, relative to `relative_to`. No full path is made for any
+ * source, and the trie keeps them in order without sorting.
+ */
+void glob_sources(fs::path const& relative_to, glob_options const& opts, path_trie& out);
+
+/// A source found by `for_each_source`, only valid for the duration of the callback
+struct source_entry {
+    /// The directory of the source, relative to the root of the glob, with '/' separators
+    std::string_view dir;
+    std::string_view name;
+};
+
+using source_callback = std::function<void(source_entry const&)>;
+
+/**
+ * Call `fn` with each source that `glob_sources` would find, as soon as its directory has been
+ * listed, without collecting them. The sources come in no particular order. Calls to `fn` are
+ * never concurrent, even with more than one job.
+ */
+void for_each_source(fs::path const&        relative_to,
+                     glob_options const&    opts,
+                     source_callback const& fn);
+
+namespace detail {
+
+/**
+ * What a glob takes from the listing of one directory, before any ignore rules are applied.
+ * Nothing is taken from a CMake build directory.
+ */
+struct dir_entries {
+    /// The subdirectories. At the root of a glob, these include symlinks to directories.
+    std::vector<std::string> subdirs;
+    /// The names of the files selected by the patterns. There are none at the root of a glob.
+    std::vector<std::string> files;
+    bool                     has_ignore_file = false;
+    bool                     is_build_dir    = false;
+};
+
+/**
+ * List `dir` as `glob_sources` does, matching its files starting from `dir_state`. `top_level` is
+ * set for the root of a glob. The directory is read with `dir_reader` where it is supported,
+ * unless `opts` says otherwise.
+ */
+dir_entries list_dir(fs::path const&        dir,
+                     bool                   top_level,
+                     source_patterns const& patterns,
+                     source_patterns::state dir_state,
+                     glob_options const&    opts);
+
+/**
+ * Take what a glob wants from the `entries` of `dir`, once `rules` and the directory's own ignore
+ * file are applied. The names of the selected files are passed to `emit(dir, names)`, and then
+ * `enter(name, state, rules)` is called for each subdirectory that may hold sources.
+ */
+template <typename Emit, typename Enter>
+void visit_dir(fs::path const&        dir,
+               dir_entries            entries,
+               source_patterns::state dir_state,
+               ignore_rules           rules,
+               source_patterns const& patterns,
+               Emit&&                 emit,
+               Enter&&                enter) {
+    if (entries.is_build_dir) {
+        return;
+    }
+    if (entries.has_ignore_file) {
+        rules.add_file(dir / ignore_rules::file_name);
+    }
+    auto& files = entries.files;
+    if (!rules.empty()) {
+        files.erase(std::remove_if(files.begin(),
+                                   files.end(),
+                                   [&](std::string const& file) {
+                                       return rules.ignored(file, false);
+                                   }),
+                    files.end());
+    }
+    if (!files.empty()) {
+        emit(dir, files);
+    }
+    for (auto const& name : entries.subdirs) {
+        auto const sub = patterns.enter_directory(dir_state, name);
+        if (patterns.can_select_below(sub) && !rules.ignored(name, true)) {
+            enter(name, sub, rules.enter(name));
+        }
+    }
+}
+
+/**
+ * Passes the selected names in each directory of a walk to a `source_callback`, with the
+ * directory made relative to the root of the walk. Safe to call from multiple threads.
+ */
+class source_emitter {
+public:
+    source_emitter(fs::path const& root, source_callback const& fn);
+
+    /**
+     * Emit the sources `names` within `dir`, which must be the root of the walk, or below it and
+     * made from it with `operator/`.
+     */
+    void operator()(fs::path const& dir, std::vector<std::string> const& names);
+
+private:
+    source_callback const& _fn;
+    fs::path               _root;
+    std::size_t            _prefix_size;
+    std::mutex             _mutex;
+};
+
+}  // namespace detail
+
+}  // namespace pf
+
 #endif  // PF_FS_GLOB_HPP_INCLUDED
@@ -0,0 +1,147 @@
+#include "./ignore_rules.hpp"
+
+#include <pf/util/trace.hpp>
+
+#include <stdexcept>
+#include <string>
+
+namespace fs = pf::fs;
+
+namespace {
+
+// The pattern on a line of a .gitignore, or nothing for blank lines and comments
+std::string_view gitignore_pattern(std::string_view line) {
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    if (line.empty() || line[0] == '#') {
+        return {};
+    }
+    // Trailing spaces are dropped, unless escaped with a backslash
+    while (!line.empty() && line.back() == ' '
+           && !(line.size() >= 2 && line[line.size() - 2] == '\\')) {
+        line.remove_suffix(1);
+    }
+    return line;
+}
+
+bool is_valid_glob(std::string const& glob) {
+    try {
+        pf::source_patterns{{glob}};
+        return true;
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+}
+
+}  // namespace
+
+pf::source_patterns pf::compile_gitignore(std::string_view content) {
+    std::vector<std::string> globs;
+    while (!content.empty()) {
+        auto const eol  = content.find('\n');
+        auto const line = content.substr(0, eol);
+        content.remove_prefix(eol == content.npos ? content.size() : eol + 1);
+
+        auto const pattern = ::gitignore_pattern(line);
+        if (pattern.empty()) {
+            continue;
+        }
+        globs.emplace_back(pattern);
+        // Without a trailing slash, a pattern matches directories too. Both go in a row, so the
+        // order in which the lines take precedence is kept.
+        if (pattern.back() != '/') {
+            globs.push_back(std::string{pattern} + '/');
+        }
+    }
+
+    try {
+        return source_patterns{globs};
+    } catch (const std::runtime_error&) {
+        // Try again without the globs that fail on their own. If none do, the patterns are too
+        // complex, and that is thrown from here.
+    }
+    std::vector<std::string> valid;
+    for (auto& glob : globs) {
+        if (::is_valid_glob(glob)) {
+            valid.push_back(std::move(glob));
+        }
+    }
+    return source_patterns{std::move(valid)};
+}
+
+pf::ignore_rules pf::ignore_rules::for_directory(fs::path const& dir) {
+    pf::trace::span span{"ignore_rules::for_directory", dir};
+    std::error_code ec;
+    auto const      abs_dir = fs::weakly_canonical(dir, ec);
+    if (ec) {
+        return {};
+    }
+
+    // The nearest directory with a `.git`, which is a file in worktrees and submodules
+    fs::path repo = abs_dir;
+    while (!fs::exists(repo / ".git", ec)) {
+        if (repo == repo.parent_path()) {
+            return {};
+        }
+        repo = repo.parent_path();
+    }
+
+    ignore_rules rules;
+    if (fs::is_directory(repo / ".git", ec)) {
+        rules.add_file(repo / ".git" / "info" / "exclude");
+    }
+    rules.add_file(repo / file_name);
+    auto cur = repo;
+    for (auto const& part : abs_dir.lexically_relative(repo)) {
+        if (part == ".") {
+            continue;
+        }
+        auto const name = part.string();
+        if (rules.ignored(name, true)) {
+            rules._levels.clear();
+        }
+        rules = rules.enter(name);
+        cur /= part;
+        rules.add_file(cur / file_name);
+    }
+    return rules;
+}
+
+void pf::ignore_rules::add_file(fs::path const& file) {
+    std::error_code ec;
+    auto const      content = pf::map_file(file, ec);
+    if (ec) {
+        return;
+    }
+    try {
+        auto patterns = std::make_shared<source_patterns const>(compile_gitignore(content.view()));
+        _levels.push_back(level{patterns, patterns->start()});
+    } catch (const std::runtime_error&) {
+        // Too complex to compile. Better to search too much than to fail.
+    }
+}
+
+pf::ignore_rules pf::ignore_rules::enter(std::string_view name) const {
+    ignore_rules ret;
+    ret._levels.reserve(_levels.size());
+    for (auto const& lvl : _levels) {
+        ret._levels.push_back(level{lvl.patterns, lvl.patterns->enter_directory(lvl.state, name)});
+    }
+    return ret;
+}
+
+bool pf::ignore_rules::ignored(std::string_view name, bool is_directory) const {
+    if (is_directory && name == ".git") {
+        return true;
+    }
+    for (auto it = _levels.rbegin(); it != _levels.rend(); ++it) {
+        auto const& patterns = *it->patterns;
+        auto const  s        = is_directory ? patterns.enter_directory(it->state, name)
+                                            : patterns.advance(it->state, name);
+        if (patterns.has_match(s)) {
+            return patterns.selected(s);
+        }
+    }
+    return false;
+}
@@ -0,0 +1,77 @@
+#ifndef PF_FS_IGNORE_RULES_HPP_INCLUDED
+#define PF_FS_IGNORE_RULES_HPP_INCLUDED
+
+#include <pf/fs/core.hpp>
+#include <pf/fs/source_patterns.hpp>
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace pf {
+
+/**
+ * What git ignores among the entries of a directory: The rules of .git/info/exclude and of each
+ * .gitignore in the directory and above it, where a deeper file takes precedence, as does a later
+ * line within a file. The `.git` directory itself is always ignored.
+ *
+ * A walk carries the rules from each directory down to its subdirectories with `enter()`, adding
+ * those of any .gitignore it meets with `add_file()`. Each rule file is compiled once (see
+ * `source_patterns`) and shared by the copies, so each entry is matched by its name alone.
+ */
+class ignore_rules {
+public:
+    /// The name of the files that hold the rules for a directory
+    static constexpr std::string_view file_name = ".gitignore";
+
+    /// No rules: Nothing but `.git` is ignored
+    ignore_rules() = default;
+
+    /**
+     * The rules for the entries of `dir`, from .git/info/exclude and each .gitignore between the
+     * root of the git repository that holds `dir` and `dir` itself. Outside of a repository,
+     * there are none. If `dir` lies within an ignored directory, the rules above that directory
+     * are left out, since `dir` was asked for explicitly.
+     */
+    static ignore_rules for_directory(fs::path const& dir);
+
+    /**
+     * Add the rules of `file`, which apply to the same directory as these rules. A file that
+     * cannot be read, or that is too complex to compile, ignores nothing.
+     */
+    void add_file(fs::path const& file);
+
+    /// The rules for the entries of `name`, a subdirectory of the directory these rules are for
+    ignore_rules enter(std::string_view name) const;
+
+    /// Whether the entry `name` is ignored
+    bool ignored(std::string_view name, bool is_directory) const;
+
+    bool empty() const noexcept { return _levels.empty(); }
+
+private:
+    struct level {
+        std::shared_ptr<source_patterns const> patterns;
+        source_patterns::state                 state;
+    };
+
+    // Shallowest (and lowest precedence) first
+    std::vector<level> _levels;
+};
+
+/**
+ * Compile the content of a .gitignore into patterns that select what it ignores. A path names a
+ * directory if it ends with `/`. Lines that are not valid patterns are left out, as they match
+ * nothing in git. Throws `std::runtime_error` if the patterns are too complex to compile.
+ */
+source_patterns compile_gitignore(std::string_view content);
+
+/**
+ * Whether a directory holding an entry called `name` is a CMake build directory, whose content
+ * is generated and never searched for sources.
+ */
+inline bool marks_build_dir(std::string_view name) noexcept { return name == "CMakeCache.txt"; }
+
+}  // namespace pf
+
+#endif  // PF_FS_IGNORE_RULES_HPP_INCLUDED
@@ -0,0 +1,135 @@
+#include "./path_set.hpp"
+
+#include <pf/util/trace.hpp>
+
+#include <cerrno>
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <system_error>
+
+namespace {
+
+[[noreturn]] void throw_errno(char const* what) {
+    throw std::system_error{std::error_code{errno, std::system_category()}, what};
+}
+
+// Each path in a run is its size followed by its bytes
+void write_path(std::FILE* f, std::string_view path) {
+    auto const size = static_cast<std::uint32_t>(path.size());
+    if (std::fwrite(&size, sizeof size, 1, f) != 1
+        || std::fwrite(path.data(), 1, path.size(), f) != path.size()) {
+        throw_errno("Failed to spill sorted paths");
+    }
+}
+
+// Reads a run back from the start, one path at a time
+class run_reader {
+    std::FILE*  _file;
+    std::string _current;
+
+public:
+    explicit run_reader(std::FILE* f)
+        : _file{f} {
+        std::rewind(_file);
+    }
+
+    std::string const& current() const noexcept { return _current; }
+
+    // Read the next path, returning false at the end of the run
+    bool next() {
+        std::uint32_t size = 0;
+        if (std::fread(&size, sizeof size, 1, _file) != 1) {
+            if (std::ferror(_file)) {
+                throw_errno("Failed to read spilled paths");
+            }
+            return false;
+        }
+        _current.resize(size);
+        if (std::fread(_current.data(), 1, size, _file) != size) {
+            throw_errno("Failed to read spilled paths");
+        }
+        return true;
+    }
+};
+
+}  // namespace
+
+pf::path_set::path_set(std::size_t memory_limit)
+    : _memory_limit{memory_limit} {}
+
+void pf::path_set::insert_in(std::string_view dir, std::string_view name) {
+    _trie.insert_in(dir, name);
+    if (_trie.memory_usage() > _memory_limit) {
+        _spill();
+    }
+}
+
+void pf::path_set::_spill() {
+    pf::trace::span span{"path_set::spill"};
+    run_file        f{std::tmpfile()};
+    if (!f) {
+        throw_errno("Failed to create a file to spill sorted paths");
+    }
+    _trie.for_each([&](std::string_view path) { ::write_path(f.get(), path); });
+    if (std::fflush(f.get()) != 0) {
+        throw_errno("Failed to spill sorted paths");
+    }
+    _runs.push_back(std::move(f));
+    _trie.clear();
+}
+
+void pf::path_set::for_each(std::function<void(std::string_view)> const& fn) const {
+    if (_runs.empty()) {
+        _trie.for_each(fn);
+        return;
+    }
+
+    // Merge the runs, along with what is in memory as one more. Each source holds its next path,
+    // and the sources are ordered by it.
+    std::vector<std::string> in_memory     = _trie.strings();
+    std::size_t              in_memory_pos = 0;
+    std::vector<run_reader>  readers;
+    readers.reserve(_runs.size());
+    for (auto const& run : _runs) {
+        readers.emplace_back(run.get());
+    }
+
+    auto const n_readers = readers.size();
+    auto const head      = [&](std::size_t source) -> std::string const& {
+        return source < n_readers ? readers[source].current() : in_memory[in_memory_pos];
+    };
+    auto const advance = [&](std::size_t source) {
+        if (source < n_readers) {
+            return readers[source].next();
+        }
+        return ++in_memory_pos < in_memory.size();
+    };
+    auto const later = [&](std::size_t lhs, std::size_t rhs) {
+        return pf::path_less(head(rhs), head(lhs));
+    };
+    std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(later)> queue{later};
+    for (std::size_t source = 0; source < n_readers; ++source) {
+        if (readers[source].next()) {
+            queue.push(source);
+        }
+    }
+    if (!in_memory.empty()) {
+        queue.push(n_readers);
+    }
+
+    std::string last;
+    bool        first = true;
+    while (!queue.empty()) {
+        auto const source = queue.top();
+        queue.pop();
+        if (first || head(source) != last) {
+            last  = head(source);
+            first = false;
+            fn(last);
+        }
+        if (advance(source)) {
+            queue.push(source);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef PF_FS_PATH_SET_HPP_INCLUDED
+#define PF_FS_PATH_SET_HPP_INCLUDED
+
+#include <pf/fs/path_trie.hpp>
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace pf {
+
+/**
+ * A set of relative paths that keeps its memory use bounded, for listing arbitrarily large trees.
+ *
+ * Paths are gathered in a `path_trie`. Once it holds more than the memory limit, its paths are
+ * written out in order as a run to an anonymous temporary file, and it starts over empty.
+ * Iterating merges the runs with what is still in memory, so paths come out in the order of
+ * `path_trie`, and a path added both before and after a spill still comes out once.
+ */
+class path_set {
+public:
+    /// Enough for a few hundred thousand paths before anything is spilled
+    static constexpr std::size_t default_memory_limit = 64 * 1024 * 1024;
+
+    explicit path_set(std::size_t memory_limit = default_memory_limit);
+
+    /// Add `name` within the directory `dir`, as with `path_trie::insert_in`
+    void insert_in(std::string_view dir, std::string_view name);
+    /// Add `path`
+    void insert(std::string_view path) { insert_in({}, path); }
+
+    /**
+     * Call `fn` with each path in the set, in order. The string is only valid for the duration of
+     * the call. Throws `std::system_error` if a spilled run cannot be read back.
+     */
+    void for_each(std::function<void(std::string_view)> const& fn) const;
+
+    /// The number of runs written to temporary files so far
+    std::size_t spilled_runs() const noexcept { return _runs.size(); }
+
+private:
+    struct file_closer {
+        void operator()(std::FILE* f) const noexcept { std::fclose(f); }
+    };
+    using run_file = std::unique_ptr<std::FILE, file_closer>;
+
+    std::size_t           _memory_limit;
+    path_trie             _trie;
+    std::vector<run_file> _runs;
+
+    void _spill();
+};
+
+}  // namespace pf
+
+#endif  // PF_FS_PATH_SET_HPP_INCLUDED
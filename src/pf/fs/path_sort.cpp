@@ -0,0 +1,170 @@
+#include "./path_sort.hpp"
+
+#include <pf/util/task_pool.hpp>
+#include <pf/util/trace.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace fs = pf::fs;
+
+namespace {
+
+struct sort_key {
+    char const*   data;
+    std::uint32_t size;
+    std::uint32_t index;
+};
+
+// Ranges smaller than this are sorted by comparison, where a radix pass costs more than it saves
+constexpr std::size_t SmallRange = 32;
+// Buckets larger than this are sorted as tasks of their own, when there is a pool to run them
+constexpr std::size_t TaskRange = 16 * 1024;
+
+// Compare keys that are known to be equal up to `depth`
+bool key_less(sort_key const& lhs, sort_key const& rhs, std::size_t depth) {
+    auto const size = std::min(lhs.size, rhs.size);
+    if (size > depth) {
+        auto const cmp = std::memcmp(lhs.data + depth, rhs.data + depth, size - depth);
+        if (cmp != 0) {
+            return cmp < 0;
+        }
+    }
+    return lhs.size < rhs.size;
+}
+
+class radix_sorter {
+    std::vector<sort_key> _scratch;
+    pf::task_pool*        _pool;
+
+    // The bucket of a key at `depth`: Zero if it ends there, otherwise one more than its byte
+    static std::size_t _bucket(sort_key const& key, std::size_t depth) {
+        return depth < key.size ? static_cast<unsigned char>(key.data[depth]) + 1u : 0u;
+    }
+
+public:
+    radix_sorter(std::size_t size, pf::task_pool* pool)
+        : _scratch(size)
+        , _pool{pool} {}
+
+    // Sort keys[first, last), which are equal up to `depth`
+    void sort(sort_key* keys, std::size_t first, std::size_t last, std::size_t depth) {
+        while (last - first >= SmallRange) {
+            std::array<std::size_t, 257> counts{};
+            for (auto i = first; i < last; ++i) {
+                ++counts[_bucket(keys[i], depth)];
+            }
+            // Keys in a directory share a long prefix, and their bytes all fall in one bucket
+            if (std::find(counts.begin() + 1, counts.end(), last - first) != counts.end()) {
+                ++depth;
+                continue;
+            }
+
+            std::array<std::size_t, 257> starts;
+            std::size_t                  offset = first;
+            for (auto b = 0u; b < counts.size(); ++b) {
+                starts[b] = offset;
+                offset += counts[b];
+            }
+            auto next = starts;
+            for (auto i = first; i < last; ++i) {
+                _scratch[next[_bucket(keys[i], depth)]++] = keys[i];
+            }
+            std::copy(_scratch.begin() + static_cast<std::ptrdiff_t>(first),
+                      _scratch.begin() + static_cast<std::ptrdiff_t>(last),
+                      keys + first);
+
+            // The keys that ended are equal, and sort first. The rest go one byte deeper.
+            for (auto b = 1u; b < counts.size(); ++b) {
+                auto const begin = starts[b];
+                auto const end   = begin + counts[b];
+                if (counts[b] < 2) {
+                    continue;
+                }
+                if (_pool && counts[b] >= TaskRange) {
+                    _pool->submit([this, keys, begin, end, depth] {
+                        sort(keys, begin, end, depth + 1);
+                    });
+                } else {
+                    sort(keys, begin, end, depth + 1);
+                }
+            }
+            return;
+        }
+        std::sort(keys + first, keys + last, [depth](sort_key const& lhs, sort_key const& rhs) {
+            return ::key_less(lhs, rhs, depth);
+        });
+    }
+};
+
+}  // namespace
+
+void pf::sort_paths(std::vector<fs::path>& paths, fs::path const& base, task_pool* pool) {
+    pf::trace::span span{"sort_paths"};
+#if defined(_WIN32)
+    (void)base;
+    (void)pool;
+    std::sort(paths.begin(), paths.end());
+#else
+    // Paths below the base continue after a separator, unless the base ends with one. With an
+    // empty base, any relative path is below it.
+    std::string_view const base_str    = base.native();
+    auto                   prefix_size = base_str.size();
+    if (!base_str.empty() && base_str.back() != '/') {
+        ++prefix_size;
+    }
+    auto const is_below = [&](std::string_view native) {
+        if (base_str.empty()) {
+            return native.empty() || native.front() != '/';
+        }
+        if (native.substr(0, base_str.size()) != base_str) {
+            return false;
+        }
+        return native.size() == base_str.size() || native[prefix_size - 1] == '/';
+    };
+
+    std::size_t key_bytes = 0;
+    for (auto const& path : paths) {
+        std::string_view const native = path.native();
+        if (!is_below(native)) {
+            std::sort(paths.begin(), paths.end());
+            return;
+        }
+        key_bytes += native.size() - std::min(native.size(), prefix_size);
+    }
+
+    // All keys live in one buffer, which is never reallocated once they point into it
+    std::string           buffer;
+    std::vector<sort_key> keys;
+    buffer.reserve(key_bytes);
+    keys.reserve(paths.size());
+    for (auto const& path : paths) {
+        std::string_view native = path.native();
+        native.remove_prefix(std::min(native.size(), prefix_size));
+        auto const offset = buffer.size();
+        buffer.append(native);
+        std::replace(buffer.begin() + static_cast<std::ptrdiff_t>(offset), buffer.end(), '/', '\0');
+        keys.push_back(sort_key{buffer.data() + offset,
+                                static_cast<std::uint32_t>(native.size()),
+                                static_cast<std::uint32_t>(keys.size())});
+    }
+
+    radix_sorter sorter{keys.size(), pool};
+    if (pool) {
+        pool->submit([&] { sorter.sort(keys.data(), 0, keys.size(), 0); });
+        pool->wait();
+    } else {
+        sorter.sort(keys.data(), 0, keys.size(), 0);
+    }
+
+    std::vector<fs::path> sorted;
+    sorted.reserve(paths.size());
+    for (auto const& key : keys) {
+        sorted.push_back(std::move(paths[key.index]));
+    }
+    paths = std::move(sorted);
+#endif
+}
@@ -0,0 +1,30 @@
+#ifndef PF_FS_PATH_SORT_HPP_INCLUDED
+#define PF_FS_PATH_SORT_HPP_INCLUDED
+
+#include <pf/fs/core.hpp>
+
+#include <vector>
+
+namespace pf {
+
+class task_pool;
+
+/**
+ * Sort `paths`, which must all be `base` or below it, into the same order as `std::sort` would.
+ *
+ * That order compares paths component by component, and two components by their bytes (as
+ * unsigned), where a component that is a prefix of another sorts first. So "a/x" sorts before
+ * "a-b/x" and "a.txt", though '/' is between '-' and '.' in ASCII. This is the order in which
+ * sources are listed in CMakeLists.txt files, which must not change from one version to the
+ * next.
+ *
+ * Each path is made into a flat key once: its bytes below `base`, with '/' replaced by a zero
+ * byte, which cannot appear in a name. The keys are sorted with an MSD radix sort, whose larger
+ * buckets are sorted as tasks on `pool`, if one is given. Paths that are not below `base`, and
+ * paths on Windows, are sorted with `std::sort`.
+ */
+void sort_paths(std::vector<fs::path>& paths, fs::path const& base, task_pool* pool = nullptr);
+
+}  // namespace pf
+
+#endif  // PF_FS_PATH_SORT_HPP_INCLUDED
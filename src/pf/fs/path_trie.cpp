@@ -0,0 +1,155 @@
+#include "./path_trie.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+constexpr std::size_t InitialSlots = 64;
+
+// Split off the first component of `path`, skipping empty ones
+std::string_view next_component(std::string_view& path) {
+    while (!path.empty() && path.front() == '/') {
+        path.remove_prefix(1);
+    }
+    auto const end  = path.find('/');
+    auto const part = path.substr(0, end);
+    path.remove_prefix(part.size());
+    return part;
+}
+
+}  // namespace
+
+pf::path_trie::path_trie()
+    : _nodes{node_data{none, 0, 0}}
+    , _slots(InitialSlots, 0) {}
+
+std::size_t pf::path_trie::_slot_of(node parent, std::string_view name) const noexcept {
+    auto const hash = std::hash<std::string_view>{}(name) ^ (parent * 0x9e3779b97f4a7c15ull);
+    return hash & (_slots.size() - 1);
+}
+
+pf::path_trie::node pf::path_trie::_find(node parent, std::string_view name) const noexcept {
+    for (auto slot = _slot_of(parent, name);; slot = (slot + 1) & (_slots.size() - 1)) {
+        auto const n = _slots[slot];
+        if (n == 0) {
+            return none;
+        }
+        auto const& data = _nodes[n];
+        if (data.parent == parent && _name(data) == name) {
+            return n;
+        }
+    }
+}
+
+void pf::path_trie::_grow() {
+    _slots.assign(_slots.size() * 2, 0);
+    for (node n = 1; n < _nodes.size(); ++n) {
+        auto slot = _slot_of(_nodes[n].parent, _name(_nodes[n]));
+        while (_slots[slot] != 0) {
+            slot = (slot + 1) & (_slots.size() - 1);
+        }
+        _slots[slot] = n;
+    }
+}
+
+pf::path_trie::node pf::path_trie::_child(node parent, std::string_view name) {
+    auto const found = _find(parent, name);
+    if (found != none) {
+        return found;
+    }
+    // Keep the table at most half full
+    if ((_nodes.size() + 1) * 2 > _slots.size()) {
+        _grow();
+    }
+    auto const n = static_cast<node>(_nodes.size());
+    _nodes.push_back(node_data{parent,
+                               static_cast<std::uint32_t>(_names.size()),
+                               static_cast<std::uint32_t>(name.size())});
+    _names.append(name);
+    auto& parent_data          = _nodes[parent];
+    _nodes.back().next_sibling = parent_data.first_child;
+    parent_data.first_child    = n;
+
+    auto slot = _slot_of(parent, name);
+    while (_slots[slot] != 0) {
+        slot = (slot + 1) & (_slots.size() - 1);
+    }
+    _slots[slot] = n;
+    return n;
+}
+
+pf::path_trie::node pf::path_trie::find_or_add(std::string_view path, node parent) {
+    auto n = parent;
+    for (auto part = ::next_component(path); !part.empty(); part = ::next_component(path)) {
+        n = _child(n, part);
+    }
+    return n;
+}
+
+bool pf::path_trie::insert(std::string_view path, node parent) {
+    auto const n = find_or_add(path, parent);
+    if (n == parent || _nodes[n].is_path) {
+        return false;
+    }
+    _nodes[n].is_path = true;
+    ++_size;
+    return true;
+}
+
+bool pf::path_trie::insert_in(std::string_view dir, std::string_view name) {
+    if (_last_dir_node == none || dir != _last_dir) {
+        _last_dir_node = find_or_add(dir);
+        _last_dir      = dir;
+    }
+    return insert(name, _last_dir_node);
+}
+
+bool pf::path_trie::contains(std::string_view path) const {
+    auto n = root;
+    for (auto part = ::next_component(path); !part.empty(); part = ::next_component(path)) {
+        n = _find(n, part);
+        if (n == none) {
+            return false;
+        }
+    }
+    return n != root && _nodes[n].is_path;
+}
+
+std::vector<pf::path_trie::node> pf::path_trie::_sorted_children(node parent) const {
+    std::vector<node> children;
+    for (auto n = _nodes[parent].first_child; n != none; n = _nodes[n].next_sibling) {
+        children.push_back(n);
+    }
+    std::sort(children.begin(), children.end(), [&](node lhs, node rhs) {
+        return _name(_nodes[lhs]) < _name(_nodes[rhs]);
+    });
+    return children;
+}
+
+std::vector<std::string> pf::path_trie::strings() const {
+    std::vector<std::string> ret;
+    ret.reserve(_size);
+    for_each([&](std::string_view path) { ret.emplace_back(path); });
+    return ret;
+}
+
+std::size_t pf::path_trie::memory_usage() const noexcept {
+    return _nodes.capacity() * sizeof(node_data) + _names.capacity()
+        + _slots.capacity() * sizeof(node);
+}
+
+bool pf::path_less(std::string_view lhs, std::string_view rhs) noexcept {
+    auto const size = std::min(lhs.size(), rhs.size());
+    for (std::size_t i = 0; i < size; ++i) {
+        if (lhs[i] == rhs[i]) {
+            continue;
+        }
+        // A component that ends first sorts first
+        if (lhs[i] == '/' || rhs[i] == '/') {
+            return lhs[i] == '/';
+        }
+        return static_cast<unsigned char>(lhs[i]) < static_cast<unsigned char>(rhs[i]);
+    }
+    return lhs.size() < rhs.size();
+}
@@ -0,0 +1,136 @@
+#ifndef PF_FS_PATH_TRIE_HPP_INCLUDED
+#define PF_FS_PATH_TRIE_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pf {
+
+/**
+ * A set of relative paths, stored as a tree of their components, so that a directory shared by
+ * many paths is stored once.
+ *
+ * All nodes live in a single array, and all names in a single buffer, so a path costs a fixed-size
+ * node and the bytes of its last component. Children are found with a hash table keyed by parent
+ * and name.
+ *
+ * Paths are iterated as '/'-separated strings, in the same order as the `fs::path` objects they
+ * name would sort in: component by component, comparing the bytes of each.
+ */
+class path_trie {
+public:
+    using node = std::uint32_t;
+
+    /// The node of the empty path, which all paths are relative to
+    static constexpr node root = 0;
+
+    path_trie();
+
+    /**
+     * Get the node of `path`, relative to `parent`, adding it and any nodes above it if need be.
+     * `path` is split at each '/', and empty components are skipped. Adding a node does not add
+     * its path to the set, so this is suited to naming directories that hold paths.
+     */
+    node find_or_add(std::string_view path, node parent = root);
+
+    /**
+     * Add `path`, relative to `parent`, to the set. Returns `false` if it was present already.
+     */
+    bool insert(std::string_view path, node parent = root);
+
+    /**
+     * Add `name` within the directory `dir` to the set, as with `insert`. The node of the last
+     * directory is remembered, so a run of names in the same directory only looks it up once.
+     */
+    bool insert_in(std::string_view dir, std::string_view name);
+
+    /// Whether `path` was added to the set
+    bool contains(std::string_view path) const;
+
+    /// The number of paths in the set
+    std::size_t size() const noexcept { return _size; }
+    bool        empty() const noexcept { return _size == 0; }
+
+    /**
+     * Call `fn(std::string_view)` with each path in the set, in order. The string is only valid
+     * for the duration of the call.
+     */
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        std::string path;
+        _for_each(root, path, fn);
+    }
+
+    /// The paths in the set, in order
+    std::vector<std::string> strings() const;
+
+    /// The number of bytes allocated to hold the set
+    std::size_t memory_usage() const noexcept;
+
+    /// Remove every path, releasing the memory held
+    void clear() { *this = path_trie{}; }
+
+private:
+    static constexpr node none = ~node{0};
+
+    struct node_data {
+        node          parent;
+        std::uint32_t name_offset;
+        std::uint32_t name_size;
+        node          first_child  = none;
+        node          next_sibling = none;
+        bool          is_path      = false;
+    };
+
+    std::vector<node_data> _nodes;
+    std::string            _names;
+    // Open addressing on (parent, name), holding node indices. Zero marks an empty slot, since the
+    // root is never a child.
+    std::vector<node> _slots;
+    std::size_t       _size = 0;
+    // The last directory given to insert_in()
+    std::string _last_dir;
+    node        _last_dir_node = none;
+
+    std::string_view _name(node_data const& n) const noexcept {
+        return std::string_view{_names}.substr(n.name_offset, n.name_size);
+    }
+    std::size_t       _slot_of(node parent, std::string_view name) const noexcept;
+    node              _find(node parent, std::string_view name) const noexcept;
+    node              _child(node parent, std::string_view name);
+    void              _grow();
+    std::vector<node> _sorted_children(node parent) const;
+
+    template <typename Fn>
+    void _for_each(node parent, std::string& path, Fn& fn) const {
+        for (auto child : _sorted_children(parent)) {
+            auto const& data      = _nodes[child];
+            auto const  prev_size = path.size();
+            if (parent != root) {
+                path.push_back('/');
+            }
+            path.append(_name(data));
+            if (data.is_path) {
+                fn(std::string_view{path});
+            }
+            if (data.first_child != none) {
+                _for_each(child, path, fn);
+            }
+            path.resize(prev_size);
+        }
+    }
+};
+
+/**
+ * Whether `lhs` sorts before `rhs`, where both are relative paths with '/' separators, in the
+ * order of `path_trie`: Component by component, which is the same as comparing bytes with '/'
+ * ordered before all others.
+ */
+bool path_less(std::string_view lhs, std::string_view rhs) noexcept;
+
+}  // namespace pf
+
+#endif  // PF_FS_PATH_TRIE_HPP_INCLUDED
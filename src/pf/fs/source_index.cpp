@@ -0,0 +1,512 @@
+#include "./source_index.hpp"
+
+#include <pf/fs/glob.hpp>
+#include <pf/fs/ignore_rules.hpp>
+#include <pf/fs/path_sort.hpp>
+#include <pf/util/task_pool.hpp>
+#include <pf/util/trace.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#endif
+
+namespace fs = pf::fs;
+
+namespace {
+
+constexpr char          IndexMagic[8] = {'P', 'F', 'I', 'N', 'D', 'E', 'X', '\0'};
+constexpr std::uint32_t ByteOrderMark = 0x01020304;
+
+// Directories modified within this window of being listed are not trusted on the next run, since
+// a later change in the same timestamp tick would otherwise go unnoticed.
+constexpr std::int64_t RacyWindowNs = 2'000'000'000;
+
+/**
+ * On-disk layout. All integers are in host byte order, and the file is discarded if the byte
+ * order mark does not match. The header is followed immediately by `dir_count` dir_records
+ * (sorted by path), `entry_count` entry_records, and `strings_size` bytes of string data.
+ */
+struct file_header {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint64_t dir_count;
+    std::uint64_t entry_count;
+    std::uint64_t strings_size;
+    // The source_patterns::fingerprint() of the patterns that chose the sources
+    std::uint64_t patterns;
+};
+
+struct dir_record {
+    std::uint64_t dev;
+    std::uint64_t ino;
+    std::int64_t  mtime_ns;
+    std::int64_t  ctime_ns;
+    std::uint32_t path_offset;
+    std::uint32_t path_size;
+    std::uint32_t first_entry;
+    std::uint32_t entry_count;
+    std::uint32_t flags;
+    std::uint32_t reserved;
+};
+
+struct entry_record {
+    std::uint32_t name_offset;
+    std::uint32_t name_size;
+    std::uint32_t flags;
+    std::uint32_t reserved;
+};
+
+enum dir_flags : std::uint32_t {
+    // The directory changed too recently for its mtime to be trusted
+    is_racy = 1 << 0,
+    // The directory was the root of a glob, which lists only its subdirectories
+    is_top_level = 1 << 1,
+    // The directory has a .gitignore, which is read again on each walk
+    has_ignore_file = 1 << 2,
+    // The directory holds a CMakeCache.txt, so none of its entries are recorded
+    is_build_dir = 1 << 3,
+};
+
+enum entry_flags : std::uint32_t {
+    is_source = 1 << 0,
+    is_subdir = 1 << 1,
+};
+
+static_assert(sizeof(file_header) == 48);
+static_assert(sizeof(dir_record) == 56);
+static_assert(sizeof(entry_record) == 16);
+
+template <typename T>
+T read_at(std::string_view buf, std::size_t offset) {
+    T ret;
+    std::memcpy(&ret, buf.data() + offset, sizeof ret);
+    return ret;
+}
+
+// Access to each section of a loaded index
+struct index_layout {
+    std::string_view buf;
+    file_header      header;
+    std::size_t      dirs_begin;
+    std::size_t      entries_begin;
+    std::size_t      strings_begin;
+
+    explicit index_layout(std::string_view buf_)
+        : buf(buf_)
+        , header(read_at<file_header>(buf, 0))
+        , dirs_begin(sizeof(file_header))
+        , entries_begin(dirs_begin + header.dir_count * sizeof(dir_record))
+        , strings_begin(entries_begin + header.entry_count * sizeof(entry_record)) {}
+
+    dir_record dir(std::size_t i) const {
+        return read_at<dir_record>(buf, dirs_begin + i * sizeof(dir_record));
+    }
+    entry_record entry(std::size_t i) const {
+        return read_at<entry_record>(buf, entries_begin + i * sizeof(entry_record));
+    }
+    std::string_view string(std::uint32_t offset, std::uint32_t size) const {
+        return buf.substr(strings_begin + offset, size);
+    }
+};
+
+// Read back the entries recorded for `dir`
+pf::detail::dir_entries read_entries(index_layout const& layout, dir_record const& dir) {
+    pf::detail::dir_entries ret;
+    ret.has_ignore_file = (dir.flags & has_ignore_file) != 0;
+    ret.is_build_dir    = (dir.flags & is_build_dir) != 0;
+    for (auto i = 0u; i < dir.entry_count; ++i) {
+        auto ent  = layout.entry(dir.first_entry + i);
+        auto name = std::string{layout.string(ent.name_offset, ent.name_size)};
+        if (ent.flags & is_subdir) {
+            ret.subdirs.push_back(std::move(name));
+        } else if (ent.flags & is_source) {
+            ret.files.push_back(std::move(name));
+        }
+    }
+    return ret;
+}
+
+template <typename T>
+void append(std::string& buf, T const& what) {
+    buf.append(reinterpret_cast<const char*>(&what), sizeof what);
+}
+
+pf::source_index::dir_stamp stat_dir(fs::path const& dir) {
+    pf::source_index::dir_stamp ret;
+#if defined(_WIN32)
+    ret.mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       fs::last_write_time(dir).time_since_epoch())
+                       .count();
+#else
+    struct ::stat st;
+    if (::stat(dir.c_str(), &st) != 0) {
+        throw fs::filesystem_error{"Failed to stat directory",
+                                   dir,
+                                   std::error_code{errno, std::system_category()}};
+    }
+    ret.dev = static_cast<std::uint64_t>(st.st_dev);
+    ret.ino = static_cast<std::uint64_t>(st.st_ino);
+#if defined(__APPLE__)
+    ret.mtime_ns = st.st_mtimespec.tv_sec * 1'000'000'000ll + st.st_mtimespec.tv_nsec;
+    ret.ctime_ns = st.st_ctimespec.tv_sec * 1'000'000'000ll + st.st_ctimespec.tv_nsec;
+#else
+    ret.mtime_ns = st.st_mtim.tv_sec * 1'000'000'000ll + st.st_mtim.tv_nsec;
+    ret.ctime_ns = st.st_ctim.tv_sec * 1'000'000'000ll + st.st_ctim.tv_nsec;
+#endif
+#endif
+    return ret;
+}
+
+std::int64_t now_ns() {
+#if defined(_WIN32)
+    auto now = fs::file_time_type::clock::now();
+#else
+    auto now = std::chrono::system_clock::now();
+#endif
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+}
+
+bool is_under(std::string_view key, std::string_view root) {
+    return key == root
+        || (key.size() > root.size() && key.compare(0, root.size(), root) == 0
+            && key[root.size()] == '/');
+}
+
+}  // namespace
+
+pf::source_index::source_index(fs::path root)
+    : _root(std::move(root)) {}
+
+pf::source_index pf::source_index::load(fs::path root, fs::path const& index_file) {
+    source_index ret{std::move(root)};
+
+    std::error_code ec;
+    auto            file = pf::map_file(index_file, ec);
+    if (ec || file.size() < sizeof(file_header)) {
+        return ret;
+    }
+    auto const content = file.view();
+
+    auto header = read_at<file_header>(content, 0);
+    if (std::memcmp(header.magic, IndexMagic, sizeof IndexMagic) != 0
+        || header.version != format_version || header.byte_order != ByteOrderMark) {
+        return ret;
+    }
+    auto const expected_size = sizeof(file_header) + header.dir_count * sizeof(dir_record)
+        + header.entry_count * sizeof(entry_record) + header.strings_size;
+    if (content.size() != expected_size) {
+        return ret;
+    }
+
+    // Check the offsets up front so lookups do not need to
+    index_layout const layout{content};
+    for (auto i = 0u; i < header.dir_count; ++i) {
+        auto dir = layout.dir(i);
+        if (std::uint64_t{dir.path_offset} + dir.path_size > header.strings_size
+            || std::uint64_t{dir.first_entry} + dir.entry_count > header.entry_count) {
+            return ret;
+        }
+    }
+    for (auto i = 0u; i < header.entry_count; ++i) {
+        auto ent = layout.entry(i);
+        if (std::uint64_t{ent.name_offset} + ent.name_size > header.strings_size) {
+            return ret;
+        }
+    }
+
+    ret._loaded        = std::move(file);
+    ret._n_loaded_dirs = header.dir_count;
+    ret._patterns      = header.patterns;
+    return ret;
+}
+
+std::string pf::source_index::_key_for(fs::path const& dir) const {
+    auto rel = dir.lexically_relative(_root);
+    if (rel.empty() || *rel.begin() == "..") {
+        return dir.generic_string();
+    }
+    return rel.generic_string();
+}
+
+bool pf::source_index::_find_loaded(std::string_view key, dir_listing& want) const {
+    if (_n_loaded_dirs == 0) {
+        return false;
+    }
+    index_layout const layout{_loaded.view()};
+
+    // Binary search on the sorted directory records
+    std::size_t lo = 0;
+    std::size_t hi = _n_loaded_dirs;
+    while (lo < hi) {
+        auto mid = lo + (hi - lo) / 2;
+        auto dir = layout.dir(mid);
+        if (layout.string(dir.path_offset, dir.path_size) < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == _n_loaded_dirs) {
+        return false;
+    }
+
+    auto const dir = layout.dir(lo);
+    if (layout.string(dir.path_offset, dir.path_size) != key) {
+        return false;
+    }
+    dir_stamp const stamp{dir.dev, dir.ino, dir.mtime_ns, dir.ctime_ns};
+    if (!(stamp == want.stamp) || (dir.flags & is_racy)
+        || (dir.flags & is_top_level) != (want.flags & is_top_level)) {
+        return false;
+    }
+    want.entries = ::read_entries(layout, dir);
+    return true;
+}
+
+pf::source_index::dir_listing const& pf::source_index::_list(fs::path const&        dir,
+                                                            bool                   top_level,
+                                                            source_patterns const& patterns,
+                                                            source_patterns::state dir_state,
+                                                            glob_options const&    opts) {
+    dir_listing listing;
+    listing.stamp = ::stat_dir(dir);
+    listing.flags = top_level ? std::uint32_t{is_top_level} : 0u;
+
+    auto const key    = _key_for(dir);
+    bool const listed = !_find_loaded(key, listing);
+    if (listed) {
+        listing.entries = detail::list_dir(dir, top_level, patterns, dir_state, opts);
+        if (::now_ns() - listing.stamp.mtime_ns < RacyWindowNs) {
+            listing.flags |= is_racy;
+        }
+    } else {
+        pf::trace::add(pf::trace::counter::directories_visited, 1);
+    }
+
+    // References into a std::map remain valid as more directories are inserted
+    std::lock_guard lk{*_visited_mutex};
+    if (listed) {
+        ++_n_listed;
+        _dirty = true;
+    }
+    return _visited[key] = std::move(listing);
+}
+
+void pf::source_index::_glob(fs::path const&     relative_to,
+                             glob_options const& opts,
+                             emit_fn const&      emit) {
+    auto const& patterns = opts.patterns ? *opts.patterns : source_patterns::defaults();
+    if (patterns.fingerprint() != _patterns) {
+        // Which files are sources depends on the patterns, so nothing recorded so far can be used
+        _loaded        = mapped_file{};
+        _n_loaded_dirs = 0;
+        _visited.clear();
+        _dirty    = true;
+        _patterns = patterns.fingerprint();
+    }
+
+    // Listed as in glob_sources(), but only where the index does not have the listing already
+    using state     = source_patterns::state;
+    auto const root = ignore_rules::for_directory(relative_to);
+    auto const visit
+        = [&](fs::path const& dir,
+              bool            top_level,
+              state           dir_state,
+              ignore_rules    rules,
+              auto&&          enter) {
+              detail::visit_dir(dir,
+                                _list(dir, top_level, patterns, dir_state, opts).entries,
+                                dir_state,
+                                std::move(rules),
+                                patterns,
+                                emit,
+                                [&](std::string const& name, state sub, ignore_rules sub_rules) {
+                                    enter(dir / name, sub, std::move(sub_rules));
+                                });
+          };
+
+    if (opts.jobs == 1) {
+        auto walk = [&](auto&           self,
+                        fs::path const& dir,
+                        bool            top_level,
+                        state           dir_state,
+                        ignore_rules    rules) -> void {
+            visit(dir,
+                  top_level,
+                  dir_state,
+                  std::move(rules),
+                  [&](fs::path const& child, state sub, ignore_rules sub_rules) {
+                      self(self, child, false, sub, std::move(sub_rules));
+                  });
+        };
+        walk(walk, relative_to, true, patterns.start(), root);
+    } else {
+        pf::task_pool pool{opts.jobs};
+        auto walk = [&](auto&           self,
+                        fs::path const& dir,
+                        bool            top_level,
+                        state           dir_state,
+                        ignore_rules    rules) -> void {
+            visit(dir,
+                  top_level,
+                  dir_state,
+                  std::move(rules),
+                  [&](fs::path const& child, state sub, ignore_rules sub_rules) {
+                      pool.submit([&self, child, sub, sub_rules = std::move(sub_rules)]() mutable {
+                          self(self, child, false, sub, std::move(sub_rules));
+                      });
+                  });
+        };
+        try {
+            walk(walk, relative_to, true, patterns.start(), root);
+        } catch (...) {
+            // The tasks already submitted refer to `walk`, so they must finish before it goes
+            try {
+                pool.wait();
+            } catch (...) {
+            }
+            throw;
+        }
+        pool.wait();
+    }
+
+    // A directory that has been removed will not be visited, but the index still needs to change
+    auto const root_key = _key_for(relative_to);
+    _scanned_roots.insert(root_key);
+    if (_n_loaded_dirs && !_dirty) {
+        index_layout const layout{_loaded.view()};
+        for (auto i = 0u; i < _n_loaded_dirs && !_dirty; ++i) {
+            auto dir = layout.dir(i);
+            auto key = layout.string(dir.path_offset, dir.path_size);
+            if (is_under(key, root_key) && _visited.find(std::string{key}) == _visited.end()) {
+                _dirty = true;
+            }
+        }
+    }
+}
+
+std::vector<fs::path> pf::source_index::glob_sources(fs::path const&     relative_to,
+                                                     glob_options const& opts) {
+    pf::trace::span       span{"source_index::glob_sources", relative_to};
+    std::vector<fs::path> sources;
+    std::mutex            sources_mutex;
+    _glob(relative_to, opts, [&](fs::path const& dir, std::vector<std::string> const& names) {
+        std::lock_guard lk{sources_mutex};
+        for (auto const& name : names) {
+            sources.push_back(dir / name);
+        }
+    });
+    pf::sort_paths(sources, relative_to);
+    return sources;
+}
+
+void pf::source_index::glob_sources(fs::path const&     relative_to,
+                                    glob_options const& opts,
+                                    path_trie&          out) {
+    for_each_source(relative_to, opts, [&](source_entry const& source) {
+        out.insert_in(source.dir, source.name);
+    });
+}
+
+void pf::source_index::for_each_source(fs::path const&        relative_to,
+                                       glob_options const&    opts,
+                                       source_callback const& fn) {
+    pf::trace::span        span{"source_index::for_each_source", relative_to};
+    detail::source_emitter emit{relative_to, fn};
+    _glob(relative_to, opts, std::ref(emit));
+}
+
+void pf::source_index::save(fs::path const& index_file, std::error_code& ec) const {
+    // Keep the loaded directories that are not under any root we have walked
+    std::map<std::string, dir_listing> all = _visited;
+    if (_n_loaded_dirs) {
+        index_layout const layout{_loaded.view()};
+        for (auto i = 0u; i < _n_loaded_dirs; ++i) {
+            auto dir = layout.dir(i);
+            auto key = std::string{layout.string(dir.path_offset, dir.path_size)};
+            auto scanned = std::any_of(_scanned_roots.begin(),
+                                       _scanned_roots.end(),
+                                       [&](auto const& root) { return is_under(key, root); });
+            if (scanned) {
+                continue;
+            }
+            dir_listing listing;
+            listing.stamp   = dir_stamp{dir.dev, dir.ino, dir.mtime_ns, dir.ctime_ns};
+            listing.flags   = dir.flags & (is_racy | is_top_level);
+            listing.entries = ::read_entries(layout, dir);
+            all.emplace(std::move(key), std::move(listing));
+        }
+    }
+
+    std::string   dirs;
+    std::string   entries;
+    std::string   strings;
+    std::uint32_t n_entries = 0;
+    for (auto const& [key, listing] : all) {
+        dir_record dir{};
+        dir.dev         = listing.stamp.dev;
+        dir.ino         = listing.stamp.ino;
+        dir.mtime_ns    = listing.stamp.mtime_ns;
+        dir.ctime_ns    = listing.stamp.ctime_ns;
+        dir.path_offset = static_cast<std::uint32_t>(strings.size());
+        dir.path_size   = static_cast<std::uint32_t>(key.size());
+        dir.first_entry = n_entries;
+        dir.entry_count = static_cast<std::uint32_t>(listing.entries.subdirs.size()
+                                                     + listing.entries.files.size());
+        dir.flags       = listing.flags;
+        if (listing.entries.has_ignore_file) {
+            dir.flags |= has_ignore_file;
+        }
+        if (listing.entries.is_build_dir) {
+            dir.flags |= is_build_dir;
+        }
+        strings += key;
+        append(dirs, dir);
+        auto const add_entries = [&](std::vector<std::string> const& names, std::uint32_t flags) {
+            for (auto const& name : names) {
+                entry_record rec{};
+                rec.name_offset = static_cast<std::uint32_t>(strings.size());
+                rec.name_size   = static_cast<std::uint32_t>(name.size());
+                rec.flags       = flags;
+                strings += name;
+                append(entries, rec);
+                ++n_entries;
+            }
+        };
+        add_entries(listing.entries.subdirs, is_subdir);
+        add_entries(listing.entries.files, is_source);
+    }
+
+    file_header header{};
+    std::memcpy(header.magic, IndexMagic, sizeof IndexMagic);
+    header.version      = format_version;
+    header.byte_order   = ByteOrderMark;
+    header.dir_count    = all.size();
+    header.entry_count  = n_entries;
+    header.strings_size = strings.size();
+    header.patterns     = _patterns;
+
+    std::string content;
+    content.reserve(sizeof header + dirs.size() + entries.size() + strings.size());
+    append(content, header);
+    content += dirs;
+    content += entries;
+    content += strings;
+
+    // Replaced atomically, so a concurrent reader never sees a partial index
+    pf::write_file(index_file, content, pf::write_mode::atomic_if_changed, ec);
+}
+
+void pf::source_index::save(fs::path const& index_file) const {
+    std::error_code ec;
+    save(index_file, ec);
+    if (ec) {
+        throw std::system_error{ec, "Failed to write source index: " + index_file.string()};
+    }
+}
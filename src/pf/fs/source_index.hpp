@@ -0,0 +1,133 @@
+#ifndef PF_FS_SOURCE_INDEX_HPP_INCLUDED
+#define PF_FS_SOURCE_INDEX_HPP_INCLUDED
+
+#include <pf/fs/core.hpp>
+#include <pf/fs/glob.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pf {
+
+/**
+ * A persistent cache of directory listings used to speed up repeated source globbing.
+ *
+ * For every directory visited, the index records the directory's identity and modification
+ * stamps along with the names of the source files and subdirectories it contained. A later walk
+ * only lists directories whose stamps have changed, and reuses the recorded entries for everything
+ * else. Adding, removing, or renaming a directory entry always updates the directory's mtime, so
+ * this is sufficient to detect any change in the set of source files.
+ * Editing a .gitignore does not, so the index only records which directories have one, and their
+ * rules are read again on each walk.
+ *
+ * The on-disk format is versioned and uses fixed-size records with the directory records sorted
+ * by path, so that lookups can be done directly against the file contents. Files with the wrong
+ * version (or that are otherwise unreadable) are treated as an empty index. So is an index that
+ * was written using different source patterns (see `glob_options::patterns`).
+ */
+class source_index {
+public:
+    /// Bump this whenever the on-disk layout changes
+    static constexpr std::uint32_t format_version = 3;
+
+    /// The default location of the index file for a project
+    static fs::path default_path(fs::path const& project_root) {
+        return project_root / ".pf" / "index";
+    }
+
+    /**
+     * Create an empty index. Directory paths are recorded relative to `root`.
+     */
+    explicit source_index(fs::path root);
+
+    /**
+     * Load an index from `index_file`. If the file does not exist or is not a valid index, the
+     * returned index is empty.
+     */
+    static source_index load(fs::path root, fs::path const& index_file);
+
+    /**
+     * Write the index to `index_file`, replacing any existing file.
+     */
+    void save(fs::path const& index_file, std::error_code& ec) const;
+    void save(fs::path const& index_file) const;
+
+    /**
+     * Equivalent to `pf::glob_sources(relative_to, opts)`, but using (and updating) the index.
+     */
+    std::vector<fs::path> glob_sources(fs::path const& relative_to, glob_options const& opts);
+    std::vector<fs::path> glob_sources(fs::path const& relative_to) {
+        return glob_sources(relative_to, glob_options{});
+    }
+    /// As above, but add the sources to `out`, as with the same overload of `pf::glob_sources`
+    void glob_sources(fs::path const& relative_to, glob_options const& opts, path_trie& out);
+
+    /// Equivalent to `pf::for_each_source(relative_to, opts, fn)`, but using the index
+    void for_each_source(fs::path const&        relative_to,
+                         glob_options const&    opts,
+                         source_callback const& fn);
+
+    /// `true` if any directory needed to be re-listed since the index was loaded
+    bool dirty() const noexcept { return _dirty; }
+
+    /// The number of directories listed (rather than served from the index) so far
+    std::size_t directories_listed() const noexcept { return _n_listed; }
+
+    struct dir_stamp {
+        std::uint64_t dev      = 0;
+        std::uint64_t ino      = 0;
+        std::int64_t  mtime_ns = 0;
+        std::int64_t  ctime_ns = 0;
+
+        friend bool operator==(dir_stamp const& lhs, dir_stamp const& rhs) noexcept {
+            return lhs.dev == rhs.dev && lhs.ino == rhs.ino && lhs.mtime_ns == rhs.mtime_ns
+                && lhs.ctime_ns == rhs.ctime_ns;
+        }
+    };
+
+private:
+    struct dir_listing {
+        dir_stamp stamp;
+        // The flags of its record in the index file, apart from those the entries carry
+        std::uint32_t       flags = 0;
+        detail::dir_entries entries;
+    };
+
+    fs::path    _root;
+    mapped_file _loaded;  // Raw contents of the loaded index file
+    std::size_t _n_loaded_dirs = 0;
+    // The fingerprint of the source patterns the listings were made with
+    std::uint64_t _patterns = source_patterns::defaults().fingerprint();
+
+    std::set<std::string> _scanned_roots;
+
+    // Guards the members below, which are updated by parallel walks
+    std::unique_ptr<std::mutex>        _visited_mutex = std::make_unique<std::mutex>();
+    std::map<std::string, dir_listing> _visited;
+    bool                               _dirty    = false;
+    std::size_t                        _n_listed = 0;
+
+    // Called with each directory that holds sources, and the names of those sources
+    using emit_fn = std::function<void(fs::path const&, std::vector<std::string> const&)>;
+
+    void _glob(fs::path const& relative_to, glob_options const& opts, emit_fn const& emit);
+
+    std::string        _key_for(fs::path const& dir) const;
+    bool               _find_loaded(std::string_view key, dir_listing& want) const;
+    dir_listing const& _list(fs::path const&        dir,
+                             bool                   top_level,
+                             source_patterns const& patterns,
+                             source_patterns::state dir_state,
+                             glob_options const&    opts);
+};
+
+}  // namespace pf
+
+#endif  // PF_FS_SOURCE_INDEX_HPP_INCLUDED
@@ -0,0 +1,366 @@
+#include "./source_patterns.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <map>
+#include <stdexcept>
+
+namespace {
+
+using byte_set = std::bitset<256>;
+
+byte_set const AnyByte = byte_set{}.set();
+byte_set const AnyButSlash = byte_set{}.set().reset('/');
+
+// The most DFA states we are willing to build before giving up on a set of globs
+constexpr std::size_t MaxStates = 1 << 16;
+
+/**
+ * A state of the NFA. Each state consumes at most one set of bytes, which is enough for globs:
+ * Loops are made by a state that transitions to itself.
+ */
+struct nfa_state {
+    byte_set         on;
+    int              to = -1;
+    std::vector<int> eps;
+    // The index of the glob that matches on reaching this state, or -1
+    int accepts = -1;
+};
+
+enum class item_kind {
+    // One byte of the set
+    one_of,
+    // `*`: Any bytes within a single path component
+    star,
+    // `**/`: Any number of whole directories
+    any_dirs,
+    // `**` at the end: Anything at all
+    anything,
+};
+
+struct glob_item {
+    item_kind kind;
+    byte_set  set;
+};
+
+[[noreturn]] void bad_glob(std::string const& glob, std::string const& why) {
+    throw std::runtime_error("Invalid source pattern `" + glob + "`: " + why);
+}
+
+// Parse a character class, with `pos` just past its `[`. Leaves `pos` just past the `]`.
+byte_set parse_class(std::string const& glob, std::string_view body, std::size_t& pos) {
+    byte_set set;
+    bool     negate = pos < body.size() && (body[pos] == '!' || body[pos] == '^');
+    if (negate) {
+        ++pos;
+    }
+    bool first = true;
+    while (true) {
+        if (pos == body.size()) {
+            bad_glob(glob, "No closing `]`");
+        }
+        auto lo = static_cast<unsigned char>(body[pos++]);
+        if (lo == ']' && !first) {
+            break;
+        }
+        first = false;
+        if (lo == '\\' && pos < body.size()) {
+            lo = static_cast<unsigned char>(body[pos++]);
+        }
+        auto hi = lo;
+        if (pos + 1 < body.size() && body[pos] == '-' && body[pos + 1] != ']') {
+            hi = static_cast<unsigned char>(body[pos + 1]);
+            pos += 2;
+            if (hi < lo) {
+                bad_glob(glob, "Invalid range in `[...]`");
+            }
+        }
+        for (unsigned c = lo; c <= hi; ++c) {
+            set.set(c);
+        }
+    }
+    if (negate) {
+        set.flip();
+    }
+    // Like `*` and `?`, a class never matches the separator
+    return set.reset('/');
+}
+
+/**
+ * Break a glob into the items to match in sequence. Sets `include` to whether paths matching the
+ * glob are selected.
+ */
+std::vector<glob_item> parse_glob(std::string const& glob, bool& include) {
+    std::string_view body = glob;
+    include               = true;
+    if (!body.empty() && body[0] == '!') {
+        include = false;
+        body.remove_prefix(1);
+    }
+
+    // A trailing slash names a directory, which stands for everything below it
+    std::string rewritten;
+    bool        below = !body.empty() && body.back() == '/';
+    if (below) {
+        body.remove_suffix(1);
+    }
+    if (body.empty()) {
+        bad_glob(glob, "The pattern is empty");
+    }
+    // Without a slash, the glob matches at any depth. With one, it is relative to the root.
+    if (body.find('/') == body.npos) {
+        rewritten = "**/";
+    } else if (body[0] == '/') {
+        body.remove_prefix(1);
+    }
+    rewritten.append(body);
+    if (below) {
+        rewritten += "/**";
+    }
+    body = rewritten;
+
+    std::vector<glob_item> items;
+    std::size_t            pos = 0;
+    while (pos < body.size()) {
+        auto const c = body[pos];
+        // `**` is only special as a whole path component
+        auto const globstar = body.compare(pos, 2, "**") == 0
+            && (pos == 0 || body[pos - 1] == '/')
+            && (pos + 2 == body.size() || body[pos + 2] == '/');
+        if (globstar && pos + 2 == body.size()) {
+            items.push_back({item_kind::anything, {}});
+            pos += 2;
+        } else if (globstar) {
+            items.push_back({item_kind::any_dirs, {}});
+            pos += 3;
+        } else if (c == '*') {
+            if (items.empty() || items.back().kind != item_kind::star) {
+                items.push_back({item_kind::star, {}});
+            }
+            ++pos;
+        } else if (c == '?') {
+            items.push_back({item_kind::one_of, AnyButSlash});
+            ++pos;
+        } else if (c == '[') {
+            ++pos;
+            items.push_back({item_kind::one_of, ::parse_class(glob, body, pos)});
+        } else {
+            if (c == '\\') {
+                if (++pos == body.size()) {
+                    bad_glob(glob, "The pattern ends with a `\\`");
+                }
+            }
+            byte_set set;
+            set.set(static_cast<unsigned char>(body[pos++]));
+            items.push_back({item_kind::one_of, set});
+        }
+    }
+    return items;
+}
+
+class nfa_builder {
+public:
+    std::vector<nfa_state> states;
+
+    int add() {
+        states.emplace_back();
+        return static_cast<int>(states.size() - 1);
+    }
+
+    // Append states matching `items` after `cur`, and mark the last one as accepting for `index`
+    void add_glob(std::vector<glob_item> const& items, int index, int cur) {
+        for (auto const& item : items) {
+            auto const next = add();
+            switch (item.kind) {
+            case item_kind::one_of:
+                states[cur].on = item.set;
+                states[cur].to = next;
+                break;
+            case item_kind::star:
+                states[cur].on = AnyButSlash;
+                states[cur].to = cur;
+                states[cur].eps.push_back(next);
+                break;
+            case item_kind::anything:
+                states[cur].on = AnyByte;
+                states[cur].to = cur;
+                states[cur].eps.push_back(next);
+                break;
+            case item_kind::any_dirs: {
+                // Nothing, or anything that ends with a slash
+                auto const loop  = add();
+                auto const slash = add();
+                states[cur].eps.push_back(next);
+                states[cur].eps.push_back(loop);
+                states[loop].on = AnyByte;
+                states[loop].to = loop;
+                states[loop].eps.push_back(slash);
+                states[slash].on.set('/');
+                states[slash].to = next;
+                break;
+            }
+            }
+            cur = next;
+        }
+        states[cur].accepts = index;
+    }
+
+    std::vector<int> closure(std::vector<int> set) const {
+        // Sets that differ only in duplicates must come out the same, or the DFA would never end
+        std::vector<bool> seen(states.size());
+        set.erase(std::remove_if(set.begin(),
+                                 set.end(),
+                                 [&](int s) {
+                                     bool const dup = seen[s];
+                                     seen[s]        = true;
+                                     return dup;
+                                 }),
+                  set.end());
+        for (auto i = 0u; i < set.size(); ++i) {
+            for (auto next : states[set[i]].eps) {
+                if (!seen[next]) {
+                    seen[next] = true;
+                    set.push_back(next);
+                }
+            }
+        }
+        std::sort(set.begin(), set.end());
+        return set;
+    }
+};
+
+std::uint64_t fnv1a(std::vector<std::string> const& globs) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (auto const& glob : globs) {
+        for (unsigned char c : glob) {
+            hash = (hash ^ c) * 1099511628211ull;
+        }
+        // Separate the globs, so that `ab` differs from `a`, `b`
+        hash = (hash ^ 0xff) * 1099511628211ull;
+    }
+    return hash;
+}
+
+}  // namespace
+
+pf::source_patterns::source_patterns(std::vector<std::string> globs)
+    : _globs(std::move(globs))
+    , _fingerprint(::fnv1a(_globs)) {
+    ::nfa_builder     nfa;
+    std::vector<bool> includes;
+    auto const        nfa_start = nfa.add();
+    for (auto const& glob : _globs) {
+        bool       include = true;
+        auto const items   = ::parse_glob(glob, include);
+        auto const start   = nfa.add();
+        nfa.states[nfa_start].eps.push_back(start);
+        nfa.add_glob(items, static_cast<int>(includes.size()), start);
+        includes.push_back(include);
+    }
+
+    // Split the bytes into classes, refining them by each set of bytes that a state consumes
+    for (auto const& st : nfa.states) {
+        if (st.to < 0) {
+            continue;
+        }
+        std::map<std::pair<std::uint16_t, bool>, std::uint16_t> refined;
+        for (auto c = 0u; c < 256; ++c) {
+            auto const key = std::pair{_classes[c], bool{st.on[c]}};
+            auto const cls = refined.emplace(key, static_cast<std::uint16_t>(refined.size()));
+            _classes[c]    = cls.first->second;
+        }
+        _n_classes = static_cast<std::uint32_t>(refined.size());
+    }
+    std::vector<unsigned> class_rep(_n_classes);
+    for (auto c = 256u; c-- > 0;) {
+        class_rep[_classes[c]] = c;
+    }
+
+    // The subset construction. Each DFA state stands for the set of NFA states it was built from.
+    std::map<std::vector<int>, state> ids;
+    std::vector<std::vector<int>>     sets;
+    auto const                        id_for = [&](std::vector<int> set) {
+        auto const found = ids.find(set);
+        if (found != ids.end()) {
+            return found->second;
+        }
+        if (sets.size() == MaxStates) {
+            throw std::runtime_error("The source patterns are too complex to compile");
+        }
+        auto const id = static_cast<state>(sets.size());
+        ids.emplace(set, id);
+        sets.push_back(std::move(set));
+        return id;
+    };
+    _start = id_for(nfa.closure({nfa_start}));
+    for (std::size_t cur = 0; cur < sets.size(); ++cur) {
+        for (auto cls = 0u; cls < _n_classes; ++cls) {
+            std::vector<int> next;
+            for (auto s : sets[cur]) {
+                auto const& st = nfa.states[s];
+                if (st.to >= 0 && st.on[class_rep[cls]]) {
+                    next.push_back(st.to);
+                }
+            }
+            // `sets` may grow here, so `sets[cur]` is only used above
+            auto const id = id_for(nfa.closure(std::move(next)));
+            _table.push_back(id);
+        }
+    }
+
+    // The last glob to match decides
+    _flags.resize(sets.size());
+    for (auto i = 0u; i < sets.size(); ++i) {
+        int last = -1;
+        for (auto s : sets[i]) {
+            last = std::max(last, nfa.states[s].accepts);
+        }
+        if (last >= 0) {
+            _flags[i] |= includes[last] ? selected_flag | matched_flag : matched_flag;
+        }
+    }
+
+    // A state is live if a selected state can be reached from it
+    std::vector<std::vector<state>> preds(sets.size());
+    for (auto i = 0u; i < _table.size(); ++i) {
+        preds[_table[i]].push_back(static_cast<state>(i / _n_classes));
+    }
+    std::vector<state> pending;
+    for (auto i = 0u; i < sets.size(); ++i) {
+        if (_flags[i] & selected_flag) {
+            _flags[i] |= live_flag;
+            pending.push_back(i);
+        }
+    }
+    while (!pending.empty()) {
+        auto const s = pending.back();
+        pending.pop_back();
+        for (auto pred : preds[s]) {
+            if (!(_flags[pred] & live_flag)) {
+                _flags[pred] |= live_flag;
+                pending.push_back(pred);
+            }
+        }
+    }
+}
+
+std::vector<std::string> const& pf::source_patterns::default_globs() {
+    static std::vector<std::string> const globs{
+        "*.c",
+        "*.cc",
+        "*.cpp",
+        "*.cxx",
+        "*.c++",
+        "*.h",
+        "*.hh",
+        "*.hpp",
+        "*.hxx",
+        "*.h++",
+    };
+    return globs;
+}
+
+pf::source_patterns const& pf::source_patterns::defaults() {
+    static source_patterns const patterns{default_globs()};
+    return patterns;
+}
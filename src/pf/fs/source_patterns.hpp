@@ -0,0 +1,94 @@
+#ifndef PF_FS_SOURCE_PATTERNS_HPP_INCLUDED
+#define PF_FS_SOURCE_PATTERNS_HPP_INCLUDED
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pf {
+
+/**
+ * A list of include and exclude globs that select source files by their path relative to a source
+ * root (such as `src/`), compiled into a single DFA.
+ *
+ * The globs follow .gitignore: `*` and `?` match within a single path component, `[...]` matches
+ * a character class, and `**` matches any number of whole directories. A leading `!` makes a
+ * glob exclude paths rather than include them. A glob without a `/` matches the filename at any
+ * depth, and a trailing `/` matches everything below a directory. The last glob that matches a
+ * path decides whether it is selected, and a path that no glob matches is not selected.
+ *
+ * Matching costs one table lookup per byte of the path, and never allocates. A walk over a tree
+ * can carry the state of each directory down to its entries, so only their names are matched.
+ */
+class source_patterns {
+public:
+    using state = std::uint32_t;
+
+    /// Compile the globs. Throws `std::runtime_error` if one of them is malformed.
+    explicit source_patterns(std::vector<std::string> globs);
+
+    /// The common C and C++ source and header extensions, as in `*.cpp` and `*.hpp`
+    static std::vector<std::string> const& default_globs();
+    /// The default globs, compiled once
+    static source_patterns const& defaults();
+
+    std::vector<std::string> const& globs() const noexcept { return _globs; }
+    /// A hash of the globs, which can tell whether results were produced by the same globs
+    std::uint64_t fingerprint() const noexcept { return _fingerprint; }
+
+    /// The state at the source root, before any byte of a path has been matched
+    state start() const noexcept { return _start; }
+
+    /// Continue matching from `s` with `bytes`
+    state advance(state s, std::string_view bytes) const noexcept {
+        for (unsigned char c : bytes) {
+            s = _table[s * _n_classes + _classes[c]];
+        }
+        return s;
+    }
+
+    /// The state for the entries of directory `name`, which is itself an entry at `s`
+    state enter_directory(state s, std::string_view name) const noexcept {
+        return advance(advance(s, name), "/");
+    }
+
+    /// Whether the path that led to `s` is selected
+    bool selected(state s) const noexcept { return _flags[s] & selected_flag; }
+
+    /**
+     * Whether any glob, including an exclude, matches the path that led to `s`. If not, it is only
+     * left out because nothing selected it.
+     */
+    bool has_match(state s) const noexcept { return _flags[s] & matched_flag; }
+
+    /**
+     * Whether any path continuing from `s` can be selected. If not, a directory whose entries are
+     * at `s` need not be walked at all.
+     */
+    bool can_select_below(state s) const noexcept { return _flags[s] & live_flag; }
+
+    /// Whether `path`, relative to the source root and using `/` as separator, is selected
+    bool matches(std::string_view path) const noexcept { return selected(advance(_start, path)); }
+
+private:
+    enum : std::uint8_t {
+        selected_flag = 1 << 0,
+        live_flag     = 1 << 1,
+        matched_flag  = 1 << 2,
+    };
+
+    std::vector<std::string> _globs;
+    std::uint64_t            _fingerprint = 0;
+    // Bytes that no glob tells apart share a class, which keeps the table small
+    std::array<std::uint16_t, 256> _classes{};
+    std::uint32_t                  _n_classes = 1;
+    std::vector<state>             _table;
+    std::vector<std::uint8_t>      _flags;
+    state                          _start = 0;
+};
+
+}  // namespace pf
+
+#endif  // PF_FS_SOURCE_PATTERNS_HPP_INCLUDED
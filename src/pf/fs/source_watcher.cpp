@@ -0,0 +1,344 @@
+#include "./source_watcher.hpp"
+
+#include <pf/fs/glob.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <string_view>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = pf::fs;
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace {
+
+// Check whether `path` is `dir` or lies within it
+bool is_within(fs::path const& path, fs::path const& dir) {
+    return std::mismatch(dir.begin(), dir.end(), path.begin(), path.end()).first == dir.end();
+}
+
+}  // namespace
+
+std::vector<fs::path> pf::source_watcher::sources(fs::path const& root) const {
+    auto it = std::find(_roots.begin(), _roots.end(), root);
+    if (it == _roots.end()) {
+        return {};
+    }
+    auto const& found = _sources[static_cast<std::size_t>(it - _roots.begin())];
+    return std::vector<fs::path>(found.begin(), found.end());
+}
+
+std::vector<fs::path> pf::source_watcher::sources(fs::path const&        root,
+                                                  source_patterns const& patterns) const {
+    auto ret = sources(root);
+    ret.erase(std::remove_if(ret.begin(),
+                             ret.end(),
+                             [&](fs::path const& file) {
+                                 return !patterns.matches(
+                                     file.lexically_relative(root).generic_string());
+                             }),
+              ret.end());
+    return ret;
+}
+
+#if !defined(__linux__)
+
+pf::source_watcher::source_watcher(std::vector<fs::path>, source_patterns) {
+    throw std::system_error{std::make_error_code(std::errc::not_supported),
+                            "Watching for file changes is only supported on Linux"};
+}
+
+pf::source_watcher::~source_watcher() = default;
+
+std::vector<fs::path> pf::source_watcher::wait_for_changes(milliseconds,
+                                                           std::optional<milliseconds>) {
+    return {};
+}
+
+std::vector<fs::path> pf::source_watcher::poll_changes() { return {}; }
+
+#else
+
+namespace {
+
+// IN_CLOSE_WRITE is only for edits to .gitignore files
+constexpr std::uint32_t WatchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+    | IN_CLOSE_WRITE | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+std::error_code last_error() { return std::error_code{errno, std::system_category()}; }
+
+}  // namespace
+
+pf::source_watcher::source_watcher(std::vector<fs::path> roots, source_patterns patterns)
+    : _roots(std::move(roots))
+    , _patterns(std::move(patterns))
+    , _sources(_roots.size()) {
+    _fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_fd < 0) {
+        throw std::system_error{last_error(), "Failed to initialize inotify"};
+    }
+    try {
+        for (auto i = 0u; i < _roots.size(); ++i) {
+            _scan(_roots[i], i, ignore_rules::for_directory(_roots[i]));
+        }
+    } catch (...) {
+        ::close(_fd);
+        throw;
+    }
+}
+
+pf::source_watcher::~source_watcher() { ::close(_fd); }
+
+/**
+ * Watch `dir` and everything below it, and record the sources found. The watch is added before
+ * the directory is listed, so a file created during the scan is either listed or reported.
+ */
+void pf::source_watcher::_scan(fs::path const& dir, std::size_t root, ignore_rules rules) {
+    auto const top_level = dir == _roots[root];
+
+    int wd = ::inotify_add_watch(_fd, dir.c_str(), WatchMask);
+    if (wd < 0) {
+        if (errno == ENOENT || errno == ENOTDIR) {
+            // Already gone again. Its removal will be (or has been) reported.
+            return;
+        }
+        if (errno == ENOSPC) {
+            throw std::system_error{last_error(),
+                                    "Too many directories to watch (raise "
+                                    "fs.inotify.max_user_watches)"};
+        }
+        throw std::system_error{last_error(), "Failed to watch " + dir.string()};
+    }
+    // Re-adding a watch for the same directory yields the same descriptor
+    auto existing = _dirs.find(wd);
+    if (existing != _dirs.end()) {
+        _wds.erase(existing->second.path);
+    }
+    _dirs[wd] = watched_dir{dir, root, rules, rules};
+    _wds[dir] = wd;
+    // References to the elements of an unordered_map survive the insertions of the scans below
+    auto& watched = _dirs[wd];
+
+    // Nothing is decided until the whole directory is listed, since its .gitignore applies to all
+    // of its entries, and a CMakeCache.txt rules them all out
+    std::vector<std::pair<fs::path, bool>> entries;
+    bool                                   has_ignore_file = false;
+    std::error_code                        ec;
+    for (fs::directory_iterator it{dir, ec}, stop; !ec && it != stop; it.increment(ec)) {
+        auto const& entry = *it;
+        // As with glob_sources: Files directly within the root are not sources, top-level
+        // directories are followed even if they are symlinks, and other symlinks are not.
+        std::error_code entry_ec;
+        auto const      is_dir = top_level
+            ? entry.is_directory(entry_ec)
+            : !entry.is_symlink(entry_ec) && entry.is_directory(entry_ec);
+        auto const name = entry.path().filename().string();
+        if (!top_level && !is_dir) {
+            if (pf::marks_build_dir(name)) {
+                watched.build_dir = true;
+                return;
+            }
+            has_ignore_file = has_ignore_file || name == ignore_rules::file_name;
+        }
+        entries.emplace_back(entry.path(), is_dir);
+    }
+
+    if (has_ignore_file) {
+        rules.add_file(dir / ignore_rules::file_name);
+        watched.rules = rules;
+    }
+    for (auto const& [path, is_dir] : entries) {
+        auto const name = path.filename().string();
+        if (rules.ignored(name, is_dir)) {
+            continue;
+        }
+        if (is_dir) {
+            _scan(path, root, rules.enter(name));
+        } else if (!top_level && _is_source(path, root)) {
+            _sources[root].insert(path);
+        }
+    }
+}
+
+// Start `dir` over, after a change to which of the entries within it are ignored
+void pf::source_watcher::_rescan(fs::path dir, std::size_t root, ignore_rules inherited) {
+    auto const was_changed = _changed.count(root) != 0;
+    auto const before      = _sources[root];
+    _forget(dir, root);
+    if (dir == _roots[root]) {
+        inherited = ignore_rules::for_directory(dir);
+    }
+    _scan(dir, root, std::move(inherited));
+    if (!was_changed && _sources[root] == before) {
+        _changed.erase(root);
+    } else {
+        _changed.insert(root);
+    }
+}
+
+bool pf::source_watcher::_is_source(fs::path const& path, std::size_t root) const {
+    return _patterns.matches(path.lexically_relative(_roots[root]).generic_string());
+}
+
+// Stop watching `dir` and everything below it, and drop the sources within it
+void pf::source_watcher::_forget(fs::path const& dir, std::size_t root) {
+    auto wd_it = _wds.lower_bound(dir);
+    while (wd_it != _wds.end() && ::is_within(wd_it->first, dir)) {
+        ::inotify_rm_watch(_fd, wd_it->second);
+        _dirs.erase(wd_it->second);
+        wd_it = _wds.erase(wd_it);
+    }
+
+    // Everything within a directory sorts directly after it
+    auto& sources = _sources[root];
+    auto  src_it  = sources.upper_bound(dir);
+    while (src_it != sources.end() && ::is_within(*src_it, dir)) {
+        src_it = sources.erase(src_it);
+        _changed.insert(root);
+    }
+}
+
+void pf::source_watcher::_rescan_all() {
+    for (auto const& [wd, dir] : _dirs) {
+        ::inotify_rm_watch(_fd, wd);
+    }
+    _dirs.clear();
+    _wds.clear();
+    for (auto i = 0u; i < _roots.size(); ++i) {
+        auto old = std::move(_sources[i]);
+        _sources[i].clear();
+        _scan(_roots[i], i, ignore_rules::for_directory(_roots[i]));
+        if (old != _sources[i]) {
+            _changed.insert(i);
+        }
+    }
+}
+
+// Wait up to `timeout_ms` for events and apply them. Returns `false` if none arrived.
+bool pf::source_watcher::_read_events(int timeout_ms) {
+    ::pollfd pfd{_fd, POLLIN, 0};
+    auto     n_ready = ::poll(&pfd, 1, timeout_ms);
+    if (n_ready < 0 && errno != EINTR) {
+        throw std::system_error{last_error(), "Failed to wait for file changes"};
+    }
+    if (n_ready <= 0) {
+        return false;
+    }
+
+    alignas(::inotify_event) char buf[64 * 1024];
+    while (true) {
+        auto n_read = ::read(_fd, buf, sizeof buf);
+        if (n_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                return true;
+            }
+            throw std::system_error{last_error(), "Failed to read file changes"};
+        }
+
+        for (auto ptr = buf; ptr < buf + n_read;) {
+            auto const& event = *reinterpret_cast<const ::inotify_event*>(ptr);
+            ptr += sizeof(::inotify_event) + event.len;
+
+            if (event.mask & IN_Q_OVERFLOW) {
+                // Events were lost, so we can no longer trust what we have
+                _rescan_all();
+                continue;
+            }
+            auto dir_it = _dirs.find(event.wd);
+            if (dir_it == _dirs.end()) {
+                // A directory we stopped watching, whose remaining events are still queued
+                continue;
+            }
+            if (event.mask & IN_IGNORED) {
+                // The directory was deleted or unmounted
+                _wds.erase(dir_it->second.path);
+                _dirs.erase(dir_it);
+                continue;
+            }
+
+            auto&            watched   = dir_it->second;
+            auto const       root      = watched.root;
+            auto const       top_level = watched.path == _roots[root];
+            auto const       path      = watched.path / event.name;
+            auto const       is_dir    = (event.mask & IN_ISDIR) != 0;
+            std::string_view name      = event.name;
+            if (!is_dir
+                && (name == ignore_rules::file_name || (!top_level && pf::marks_build_dir(name)))) {
+                _rescan(watched.path, root, watched.inherited);
+                continue;
+            }
+            if (watched.build_dir) {
+                continue;
+            }
+            if (event.mask & (IN_CREATE | IN_MOVED_TO)) {
+                if (!top_level && !is_dir && _is_source(path, root)
+                    && !watched.rules.ignored(name, false) && _sources[root].insert(path).second) {
+                    _changed.insert(root);
+                }
+                if (is_dir && !watched.rules.ignored(name, true)) {
+                    auto const before = _sources[root].size();
+                    _scan(path, root, watched.rules.enter(name));
+                    if (_sources[root].size() != before) {
+                        _changed.insert(root);
+                    }
+                }
+            } else if (event.mask & (IN_DELETE | IN_MOVED_FROM)) {
+                if (_sources[root].erase(path) != 0) {
+                    _changed.insert(root);
+                }
+                if (is_dir) {
+                    _forget(path, root);
+                }
+            }
+        }
+    }
+}
+
+std::vector<fs::path> pf::source_watcher::wait_for_changes(milliseconds                settle,
+                                                           std::optional<milliseconds> timeout) {
+    auto const deadline = steady_clock::now() + timeout.value_or(milliseconds{0});
+    while (_changed.empty()) {
+        int timeout_ms = -1;
+        if (timeout) {
+            auto const remaining = std::chrono::duration_cast<milliseconds>(deadline
+                                                                            - steady_clock::now());
+            if (remaining.count() <= 0) {
+                return {};
+            }
+            timeout_ms = static_cast<int>(remaining.count());
+        }
+        _read_events(timeout_ms);
+    }
+
+    // Keep collecting until things settle down
+    while (_read_events(static_cast<int>(settle.count()))) {
+    }
+    return _take_changed();
+}
+
+std::vector<fs::path> pf::source_watcher::poll_changes() {
+    while (_read_events(0)) {
+    }
+    return _take_changed();
+}
+
+std::vector<fs::path> pf::source_watcher::_take_changed() {
+    std::vector<fs::path> changed;
+    for (auto root : _changed) {
+        changed.push_back(_roots[root]);
+    }
+    _changed.clear();
+    return changed;
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef PF_FS_SOURCE_WATCHER_HPP_INCLUDED
+#define PF_FS_SOURCE_WATCHER_HPP_INCLUDED
+
+#include <pf/fs/core.hpp>
+#include <pf/fs/ignore_rules.hpp>
+#include <pf/fs/source_patterns.hpp>
+
+#include <chrono>
+#include <map>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace pf {
+
+/**
+ * Keeps the sources found by `pf::glob_sources` up to date for a set of root directories, using
+ * inotify. The trees are walked once on construction. Afterwards, only directories that are
+ * created or moved into a tree are listed, and watches are added and removed as directories come
+ * and go. A directory whose .gitignore or CMakeCache.txt changes is walked again.
+ *
+ * Only supported on Linux. Elsewhere, the constructor throws `std::system_error` with
+ * `std::errc::not_supported`.
+ */
+class source_watcher {
+public:
+    explicit source_watcher(std::vector<fs::path> roots,
+                            source_patterns       patterns = source_patterns::defaults());
+    ~source_watcher();
+
+    source_watcher(const source_watcher&) = delete;
+    source_watcher& operator=(const source_watcher&) = delete;
+
+    /// The watched roots, in the order they were given
+    std::vector<fs::path> const& roots() const noexcept { return _roots; }
+
+    /// The current sources within `root`, as `pf::glob_sources` would find with the same patterns
+    std::vector<fs::path> sources(fs::path const& root) const;
+
+    /**
+     * Those of the current sources within `root` that `patterns` also select. A watcher that must
+     * see more files than some of its roots list can watch with wider patterns, and narrow them.
+     */
+    std::vector<fs::path> sources(fs::path const& root, source_patterns const& patterns) const;
+
+    /**
+     * Wait for the sources to change, and return the roots whose sources changed.
+     *
+     * Once an event arrives, events continue to be read until none arrive for `settle`, so that
+     * a burst of changes (such as a `git checkout`) is reported only once. Returns an empty list
+     * if nothing changed within `timeout`, or waits indefinitely if no timeout is given.
+     */
+    std::vector<fs::path> wait_for_changes(std::chrono::milliseconds                settle,
+                                           std::optional<std::chrono::milliseconds> timeout
+                                           = std::nullopt);
+
+    /**
+     * Process the events that have already arrived, without waiting, and return the roots whose
+     * sources changed since the last call to `poll_changes` or `wait_for_changes`.
+     */
+    std::vector<fs::path> poll_changes();
+
+    /// The number of directories currently being watched
+    std::size_t watch_count() const noexcept { return _dirs.size(); }
+
+private:
+    struct watched_dir {
+        fs::path    path;
+        std::size_t root;
+        // The rules for the entries of the directory, and those from above it, without the rules
+        // of its own .gitignore
+        ignore_rules rules;
+        ignore_rules inherited;
+        // A CMake build directory, which is only watched to notice if it stops being one
+        bool build_dir = false;
+    };
+
+    int                                  _fd = -1;
+    std::vector<fs::path>                _roots;
+    source_patterns                      _patterns;
+    std::vector<std::set<fs::path>>      _sources;
+    std::unordered_map<int, watched_dir> _dirs;
+    std::map<fs::path, int>              _wds;
+    std::set<std::size_t>                _changed;
+
+    bool _is_source(fs::path const& path, std::size_t root) const;
+    void _scan(fs::path const& dir, std::size_t root, ignore_rules rules);
+    void _forget(fs::path const& dir, std::size_t root);
+    void _rescan(fs::path dir, std::size_t root, ignore_rules inherited);
+    void _rescan_all();
+    bool _read_events(int timeout_ms);
+
+    std::vector<fs::path> _take_changed();
+};
+
+}  // namespace pf
+
+#endif  // PF_FS_SOURCE_WATCHER_HPP_INCLUDED
@@ -0,0 +1,91 @@
+#include "./stat_cache.hpp"
+
+#include <mutex>
+
+namespace fs = pf::fs;
+
+template <typename T, typename Query>
+T pf::stat_cache::_get(const fs::path&      path,
+                       std::optional<T> entry::*member,
+                       Query&&              query,
+                       std::error_code&     ec) {
+    ec = {};
+    ++_lookups;
+    {
+        std::shared_lock lk{_mutex};
+        auto             found = _entries.find(path.native());
+        if (found != _entries.end() && (found->second.*member)) {
+            return *(found->second.*member);
+        }
+    }
+
+    ++_syscalls;
+    T value = query(path, ec);
+    if (ec) {
+        // Errors may be transient, so they are not remembered
+        return value;
+    }
+    std::unique_lock lk{_mutex};
+    _entries[path.native()].*member = value;
+    return value;
+}
+
+fs::file_status pf::stat_cache::status(const fs::path& path, std::error_code& ec) {
+    return _get(path,
+                &entry::status,
+                [](const fs::path& p, std::error_code& ec) {
+                    auto st = fs::status(p, ec);
+                    if (st.type() == fs::file_type::not_found) {
+                        ec = {};
+                    }
+                    return st;
+                },
+                ec);
+}
+
+fs::file_status pf::stat_cache::symlink_status(const fs::path& path, std::error_code& ec) {
+    return _get(path,
+                &entry::symlink_status,
+                [](const fs::path& p, std::error_code& ec) {
+                    auto st = fs::symlink_status(p, ec);
+                    if (st.type() == fs::file_type::not_found) {
+                        ec = {};
+                    }
+                    return st;
+                },
+                ec);
+}
+
+fs::file_time_type pf::stat_cache::last_write_time(const fs::path& path, std::error_code& ec) {
+    return _get(path,
+                &entry::mtime,
+                [](const fs::path& p, std::error_code& ec) { return fs::last_write_time(p, ec); },
+                ec);
+}
+
+bool pf::stat_cache::exists(const fs::path& path) {
+    std::error_code ec;
+    return fs::exists(status(path, ec)) && !ec;
+}
+
+bool pf::stat_cache::is_directory(const fs::path& path) {
+    std::error_code ec;
+    return fs::is_directory(status(path, ec)) && !ec;
+}
+
+bool pf::stat_cache::is_regular_file(const fs::path& path) {
+    std::error_code ec;
+    return fs::is_regular_file(status(path, ec)) && !ec;
+}
+
+void pf::stat_cache::remember(const fs::path& path, fs::file_type type) {
+    std::unique_lock lk{_mutex};
+    auto&            ent = _entries[path.native()];
+    ent.status           = fs::file_status{type};
+    ent.symlink_status   = fs::file_status{type};
+}
+
+void pf::stat_cache::forget(const fs::path& path) {
+    std::unique_lock lk{_mutex};
+    _entries.erase(path.native());
+}
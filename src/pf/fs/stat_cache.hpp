@@ -0,0 +1,75 @@
+#ifndef PF_FS_STAT_CACHE_HPP_INCLUDED
+#define PF_FS_STAT_CACHE_HPP_INCLUDED
+
+#include <pf/fs/core.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace pf {
+
+/**
+ * Memoizes the status and modification time of paths, so that each is only queried from the
+ * filesystem once. Intended to live for the duration of a single command, during which the
+ * relevant parts of the filesystem are assumed not to change. Use `forget` after modifying a path.
+ *
+ * Safe to use from multiple threads.
+ */
+class stat_cache {
+public:
+    stat_cache() = default;
+
+    stat_cache(const stat_cache&) = delete;
+    stat_cache& operator=(const stat_cache&) = delete;
+
+    /// As `fs::status`. A path that does not exist is not an error, and yields `not_found`.
+    fs::file_status status(const fs::path& path, std::error_code& ec);
+    /// As `fs::symlink_status`
+    fs::file_status symlink_status(const fs::path& path, std::error_code& ec);
+    /// As `fs::last_write_time`
+    fs::file_time_type last_write_time(const fs::path& path, std::error_code& ec);
+
+    // Convenience queries. Paths that cannot be queried count as not existing.
+    bool exists(const fs::path& path);
+    bool is_directory(const fs::path& path);
+    bool is_regular_file(const fs::path& path);
+
+    /**
+     * Record the type of a path learned by other means, such as from a directory listing. `type`
+     * must not be a symlink, and applies whether or not symlinks are followed.
+     */
+    void remember(const fs::path& path, fs::file_type type);
+
+    /// Drop everything known about `path`, such as after modifying it
+    void forget(const fs::path& path);
+
+    /// The number of queries answered
+    std::size_t lookups() const noexcept { return _lookups; }
+    /// The number of queries that had to ask the filesystem
+    std::size_t syscalls() const noexcept { return _syscalls; }
+    /// The number of queries answered without asking the filesystem
+    std::size_t syscalls_avoided() const noexcept { return _lookups - _syscalls; }
+
+private:
+    struct entry {
+        std::optional<fs::file_status>    status;
+        std::optional<fs::file_status>    symlink_status;
+        std::optional<fs::file_time_type> mtime;
+    };
+
+    mutable std::shared_mutex              _mutex;
+    std::unordered_map<std::string, entry> _entries;
+    std::atomic<std::size_t>               _lookups{0};
+    std::atomic<std::size_t>               _syscalls{0};
+
+    template <typename T, typename Query>
+    T _get(const fs::path& path, std::optional<T> entry::*member, Query&& query, std::error_code&);
+};
+
+}  // namespace pf
+
+#endif  // PF_FS_STAT_CACHE_HPP_INCLUDED
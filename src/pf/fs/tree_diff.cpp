@@ -0,0 +1,282 @@
+#include "./tree_diff.hpp"
+
+#include <pf/util/task_pool.hpp>
+#include <pf/util/trace.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <set>
+#include <utility>
+
+namespace fs = pf::fs;
+
+namespace {
+
+struct tree_entry {
+    /// The generic path relative to the root of the tree
+    std::string    path;
+    fs::file_type  type = fs::file_type::none;
+    std::uintmax_t size = 0;
+    /// For an expected file held in memory, its content
+    std::string const* content = nullptr;
+};
+
+using tree_listing = std::vector<tree_entry>;
+
+/**
+ * Runs tasks on a pool, or straight away on the calling thread if there is just a single job. One
+ * project in a batch is compared on a single thread, so it should not have to start another.
+ */
+class runner {
+    std::unique_ptr<pf::task_pool> _pool;
+
+public:
+    explicit runner(unsigned jobs) {
+        if (jobs != 1) {
+            _pool = std::make_unique<pf::task_pool>(jobs);
+        }
+    }
+
+    std::size_t size() const noexcept { return _pool ? _pool->size() : 1; }
+    std::size_t this_worker_index() const noexcept {
+        return _pool ? _pool->this_worker_index() : 0;
+    }
+
+    void submit(pf::task_pool::task t) {
+        if (_pool) {
+            _pool->submit(std::move(t));
+        } else {
+            t();
+        }
+    }
+
+    void wait() {
+        if (_pool) {
+            _pool->wait();
+        }
+    }
+};
+
+bool is_ignored(pf::tree_diff_options const& opts, fs::path path) {
+    if (!opts.ignore) {
+        return false;
+    }
+    for (; !path.empty(); path = path.parent_path()) {
+        if (opts.ignore(path)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Lists a tree with one task per directory, as in glob_sources(). Each worker appends to its own
+ * buffer. Ignored directories are not entered at all.
+ */
+class tree_lister {
+    runner&                      _run;
+    pf::tree_diff_options const& _opts;
+    std::vector<tree_listing>    _found;
+
+    void _walk(fs::path const& dir, std::string const& prefix) {
+        auto&        found     = _found[_run.this_worker_index()];
+        std::int64_t n_entries = 0;
+        for (fs::directory_entry const& entry : fs::directory_iterator{dir}) {
+            ++n_entries;
+            tree_entry listed;
+            listed.path = prefix + entry.path().filename().string();
+            if (_opts.ignore && _opts.ignore(fs::path{listed.path})) {
+                continue;
+            }
+            std::error_code ec;
+            listed.type = entry.status(ec).type();
+            if (listed.type == fs::file_type::regular) {
+                listed.size = entry.file_size();
+            } else if (listed.type == fs::file_type::directory && !entry.is_symlink()) {
+                _run.submit([this, subdir = entry.path(), sub_prefix = listed.path + '/'] {
+                    _walk(subdir, sub_prefix);
+                });
+            }
+            found.push_back(std::move(listed));
+        }
+        pf::trace::add(pf::trace::counter::directories_visited, 1);
+        pf::trace::add(pf::trace::counter::entries_examined, n_entries);
+    }
+
+public:
+    tree_lister(runner& run, pf::tree_diff_options const& opts)
+        : _run{run}
+        , _opts{opts}
+        , _found(run.size()) {}
+
+    /// Queue the walk of `root`. The listing is complete once the runner has been waited on.
+    void start(fs::path const& root) {
+        if (fs::is_directory(root)) {
+            _run.submit([this, root] { _walk(root, ""); });
+        }
+    }
+
+    tree_listing take() {
+        tree_listing ret;
+        for (auto& found : _found) {
+            std::move(found.begin(), found.end(), std::back_inserter(ret));
+        }
+        std::sort(ret.begin(), ret.end(), [](auto const& lhs, auto const& rhs) {
+            return lhs.path < rhs.path;
+        });
+        return ret;
+    }
+};
+
+tree_listing list_expected(pf::expected_tree const& expected, pf::tree_diff_options const& opts) {
+    std::set<fs::path> dirs;
+    auto const         add_dir = [&](fs::path dir) {
+        while (!dir.empty() && dirs.insert(dir).second) {
+            dir = dir.parent_path();
+        }
+    };
+    for (auto const& dir : expected.directories) {
+        add_dir(dir);
+    }
+    for (auto const& [path, content] : expected.files) {
+        add_dir(path.parent_path());
+    }
+
+    tree_listing ret;
+    for (auto const& dir : dirs) {
+        if (!::is_ignored(opts, dir)) {
+            ret.push_back(tree_entry{dir.generic_string(), fs::file_type::directory, 0, nullptr});
+        }
+    }
+    for (auto const& [path, content] : expected.files) {
+        if (!::is_ignored(opts, path)) {
+            ret.push_back(tree_entry{path.generic_string(),
+                                     fs::file_type::regular,
+                                     content.size(),
+                                     &content});
+        }
+    }
+    std::sort(ret.begin(), ret.end(), [](auto const& lhs, auto const& rhs) {
+        return lhs.path < rhs.path;
+    });
+    return ret;
+}
+
+/**
+ * Compare two sorted listings. Entries that cannot be told apart by their type and size are
+ * handed to `same_content` (in parallel, if `run` has a pool) as (actual, expected) pairs.
+ */
+template <typename SameContent>
+pf::tree_diff compare_listings(tree_listing const& actual,
+                               tree_listing const& expected,
+                               runner&             run,
+                               SameContent&&       same_content) {
+    pf::tree_diff                                                diff;
+    std::vector<std::pair<tree_entry const*, tree_entry const*>> candidates;
+
+    auto act = actual.begin();
+    auto exp = expected.begin();
+    while (act != actual.end() || exp != expected.end()) {
+        if (exp == expected.end() || (act != actual.end() && act->path < exp->path)) {
+            diff.unexpected_files.emplace_back(act++->path);
+        } else if (act == actual.end() || exp->path < act->path) {
+            diff.missing_files.emplace_back(exp++->path);
+        } else {
+            if (act->type != exp->type
+                || (act->type == fs::file_type::regular && act->size != exp->size)) {
+                diff.different_files.emplace_back(act->path);
+            } else if (act->type == fs::file_type::regular) {
+                candidates.emplace_back(&*act, &*exp);
+            }
+            ++act;
+            ++exp;
+        }
+    }
+
+    // Not std::vector<bool>, whose elements cannot be written from different threads
+    std::vector<char> same(candidates.size());
+    for (auto i = 0u; i < candidates.size(); ++i) {
+        run.submit([&, i] { same[i] = same_content(*candidates[i].first, *candidates[i].second); });
+    }
+    run.wait();
+    for (auto i = 0u; i < candidates.size(); ++i) {
+        if (!same[i]) {
+            diff.different_files.emplace_back(candidates[i].first->path);
+        }
+    }
+
+    for (auto list : {&diff.missing_files, &diff.unexpected_files, &diff.different_files}) {
+        std::sort(list->begin(), list->end());
+    }
+    return diff;
+}
+
+}  // namespace
+
+std::ostream& pf::operator<<(std::ostream& out, const tree_diff& diff) {
+    if (!diff.unexpected_files.empty()) {
+        out << "Unexpected files:\n";
+        for (auto& path : diff.unexpected_files) {
+            out << "  + " << path.string() << '\n';
+        }
+    }
+    if (!diff.missing_files.empty()) {
+        out << "Missing files:\n";
+        for (auto& path : diff.missing_files) {
+            out << "  - " << path.string() << '\n';
+        }
+    }
+    if (!diff.different_files.empty()) {
+        out << "Files that differ:\n";
+        for (auto& path : diff.different_files) {
+            out << " != " << path.string() << '\n';
+        }
+    }
+    return out;
+}
+
+pf::tree_diff pf::diff_tree(const fs::path&          root,
+                            const expected_tree&     expected,
+                            const tree_diff_options& opts) {
+    pf::trace::span span{"diff_tree", root};
+    ::runner        run{opts.jobs};
+    ::tree_lister   lister{run, opts};
+    lister.start(root);
+    run.wait();
+
+    return ::compare_listings(lister.take(),
+                              ::list_expected(expected, opts),
+                              run,
+                              [&](tree_entry const& act, tree_entry const& exp) {
+                                  std::error_code ec;
+                                  auto const      file = pf::map_file(root / act.path, ec);
+                                  return !ec && file.view() == *exp.content;
+                              });
+}
+
+pf::tree_diff pf::diff_trees(const fs::path&          actual,
+                             const fs::path&          expected,
+                             const tree_diff_options& opts) {
+    pf::trace::span span{"diff_trees", actual};
+    ::runner        run{opts.jobs};
+    ::tree_lister   actual_lister{run, opts};
+    ::tree_lister   expected_lister{run, opts};
+    actual_lister.start(actual);
+    expected_lister.start(expected);
+    run.wait();
+
+    return ::compare_listings(actual_lister.take(),
+                              expected_lister.take(),
+                              run,
+                              [&](tree_entry const& act, tree_entry const& exp) {
+                                  std::error_code ec;
+                                  auto const      act_file = pf::map_file(actual / act.path, ec);
+                                  if (ec) {
+                                      return false;
+                                  }
+                                  auto const exp_file = pf::map_file(expected / exp.path, ec);
+                                  return !ec && act_file.view() == exp_file.view();
+                              });
+}
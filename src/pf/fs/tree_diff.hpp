@@ -0,0 +1,77 @@
+#ifndef PF_FS_TREE_DIFF_HPP_INCLUDED
+#define PF_FS_TREE_DIFF_HPP_INCLUDED
+
+#include <pf/fs/core.hpp>
+
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace pf {
+
+/**
+ * The differences between a directory tree and what it was expected to hold. Paths are relative
+ * to the root of the tree, and each list is sorted.
+ */
+struct tree_diff {
+    /// Expected, but not present
+    std::vector<fs::path> missing_files;
+    /// Present, but not expected
+    std::vector<fs::path> unexpected_files;
+    /// Present, but with other content, or a file where a directory was expected (or vice versa)
+    std::vector<fs::path> different_files;
+
+    explicit operator bool() const noexcept {
+        return !missing_files.empty() || !unexpected_files.empty() || !different_files.empty();
+    }
+};
+
+std::ostream& operator<<(std::ostream& out, const tree_diff& diff);
+
+/**
+ * What a directory tree is expected to hold. Paths are relative to its root. The parents of the
+ * files are expected to be directories, and need not be listed in `directories`.
+ */
+struct expected_tree {
+    std::vector<fs::path>           directories;
+    std::map<fs::path, std::string> files;
+};
+
+struct tree_diff_options {
+    /**
+     * The number of threads used to walk the tree and compare files, as for `glob_options`. `1`
+     * does all of the work on the calling thread.
+     */
+    unsigned jobs = 1;
+    /**
+     * If set, paths (relative to the root) for which this returns `true` are left out of the
+     * comparison on both sides, along with everything below them.
+     */
+    std::function<bool(const fs::path&)> ignore;
+};
+
+/**
+ * Compare the tree at `root` with what it is expected to hold. Only files of the same size have
+ * their content compared. If `root` does not exist, everything expected is missing. Symlinks are
+ * not followed into directories.
+ */
+tree_diff diff_tree(const fs::path& root, const expected_tree& expected, const tree_diff_options&);
+
+inline tree_diff diff_tree(const fs::path& root, const expected_tree& expected) {
+    return diff_tree(root, expected, tree_diff_options{});
+}
+
+/**
+ * Compare the tree at `actual` with the tree at `expected`, as with `diff_tree`.
+ */
+tree_diff diff_trees(const fs::path& actual, const fs::path& expected, const tree_diff_options&);
+
+inline tree_diff diff_trees(const fs::path& actual, const fs::path& expected) {
+    return diff_trees(actual, expected, tree_diff_options{});
+}
+
+}  // namespace pf
+
+#endif  // PF_FS_TREE_DIFF_HPP_INCLUDED
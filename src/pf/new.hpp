@@ -2,6 +2,7 @@
 #define PF_NEW_HPP_INCLUDED
 
 #include <pf/new/dirs.hpp>
+#include <pf/new/manifest.hpp>
 #include <pf/new/params.hpp>
 #include <pf/new/project.hpp>
 
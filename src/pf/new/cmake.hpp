@@ -3,10 +3,11 @@
 
 #include <pf/fs.hpp>
 #include <pf/new/params.hpp>
+#include <pf/new/plan.hpp>
 
 namespace pf {
 
-void create_cmake_files(const new_project_params& params);
+void plan_cmake_files(const new_project_params& params, project_plan& plan);
 
 }  // namespace pf
 
@@ -2,30 +2,29 @@
 
 #include <pf/new/project.hpp>
 
-void pf::create_directories(const pf::new_project_params& params) {
-    // Create the root directory
-    fs::create_directories(params.directory);
+void pf::plan_directories(const pf::new_project_params& params, pf::project_plan& plan) {
+    auto& dirs = plan.directories;
     // Required subdirectories:
-    fs::create_directories(params.directory / "src");
-    fs::create_directories(params.directory / "docs");
+    dirs.emplace_back("src");
+    dirs.emplace_back("docs");
     // Conditional subdirs:
     if (params.separate_headers) {
-        fs::create_directories(params.directory / "include");
+        dirs.emplace_back("include");
     }
     if (params.create_third_party) {
-        fs::create_directories(params.directory / "third_party");
+        dirs.emplace_back("third_party");
     }
     if (params.create_examples) {
-        fs::create_directories(params.directory / "examples");
+        dirs.emplace_back("examples");
     }
     if (params.create_extras) {
-        fs::create_directories(params.directory / "extras");
+        dirs.emplace_back("extras");
     }
     if (params.create_tests) {
-        fs::create_directories(params.directory / "tests");
+        dirs.emplace_back("tests");
     }
     // Build system
     if (params.build_system == pf::build_system::cmake) {
-        fs::create_directories(params.directory / "cmake");
+        dirs.emplace_back("cmake");
     }
 }
@@ -2,11 +2,12 @@
 #define PF_NEW_DIRS_HPP_INCLUDED
 
 #include <pf/new/params.hpp>
+#include <pf/new/plan.hpp>
 
 namespace pf {
 
-void create_directories(const new_project_params& params);
+void plan_directories(const new_project_params& params, project_plan& plan);
 
 }  // namespace pf
 
-#endif  // PF_NEW_DIRS_HPP_INCLUDED
\ No newline at end of file
+#endif  // PF_NEW_DIRS_HPP_INCLUDED
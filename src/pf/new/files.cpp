@@ -1,26 +1,12 @@
 #include "./files.hpp"
 
 #include <pf/file_template.hpp>
-#include <pf/new/dirs.hpp>
 #include <pf/new/project.hpp>
 
-#include <cmrc/cmrc.hpp>
-
 #include <boost/algorithm/string.hpp>
-#include <kainjow/mustache.hpp>
-
-#include <fstream>
 
-CMRC_DECLARE(pf_templates);
-
-void pf::create_files(const pf::new_project_params& params) {
-    pf::template_renderer trr{params.directory, cmrc::pf_templates::get_filesystem()};
-    // The first file path will be based on the namespace root namespace
+pf::render_context pf::template_context_for(const pf::new_project_params& params) {
     auto ns_path = path_for_namespace(params.root_namespace);
-    // The first file paths:
-    auto first_src    = "src" / ns_path / (params.first_file_stem + ".cpp");
-    auto first_header = (params.separate_headers ? "include" : "src") / ns_path
-        / (params.first_file_stem + ".hpp");
 
     // Prepare the include guard string by replacing non-ident elements with '_'
     auto guard = (ns_path.string() + "_" + params.first_file_stem + "_HPP_INCLUDED");
@@ -29,22 +15,40 @@ void pf::create_files(const pf::new_project_params& params) {
     boost::replace_all(guard, ".", "_");
     boost::to_upper(guard);
 
-    // Set up the template render context
-    trr.set("root_ns", params.root_namespace);
-    trr.set("first_stem", params.first_file_stem);
-    trr.set("ns_path", ns_path.string());
-    trr.set("guard_def", guard);
+    pf::render_context ctx;
+    ctx.set("alias_target", params.root_namespace + "::" + params.name);
+    ctx.set("root_ns", params.root_namespace);
+    ctx.set("project_name", params.name);
+    ctx.set("ns_path", ns_path.string());
+    ctx.set("first_stem", params.first_file_stem);
+    ctx.set("guard_def", guard);
+    ctx.set("gen_extras", params.create_extras);
+    ctx.set("gen_examples", params.create_examples);
+    ctx.set("gen_third_party", params.create_third_party);
+    ctx.set("gen_tests", params.create_tests);
+    ctx.set("separate_headers", params.separate_headers);
+    return ctx;
+}
+
+void pf::plan_files(const pf::new_project_params& params, pf::project_plan& plan) {
+    auto& files = plan.files;
+    // The first file path will be based on the namespace root namespace
+    auto ns_path = path_for_namespace(params.root_namespace);
+    // The first file paths:
+    auto first_src    = "src" / ns_path / (params.first_file_stem + ".cpp");
+    auto first_header = (params.separate_headers ? "include" : "src") / ns_path
+        / (params.first_file_stem + ".hpp");
 
     // Base files
-    trr.render_to_file("base/first_source.in.cpp", first_src);
-    trr.render_to_file("base/first_header.in.hpp", first_header);
+    files.push_back({"base/first_source.in.cpp", first_src});
+    files.push_back({"base/first_header.in.hpp", first_header});
 
     // Optional files
     if (params.create_examples) {
-        trr.render_to_file("base/first_example.in.cpp", "examples/example1.cpp");
+        files.push_back({"base/first_example.in.cpp", "examples/example1.cpp"});
     }
 
     if (params.create_tests) {
-        trr.render_to_file("base/first_test.in.cpp", "tests/my_test.cpp");
+        files.push_back({"base/first_test.in.cpp", "tests/my_test.cpp"});
     }
 }
@@ -1,11 +1,18 @@
 #ifndef PF_NEW_FILES_HPP_INCLUDED
 #define PF_NEW_FILES_HPP_INCLUDED
 
+#include <pf/file_template.hpp>
 #include <pf/new/params.hpp>
+#include <pf/new/plan.hpp>
 
 namespace pf {
 
-void create_files(const pf::new_project_params& params);
+/**
+ * The data used to render every template of a new project.
+ */
+render_context template_context_for(const new_project_params& params);
+
+void plan_files(const new_project_params& params, project_plan& plan);
 
 }  // namespace pf
 
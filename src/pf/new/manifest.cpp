@@ -0,0 +1,274 @@
+#include "./manifest.hpp"
+
+#include <pf/new/project.hpp>
+#include <pf/util/trace.hpp>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace fs = pf::fs;
+
+namespace {
+
+constexpr std::string_view KnownFields[] = {
+    "name",
+    "namespace",
+    "first_file",
+    "directory",
+    "build_system",
+    "split_headers",
+    "tests",
+    "third_party",
+    "examples",
+    "extras",
+};
+
+bool is_known_field(std::string_view key) {
+    return std::find(std::begin(KnownFields), std::end(KnownFields), key) != std::end(KnownFields);
+}
+
+// Parse a boolean cell, leaving `out` alone if it is empty. Returns `false` if it is not a boolean.
+bool parse_bool(std::string_view value, bool& out) {
+    if (value.empty()) {
+        return true;
+    }
+    if (value == "true" || value == "yes" || value == "1") {
+        out = true;
+        return true;
+    }
+    if (value == "false" || value == "no" || value == "0") {
+        out = false;
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+pf::manifest_entry pf::make_manifest_entry(std::size_t            row,
+                                           const manifest_fields& fields,
+                                           const fs::path&        base_dir) {
+    manifest_entry entry;
+    entry.row = row;
+
+    auto const get = [&](std::string_view key) -> std::string {
+        auto found = std::find_if(fields.begin(), fields.end(), [&](auto const& field) {
+            return field.first == key;
+        });
+        return found == fields.end() ? std::string{} : found->second;
+    };
+
+    for (auto const& [key, value] : fields) {
+        if (!::is_known_field(key)) {
+            entry.error = "Unknown field `" + key + "`";
+            return entry;
+        }
+    }
+
+    auto const name = get("name");
+    if (name.empty()) {
+        entry.error = "No name for the project";
+        return entry;
+    }
+
+    auto ns = get("namespace");
+    if (ns.empty()) {
+        ns = pf::namespace_for_name(name);
+    }
+    auto directory = fs::path{get("directory")};
+    if (directory.empty()) {
+        directory = name;
+    }
+    directory       = fs::absolute(base_dir / directory);
+    auto first_file = get("first_file");
+    if (first_file.empty()) {
+        first_file = directory.stem().string();
+    }
+
+    new_project_params params{name, ns, first_file, directory};
+    params.build_system = pf::build_system::cmake;
+
+    auto const build_system = get("build_system");
+    if (build_system == "none") {
+        params.build_system = pf::build_system::none;
+    } else if (!build_system.empty() && build_system != "cmake") {
+        entry.error = "Invalid build_system `" + build_system + "` (Expected `none` or `cmake`)";
+        return entry;
+    }
+
+    std::pair<const char*, bool*> const toggles[] = {
+        {"split_headers", &params.separate_headers},
+        {"tests", &params.create_tests},
+        {"third_party", &params.create_third_party},
+        {"examples", &params.create_examples},
+        {"extras", &params.create_extras},
+    };
+    for (auto [key, value] : toggles) {
+        if (!::parse_bool(get(key), *value)) {
+            entry.error = "Invalid value `" + get(key) + "` for `" + key + "` (Expected a boolean)";
+            return entry;
+        }
+    }
+
+    entry.params = std::move(params);
+    return entry;
+}
+
+namespace {
+
+struct csv_record {
+    std::size_t              line;
+    std::vector<std::string> cells;
+};
+
+// Split CSV content into records, following RFC 4180. Blank lines are skipped.
+std::vector<csv_record> split_csv(std::string_view content) {
+    std::vector<csv_record> records;
+
+    std::size_t line = 1;
+    std::size_t pos  = 0;
+    while (pos < content.size()) {
+        csv_record  record{line, {}};
+        std::string cell;
+        bool        end_of_record = false;
+        while (!end_of_record) {
+            if (pos < content.size() && content[pos] == '"') {
+                // Quoted cell: Runs until a lone closing quote. A doubled quote is a literal one.
+                auto const start_line = line;
+                ++pos;
+                while (true) {
+                    if (pos >= content.size()) {
+                        throw std::runtime_error("Unterminated quoted cell starting on line "
+                                                 + std::to_string(start_line));
+                    }
+                    auto c = content[pos++];
+                    if (c == '"') {
+                        if (pos < content.size() && content[pos] == '"') {
+                            ++pos;
+                        } else {
+                            break;
+                        }
+                    } else if (c == '\n') {
+                        ++line;
+                    }
+                    cell.push_back(c);
+                }
+            }
+            // Unquoted text (or anything trailing a quoted cell) up to the next separator
+            while (pos < content.size() && content[pos] != ',' && content[pos] != '\n') {
+                cell.push_back(content[pos++]);
+            }
+            if (!cell.empty() && cell.back() == '\r') {
+                cell.pop_back();
+            }
+            record.cells.push_back(std::move(cell));
+            cell.clear();
+
+            if (pos >= content.size() || content[pos] == '\n') {
+                end_of_record = true;
+                ++line;
+            }
+            ++pos;
+        }
+        if (record.cells.size() > 1 || !record.cells[0].empty()) {
+            records.push_back(std::move(record));
+        }
+    }
+    return records;
+}
+
+}  // namespace
+
+std::vector<pf::manifest_entry> pf::parse_csv_manifest(std::string_view content,
+                                                       const fs::path&  base_dir) {
+    auto records = ::split_csv(content);
+    if (records.empty()) {
+        return {};
+    }
+
+    auto const& header = records.front().cells;
+    for (auto const& column : header) {
+        if (!::is_known_field(column)) {
+            throw std::runtime_error("Unknown column `" + column + "` in manifest");
+        }
+    }
+
+    std::vector<manifest_entry> entries;
+    for (auto it = records.begin() + 1; it != records.end(); ++it) {
+        if (it->cells.size() != header.size()) {
+            manifest_entry entry;
+            entry.row   = it->line;
+            entry.error = "Expected " + std::to_string(header.size()) + " cells, but got "
+                + std::to_string(it->cells.size());
+            entries.push_back(std::move(entry));
+            continue;
+        }
+        pf::manifest_fields fields;
+        for (auto i = 0u; i < header.size(); ++i) {
+            fields.emplace_back(header[i], std::move(it->cells[i]));
+        }
+        entries.push_back(pf::make_manifest_entry(it->line, fields, base_dir));
+    }
+    return entries;
+}
+
+std::vector<pf::manifest_entry> pf::parse_json_manifest(std::string_view content,
+                                                        const fs::path&  base_dir) {
+    namespace pt = boost::property_tree;
+
+    pt::ptree          root;
+    std::istringstream in{std::string{content}};
+    try {
+        pt::read_json(in, root);
+    } catch (const pt::json_parser_error& e) {
+        throw std::runtime_error("Invalid JSON on line " + std::to_string(e.line()) + ": "
+                                 + e.message());
+    }
+
+    std::vector<manifest_entry> entries;
+    std::size_t                 row = 0;
+    for (auto const& [key, object] : root) {
+        if (!key.empty()) {
+            throw std::runtime_error("The manifest must be a JSON array of objects");
+        }
+        ++row;
+        pf::manifest_fields fields;
+        bool                is_object = object.data().empty();
+        for (auto const& [field, value] : object) {
+            // Nested objects and arrays have children, and array elements have no key
+            if (field.empty() || !value.empty()) {
+                is_object = false;
+                break;
+            }
+            fields.emplace_back(field, value.data());
+        }
+        if (!is_object) {
+            manifest_entry entry;
+            entry.row   = row;
+            entry.error = "Expected an object with string or boolean values";
+            entries.push_back(std::move(entry));
+            continue;
+        }
+        entries.push_back(pf::make_manifest_entry(row, fields, base_dir));
+    }
+    return entries;
+}
+
+std::vector<pf::manifest_entry> pf::read_manifest(const fs::path& manifest,
+                                                  const fs::path& base_dir) {
+    pf::trace::span span{"read_manifest", manifest};
+    auto const      content = pf::map_file(manifest);
+    auto const      ext     = manifest.extension();
+    if (ext == ".json") {
+        return pf::parse_json_manifest(content.view(), base_dir);
+    } else if (ext == ".csv") {
+        return pf::parse_csv_manifest(content.view(), base_dir);
+    }
+    throw std::runtime_error("Cannot determine the format of " + manifest.string()
+                             + " (Expected a .json or .csv file)");
+}
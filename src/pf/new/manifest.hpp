@@ -0,0 +1,67 @@
+#ifndef PF_NEW_MANIFEST_HPP_INCLUDED
+#define PF_NEW_MANIFEST_HPP_INCLUDED
+
+#include <pf/fs.hpp>
+#include <pf/new/params.hpp>
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace pf {
+
+/**
+ * A project listed in a manifest. Holds either the parameters for the project, or the reason the
+ * row is invalid.
+ */
+struct manifest_entry {
+    /// The line (CSV) or array index (JSON) of the row, starting from 1
+    std::size_t                       row = 0;
+    std::optional<new_project_params> params;
+    std::string                       error;
+};
+
+/// The (column, value) pairs describing a single project
+using manifest_fields = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * Parse a single row of a manifest. See `parse_csv_manifest` for the recognized fields.
+ */
+manifest_entry make_manifest_entry(std::size_t            row,
+                                   const manifest_fields& fields,
+                                   const fs::path&        base_dir);
+
+/**
+ * Parse a CSV manifest. The first line names the columns, and each further line describes a
+ * project. The recognized columns are:
+ *
+ * - `name` (required)
+ * - `namespace` (default: derived from the name)
+ * - `first_file` (default: the name of the project directory)
+ * - `directory` (default: `<base_dir>/<name>`, relative paths are relative to `base_dir`)
+ * - `build_system`: `none` or `cmake` (default: `cmake`)
+ * - `split_headers`, `tests`, `third_party`, `examples`, `extras`: `true`/`false`, `yes`/`no`
+ *   or `1`/`0` (defaults as for `pf new`)
+ *
+ * Empty cells take the default. Throws `std::runtime_error` if the file as a whole cannot be
+ * understood. Problems with individual rows are reported in the returned entries instead.
+ */
+std::vector<manifest_entry> parse_csv_manifest(std::string_view content, const fs::path& base_dir);
+
+/**
+ * Parse a JSON manifest: An array of objects with the same keys as the columns of a CSV manifest.
+ * Booleans may be given as JSON booleans or as strings.
+ */
+std::vector<manifest_entry> parse_json_manifest(std::string_view content, const fs::path& base_dir);
+
+/**
+ * Read a manifest, choosing the format based on the file extension (`.json` or `.csv`).
+ */
+std::vector<manifest_entry> read_manifest(const fs::path& manifest, const fs::path& base_dir);
+
+}  // namespace pf
+
+#endif  // PF_NEW_MANIFEST_HPP_INCLUDED
@@ -0,0 +1,29 @@
+#ifndef PF_NEW_PLAN_HPP_INCLUDED
+#define PF_NEW_PLAN_HPP_INCLUDED
+
+#include <pf/fs.hpp>
+
+#include <string>
+#include <vector>
+
+namespace pf {
+
+struct planned_file {
+    /// The embedded template to render
+    std::string template_path;
+    /// Where to write it, relative to the project directory
+    fs::path path;
+};
+
+/**
+ * Everything that needs to be created for a new project. Paths are relative to the project
+ * directory. Parents of the planned files need not be listed in `directories`.
+ */
+struct project_plan {
+    std::vector<fs::path>     directories;
+    std::vector<planned_file> files;
+};
+
+}  // namespace pf
+
+#endif  // PF_NEW_PLAN_HPP_INCLUDED
@@ -4,11 +4,19 @@
 #include <pf/new/dirs.hpp>
 #include <pf/new/files.hpp>
 
+#include <pf/file_template.hpp>
+#include <pf/util/trace.hpp>
+
 #include <boost/algorithm/string.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <memory>
+#include <set>
+
+namespace fs = pf::fs;
 
-pf::fs::path pf::path_for_namespace(const std::string& ns) {
+fs::path pf::path_for_namespace(const std::string& ns) {
     return boost::replace_all_copy(ns, "::", "/");
 }
 
@@ -20,12 +28,151 @@ std::string pf::namespace_for_name(const std::string& name) {
     return ns;
 }
 
-void pf::create_project(const pf::new_project_params& params) {
+pf::project_plan pf::plan_project(const pf::new_project_params& params) {
+    pf::trace::span  span{"plan_project", params.name};
+    pf::project_plan plan;
+    pf::plan_directories(params, plan);
+    pf::plan_files(params, plan);
+    if (params.build_system == pf::build_system::cmake) {
+        pf::plan_cmake_files(params, plan);
+    }
+    return plan;
+}
+
+namespace {
+
+/**
+ * Create the project's directories, and hand a task to write each file to `submit`. `submit` may
+ * run the task straight away.
+ */
+template <typename Submit>
+void create_planned(const pf::new_project_params& params,
+                    pf::project_plan const&       plan,
+                    Submit&&                      submit) {
     assert(!params.name.empty() && "No name for project");
     assert(!params.root_namespace.empty() && "No namespace for project!");
-    pf::create_directories(params);
-    pf::create_files(params);
-    if (params.build_system == pf::build_system::cmake) {
-        pf::create_cmake_files(params);
+    pf::trace::span span{"create_project", params.directory};
+
+    // Create the whole skeleton up front, so the files can be written in any order. Sorting puts
+    // parents before their children, so each directory needs only a single mkdir.
+    {
+        pf::trace::span       dirs_span{"create_directories"};
+        std::vector<fs::path> dirs = plan.directories;
+        for (auto const& file : plan.files) {
+            for (auto dir = file.path.parent_path(); !dir.empty(); dir = dir.parent_path()) {
+                dirs.push_back(dir);
+            }
+        }
+        std::sort(dirs.begin(), dirs.end());
+        dirs.erase(std::unique(dirs.begin(), dirs.end()), dirs.end());
+        fs::create_directories(params.directory);
+        for (auto const& dir : dirs) {
+            fs::create_directory(params.directory / dir);
+        }
+    }
+
+    // Shared by all of the project's files, and kept alive until the last one is written
+    auto ctx = std::make_shared<const pf::render_context>(pf::template_context_for(params));
+    for (auto const& file : plan.files) {
+        auto const& tmpl = pf::get_template(file.template_path);
+        submit([ctx, &tmpl, out_path = params.directory / file.path] {
+            pf::trace::span span{"write_file", out_path};
+            auto            out = pf::open(out_path, std::ios::out | std::ios::binary);
+            tmpl.render(*ctx, out);
+            pf::trace::add(pf::trace::counter::bytes_written, out.tellp());
+            // Explicitly, so a failure to flush is reported
+            out.close();
+        });
+    }
+}
+
+}  // namespace
+
+void pf::create_project(const pf::new_project_params& params, pf::task_pool& pool) {
+    ::create_planned(params, pf::plan_project(params), [&](pf::task_pool::task t) {
+        pool.submit(std::move(t));
+    });
+}
+
+void pf::create_project(const pf::new_project_params& params) {
+    auto const plan = pf::plan_project(params);
+    auto const jobs = std::min(static_cast<unsigned>(plan.files.size()),
+                               pf::task_pool::default_concurrency());
+    pf::task_pool pool{std::max(jobs, 1u)};
+    ::create_planned(params, plan, [&](pf::task_pool::task t) { pool.submit(std::move(t)); });
+    pool.wait();
+}
+
+std::vector<std::string> pf::create_projects(const std::vector<new_project_params>& all,
+                                             unsigned                               jobs) {
+    std::vector<std::string> errors(all.size());
+
+    // Two rows naming the same directory would race each other, so reject all but the first
+    std::set<fs::path> seen_dirs;
+    for (auto i = 0u; i < all.size(); ++i) {
+        if (!seen_dirs.insert(fs::absolute(all[i].directory).lexically_normal()).second) {
+            errors[i] = "Another project is already being created in "
+                + all[i].directory.string();
+        }
+    }
+
+    // Each project is created by a single task, so a failure affects only its own project
+    pf::task_pool pool{jobs};
+    for (auto i = 0u; i < all.size(); ++i) {
+        if (!errors[i].empty()) {
+            continue;
+        }
+        pool.submit([&params = all[i], &error = errors[i]] {
+            try {
+                std::error_code ec;
+                if (fs::exists(params.directory, ec)) {
+                    error = "Destination path names an existing file or directory ("
+                        + params.directory.string() + ")";
+                    return;
+                }
+                ::create_planned(params, pf::plan_project(params), [](auto&& t) { t(); });
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+        });
+    }
+    pool.wait();
+    return errors;
+}
+
+pf::expected_tree pf::render_project(const pf::new_project_params& params) {
+    pf::trace::span span{"render_project", params.name};
+    auto const      plan = pf::plan_project(params);
+    auto const      ctx  = pf::template_context_for(params);
+
+    pf::expected_tree ret;
+    ret.directories = plan.directories;
+    for (auto const& file : plan.files) {
+        ret.files[file.path] = pf::get_template(file.template_path).render(ctx);
+    }
+    return ret;
+}
+
+std::vector<pf::project_diff> pf::diff_projects(const std::vector<new_project_params>& all,
+                                                unsigned                               jobs) {
+    std::vector<project_diff> results(all.size());
+
+    // As with create_projects(), each project is handled by a single task
+    pf::task_pool pool{jobs};
+    for (auto i = 0u; i < all.size(); ++i) {
+        pool.submit([&params = all[i], &result = results[i]] {
+            try {
+                std::error_code ec;
+                if (!fs::is_directory(params.directory, ec)) {
+                    result.error = "No project directory at " + params.directory.string();
+                    return;
+                }
+                result.diff = pf::diff_tree(params.directory, pf::render_project(params));
+            } catch (const std::exception& e) {
+                result.error = e.what();
+            }
+        });
     }
+    pool.wait();
+    return results;
 }
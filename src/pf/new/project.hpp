@@ -3,6 +3,11 @@
 
 #include <pf/fs.hpp>
 #include <pf/new/params.hpp>
+#include <pf/new/plan.hpp>
+#include <pf/util/task_pool.hpp>
+
+#include <string>
+#include <vector>
 
 namespace pf {
 
@@ -10,6 +15,45 @@ fs::path    path_for_namespace(const std::string& ns);
 void        create_project(const new_project_params& params);
 std::string namespace_for_name(const std::string& name);
 
+/**
+ * Determine the directories and files to create for a new project.
+ */
+project_plan plan_project(const new_project_params& params);
+
+/**
+ * Create the directories of a new project, and queue rendering its files on `pool`. The project
+ * is only complete once `pool.wait()` returns, which also rethrows any failure to write a file.
+ */
+void create_project(const new_project_params& params, task_pool& pool);
+
+/**
+ * Create many projects, `jobs` at a time (zero meaning one per CPU). A failure to create one
+ * project does not affect the others. Returns the error for each project, or an empty string for
+ * those created successfully.
+ */
+std::vector<std::string> create_projects(const std::vector<new_project_params>& all,
+                                         unsigned                               jobs = 0);
+
+/**
+ * Render the files of a new project in memory, without touching the filesystem. This is exactly
+ * what `create_project` would write.
+ */
+expected_tree render_project(const new_project_params& params);
+
+/// How an existing project differs from what `create_project` would generate for it
+struct project_diff {
+    tree_diff diff;
+    /// Set if the project could not be compared
+    std::string error;
+};
+
+/**
+ * Compare many existing projects with what `create_project` would generate for them, `jobs` at a
+ * time (zero meaning one per CPU). A project whose directory does not exist is an error.
+ */
+std::vector<project_diff> diff_projects(const std::vector<new_project_params>& all,
+                                        unsigned                               jobs = 0);
+
 }  // namespace pf
 
 #endif  // PF_NEW_PROJECT_HPP_INCLUDED
\ No newline at end of file
@@ -0,0 +1,7 @@
+#ifndef PF_SERVE_HPP_INCLUDED
+#define PF_SERVE_HPP_INCLUDED
+
+#include <pf/serve/rpc.hpp>
+#include <pf/serve/server.hpp>
+
+#endif  // PF_SERVE_HPP_INCLUDED
@@ -0,0 +1,61 @@
+#include "./rpc.hpp"
+
+#include <boost/algorithm/string.hpp>
+
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+std::optional<std::string> pf::read_rpc_message(std::istream& in) {
+    std::optional<std::size_t> length;
+    bool                       in_header = false;
+    std::string                line;
+    while (true) {
+        if (!std::getline(in, line)) {
+            if (!in_header) {
+                return std::nullopt;
+            }
+            throw std::runtime_error("Unexpected end of input within a message header");
+        }
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            if (!in_header) {
+                // Tolerate blank lines between messages
+                continue;
+            }
+            break;
+        }
+        in_header = true;
+
+        auto const colon = line.find(':');
+        if (colon == line.npos) {
+            throw std::runtime_error("Invalid message header line: " + line);
+        }
+        auto const name  = boost::trim_copy(line.substr(0, colon));
+        auto const value = boost::trim_copy(line.substr(colon + 1));
+        if (!boost::iequals(name, "Content-Length")) {
+            continue;
+        }
+        if (value.empty() || value.find_first_not_of("0123456789") != value.npos) {
+            throw std::runtime_error("Invalid Content-Length: " + value);
+        }
+        length = std::stoull(value);
+    }
+
+    if (!length) {
+        throw std::runtime_error("Message has no Content-Length header");
+    }
+    std::string content(*length, '\0');
+    in.read(content.data(), static_cast<std::streamsize>(content.size()));
+    if (static_cast<std::size_t>(in.gcount()) != content.size()) {
+        throw std::runtime_error("Unexpected end of input within a message");
+    }
+    return content;
+}
+
+void pf::write_rpc_message(std::ostream& out, std::string_view content) {
+    out << "Content-Length: " << content.size() << "\r\n\r\n" << content;
+    out.flush();
+}
@@ -0,0 +1,28 @@
+#ifndef PF_SERVE_RPC_HPP_INCLUDED
+#define PF_SERVE_RPC_HPP_INCLUDED
+
+#include <pf/util/json.hpp>
+
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace pf {
+
+/**
+ * Read one message framed with a `Content-Length` header, as used by the Language Server Protocol
+ * (and so by VS Code's `vscode-jsonrpc`). Other headers are ignored. Returns `std::nullopt` once
+ * the input ends between messages, and throws `std::runtime_error` if it ends within a message or
+ * the framing is invalid.
+ */
+std::optional<std::string> read_rpc_message(std::istream& in);
+
+/**
+ * Write one message with a `Content-Length` header, and flush the stream.
+ */
+void write_rpc_message(std::ostream& out, std::string_view content);
+
+}  // namespace pf
+
+#endif  // PF_SERVE_RPC_HPP_INCLUDED
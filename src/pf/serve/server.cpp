@@ -0,0 +1,471 @@
+#include "./server.hpp"
+
+#include <pf/existing/detect_base_dir.hpp>
+#include <pf/existing/project_config.hpp>
+#include <pf/existing/source_manifest.hpp>
+#include <pf/existing/update_source_files.hpp>
+#include <pf/new/manifest.hpp>
+#include <pf/new/project.hpp>
+#include <pf/serve/rpc.hpp>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <istream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace fs = pf::fs;
+namespace pt = boost::property_tree;
+
+namespace {
+
+// Error codes defined by JSON-RPC 2.0
+enum rpc_error_code : int {
+    parse_error      = -32700,
+    invalid_request  = -32600,
+    method_not_found = -32601,
+    invalid_params   = -32602,
+    // The request was valid, but could not be carried out
+    server_error = -32000,
+};
+
+class rpc_error : public std::runtime_error {
+public:
+    int code;
+
+    rpc_error(int code_, const std::string& message)
+        : std::runtime_error(message)
+        , code(code_) {}
+};
+
+// Skip the JSON whitespace at `pos`, returning the position of the first other character
+std::size_t skip_whitespace(std::string_view json, std::size_t pos) {
+    while (pos < json.size() && std::string_view{" \t\r\n"}.find(json[pos]) != json.npos) {
+        ++pos;
+    }
+    return pos;
+}
+
+// Skip the JSON string that starts at `pos`, returning the position just past it
+std::size_t skip_string(std::string_view json, std::size_t pos) {
+    for (++pos; pos < json.size() && json[pos] != '"'; ++pos) {
+        if (json[pos] == '\\') {
+            ++pos;
+        }
+    }
+    return std::min(pos + 1, json.size());
+}
+
+// Skip the JSON value that starts at `pos`, returning the position just past it
+std::size_t skip_value(std::string_view json, std::size_t pos) {
+    if (pos >= json.size()) {
+        return json.size();
+    }
+    if (json[pos] == '"') {
+        return ::skip_string(json, pos);
+    }
+    if (json[pos] == '{' || json[pos] == '[') {
+        int depth = 0;
+        while (pos < json.size()) {
+            auto const c = json[pos];
+            if (c == '"') {
+                pos = ::skip_string(json, pos);
+                continue;
+            }
+            ++pos;
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if ((c == '}' || c == ']') && --depth == 0) {
+                break;
+            }
+        }
+        return pos;
+    }
+    // A number or a literal runs up to the next delimiter
+    return std::min(json.find_first_of(",}] \t\r\n", pos), json.size());
+}
+
+/**
+ * The JSON of the "id" member of the request object in `message`, exactly as it was sent, or
+ * nothing if it has none. The JSON reader keeps every value as a string, so it cannot tell `7`
+ * from `"7"`, which JSON-RPC requires us to echo back as they came. `message` must be valid JSON,
+ * and member names are compared as they are written, without unescaping them.
+ */
+std::optional<std::string_view> raw_id(std::string_view message) {
+    auto pos = ::skip_whitespace(message, 0);
+    if (pos >= message.size() || message[pos] != '{') {
+        return std::nullopt;
+    }
+    ++pos;
+    while (true) {
+        pos = ::skip_whitespace(message, pos);
+        if (pos >= message.size() || message[pos] != '"') {
+            return std::nullopt;
+        }
+        auto const key_end = ::skip_string(message, pos);
+        auto const key     = message.substr(pos, key_end - pos);
+        // The value follows the colon
+        auto const value     = ::skip_whitespace(message, ::skip_whitespace(message, key_end) + 1);
+        auto const value_end = ::skip_value(message, value);
+        if (key == "\"id\"") {
+            return message.substr(value, value_end - value);
+        }
+        pos = ::skip_whitespace(message, value_end);
+        if (pos >= message.size() || message[pos] != ',') {
+            return std::nullopt;
+        }
+        ++pos;
+    }
+}
+
+// JSON-RPC only allows strings, numbers, and null as ids
+bool is_valid_id(std::string_view id) {
+    return id == "null"
+        || (!id.empty()
+            && (id[0] == '"' || id[0] == '-' || std::isdigit(static_cast<unsigned char>(id[0]))));
+}
+
+std::string error_response(std::string const& id, int code, std::string_view message) {
+    return R"({"jsonrpc":"2.0","id":)" + id + R"(,"error":{"code":)" + std::to_string(code)
+        + R"(,"message":)" + pf::json_quote(message) + "}}";
+}
+
+fs::path request_dir(pt::ptree const& params) {
+    auto const dir = params.get<std::string>("dir", "");
+    return dir.empty() ? fs::current_path() : fs::absolute(dir);
+}
+
+}  // namespace
+
+struct pf::server::project_state {
+    fs::path root;
+    // The directories whose CMakeLists.txt lists their sources
+    std::vector<fs::path> roots;
+    // Whether the project has a `source_manifest`, which lists every file below src/ and include/
+    bool manifest = false;
+    // The globs of the project's pitchfork.json, as they were when we started watching
+    source_patterns patterns;
+    // Null if file watching is not supported, in which case the source index is used instead
+    std::unique_ptr<source_watcher> watcher;
+    // The mtime of each root's CMakeLists.txt, and of the manifest, when we last brought it up to
+    // date
+    std::map<fs::path, fs::file_time_type> up_to_date;
+};
+
+struct pf::server::loaded_cache {
+    pf::cmake_cache    cache;
+    std::uintmax_t     size;
+    fs::file_time_type mtime;
+};
+
+pf::server::server(server_options opts)
+    : _opts(std::move(opts)) {}
+
+pf::server::~server() = default;
+
+std::string pf::server::handle(std::string_view message) {
+    pt::ptree request;
+    try {
+        std::istringstream in{std::string{message}};
+        pt::read_json(in, request);
+    } catch (const pt::json_parser_error& e) {
+        return ::error_response("null", parse_error, "Invalid JSON: " + e.message());
+    }
+
+    auto const raw = ::raw_id(message);
+    // A request without an id is a notification, which gets no response
+    auto const notification = !raw.has_value();
+    auto const id           = notification ? std::string{"null"} : std::string{*raw};
+    if (!notification && !::is_valid_id(id)) {
+        return ::error_response("null",
+                                invalid_request,
+                                "The id must be a string, a number, or null");
+    }
+    auto const method = request.get<std::string>("method", "");
+    if (method.empty()) {
+        return ::error_response(id, invalid_request, "The request has no method");
+    }
+
+    static pt::ptree const no_params;
+    auto const             params_node = request.get_child_optional("params");
+    auto const&            params      = params_node ? *params_node : no_params;
+
+    std::string result;
+    try {
+        if (method == "query") {
+            result = _query(params);
+        } else if (method == "update") {
+            result = _update(params);
+        } else if (method == "new") {
+            result = _new(params);
+        } else if (method == "shutdown" || method == "exit") {
+            _done  = true;
+            result = "null";
+        } else {
+            throw rpc_error{method_not_found, "Unknown method `" + method + "`"};
+        }
+    } catch (const rpc_error& e) {
+        return notification ? std::string{} : ::error_response(id, e.code, e.what());
+    } catch (const std::exception& e) {
+        return notification ? std::string{} : ::error_response(id, server_error, e.what());
+    }
+
+    if (notification) {
+        return {};
+    }
+    return R"({"jsonrpc":"2.0","id":)" + id + R"(,"result":)" + result + "}";
+}
+
+void pf::server::run(std::istream& in, std::ostream& out) {
+    while (!_done) {
+        auto const message = pf::read_rpc_message(in);
+        if (!message) {
+            return;
+        }
+        auto const response = handle(*message);
+        if (!response.empty()) {
+            pf::write_rpc_message(out, response);
+        }
+    }
+}
+
+fs::path pf::server::_base_dir_for(params const& params) {
+    if (_opts.base_dir) {
+        return *_opts.base_dir;
+    }
+    // Only a handful of stat() calls, so it is cheaper to repeat than to keep up to date
+    auto const dir = ::request_dir(params);
+    return pf::detect_base_dir(dir).value_or(dir);
+}
+
+fs::path pf::server::_cache_file_for(params const& params) {
+    auto const build_dir = params.get<std::string>("build_dir", "");
+    if (!build_dir.empty()) {
+        return fs::absolute(build_dir) / "CMakeCache.txt";
+    }
+    auto found = std::find_if(pf::ascending_iterator{::request_dir(params)},
+                              pf::ascending_iterator{},
+                              [](auto const& dir) { return fs::exists(dir / "CMakeCache.txt"); });
+    if (found != pf::ascending_iterator{}) {
+        return *found / "CMakeCache.txt";
+    }
+    return _base_dir_for(params) / "build" / "CMakeCache.txt";
+}
+
+pf::cmake_cache const& pf::server::_cache(fs::path const& cache_file) {
+    auto const size  = fs::file_size(cache_file);
+    auto const mtime = fs::last_write_time(cache_file);
+
+    auto& loaded = _caches[cache_file];
+    if (!loaded || loaded->size != size || loaded->mtime != mtime) {
+        loaded.reset(new loaded_cache{pf::cmake_cache::load(cache_file), size, mtime});
+    }
+    return loaded->cache;
+}
+
+std::string pf::server::_query(params const& params) {
+    constexpr std::string_view CachePrefix = "cache.";
+
+    auto const ids = params.get_child_optional("ids");
+    if (!ids || ids->empty()) {
+        throw rpc_error{invalid_params, "Expected `ids` to be a non-empty array of ids"};
+    }
+
+    cmake_cache const* cache  = nullptr;
+    std::string        result = "{";
+    for (auto const& [key, node] : *ids) {
+        auto const& id = node.data();
+        if (!key.empty() || !node.empty()) {
+            throw rpc_error{invalid_params, "Expected `ids` to be an array of strings"};
+        }
+
+        std::string value;
+        if (id == "project.root") {
+            value = pf::json_quote(_base_dir_for(params).string());
+        } else if (id.compare(0, CachePrefix.size(), CachePrefix) == 0) {
+            if (!cache) {
+                cache = &_cache(_cache_file_for(params));
+            }
+            auto const entry = cache->find(std::string_view{id}.substr(CachePrefix.size()));
+            value            = entry ? pf::json_quote(entry->value) : "null";
+        } else {
+            throw rpc_error{invalid_params, "Invalid id `" + id + "`"};
+        }
+
+        if (result.size() > 1) {
+            result += ',';
+        }
+        result += pf::json_quote(id) + ':' + value;
+    }
+    return result + '}';
+}
+
+pf::server::project_state& pf::server::_project(fs::path const& root) {
+    // A project built with pf_auto() need not have a src/CMakeLists.txt
+    auto const            manifest = pf::source_manifest::wanted(root);
+    std::vector<fs::path> roots;
+    if (!manifest || fs::is_regular_file(root / "src" / "CMakeLists.txt")) {
+        roots.push_back(root / "src");
+    }
+    if (fs::is_directory(root / "tests")) {
+        roots.push_back(root / "tests");
+    }
+
+    // Read each time, since the config is small and may be edited while we run
+    auto  patterns = pf::source_patterns_for(pf::load_project_config(root), {});
+    auto& state    = _projects[root];
+    if (state && state->roots == roots && state->manifest == manifest
+        && state->patterns.fingerprint() == patterns.fingerprint()) {
+        return *state;
+    }
+
+    // New, or the project's layout or config changed since we started watching
+    state.reset(new project_state{root, roots, manifest, std::move(patterns), nullptr, {}});
+    try {
+        if (manifest) {
+            // The manifest lists every file, so watch them all, and narrow them for the roots
+            auto watched = roots;
+            for (auto const& dir : {root / "src", root / "include"}) {
+                if (fs::is_directory(dir)
+                    && std::find(watched.begin(), watched.end(), dir) == watched.end()) {
+                    watched.push_back(dir);
+                }
+            }
+            state->watcher
+                = std::make_unique<pf::source_watcher>(watched, pf::source_patterns{{"*"}});
+        } else {
+            state->watcher = std::make_unique<pf::source_watcher>(roots, state->patterns);
+        }
+    } catch (const std::system_error& e) {
+        if (e.code() != std::errc::not_supported) {
+            _projects.erase(root);
+            throw;
+        }
+    }
+    return *state;
+}
+
+std::vector<fs::path> pf::server::_update_project(project_state& state) {
+    auto const                  index_path = pf::source_index::default_path(state.root);
+    std::optional<source_index> index;
+    std::vector<fs::path>       changed_roots;
+    if (state.watcher) {
+        changed_roots = state.watcher->poll_changes();
+    } else {
+        index = pf::source_index::load(state.root, index_path);
+    }
+    auto const root_changed = [&](fs::path const& root) {
+        return std::find(changed_roots.begin(), changed_roots.end(), root) != changed_roots.end();
+    };
+    // Whether `file` may be out of date: Without a watcher, we cannot tell
+    auto const stale = [&](fs::path const& file, bool sources_changed) {
+        std::error_code ec;
+        auto const      mtime = fs::last_write_time(file, ec);
+        auto const      known = state.up_to_date.find(file);
+        return !state.watcher || sources_changed || ec || known == state.up_to_date.end()
+            || known->second != mtime;
+    };
+
+    std::vector<fs::path> rewritten;
+    for (auto const& root : state.roots) {
+        auto const cmakelists = root / "CMakeLists.txt";
+        if (!stale(cmakelists, root_changed(root))) {
+            // Neither the sources nor the CMakeLists.txt changed since we last updated it
+            continue;
+        }
+
+        pf::glob_options glob_opts;
+        glob_opts.patterns = &state.patterns;
+        std::vector<fs::path> sources;
+        if (!state.watcher) {
+            sources = index->glob_sources(root, glob_opts);
+        } else if (state.manifest) {
+            sources = state.watcher->sources(root, state.patterns);
+        } else {
+            sources = state.watcher->sources(root);
+        }
+        if (pf::update_source_files(cmakelists, sources)) {
+            rewritten.push_back(cmakelists);
+        }
+        state.up_to_date[cmakelists] = fs::last_write_time(cmakelists);
+    }
+
+    if (state.manifest) {
+        auto const file = pf::source_manifest::path(state.root);
+        if (stale(file, root_changed(state.root / "src") || root_changed(state.root / "include"))) {
+            if (pf::update_source_manifest(state.root)) {
+                rewritten.push_back(file);
+            }
+            state.up_to_date[file] = fs::last_write_time(file);
+        }
+    }
+
+    if (index && index->dirty()) {
+        std::error_code ec;
+        // Not fatal: The index only saves time
+        index->save(index_path, ec);
+    }
+    return rewritten;
+}
+
+std::string pf::server::_update(params const& params) {
+    auto const root = _base_dir_for(params);
+    if (!fs::is_regular_file(root / "src" / "CMakeLists.txt")
+        && !pf::source_manifest::wanted(root)) {
+        throw rpc_error{server_error, "No project to update in " + root.string()};
+    }
+
+    std::vector<fs::path> rewritten;
+    try {
+        rewritten = _update_project(_project(root));
+    } catch (...) {
+        // Start afresh next time, in case the failure left the state inconsistent
+        _projects.erase(root);
+        throw;
+    }
+
+    std::string result = R"({"project":)" + pf::json_quote(root.string()) + R"(,"rewritten":[)";
+    for (auto const& file : rewritten) {
+        if (&file != &rewritten.front()) {
+            result += ',';
+        }
+        result += pf::json_quote(file.string());
+    }
+    return result + "]}";
+}
+
+std::string pf::server::_new(params const& params) {
+    pf::manifest_fields fields;
+    for (auto const& [key, node] : params) {
+        if (key == "dir") {
+            continue;
+        }
+        if (key.empty() || !node.empty()) {
+            throw rpc_error{invalid_params, "Expected an object with string or boolean values"};
+        }
+        fields.emplace_back(key, node.data());
+    }
+
+    auto const entry = pf::make_manifest_entry(1, fields, _base_dir_for(params));
+    if (!entry.params) {
+        throw rpc_error{invalid_params, entry.error};
+    }
+    auto const& project = *entry.params;
+    if (fs::exists(project.directory)) {
+        throw rpc_error{server_error,
+                        "Destination path names an existing file or directory ("
+                            + project.directory.string() + ")"};
+    }
+
+    if (!_pool) {
+        _pool = std::make_unique<pf::task_pool>(_opts.jobs);
+    }
+    pf::create_project(project, *_pool);
+    _pool->wait();
+    return R"({"directory":)" + pf::json_quote(project.directory.string()) + "}";
+}
@@ -0,0 +1,101 @@
+#ifndef PF_SERVE_SERVER_HPP_INCLUDED
+#define PF_SERVE_SERVER_HPP_INCLUDED
+
+#include <pf/existing/cmake_cache.hpp>
+#include <pf/fs.hpp>
+#include <pf/util/task_pool.hpp>
+
+#include <boost/property_tree/ptree_fwd.hpp>
+
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pf {
+
+struct server_options {
+    /// If set, the base directory for every request, rather than detecting it from the request
+    std::optional<fs::path> base_dir;
+    /// Number of threads used to write the files of new projects (zero: one per CPU)
+    unsigned jobs = 0;
+};
+
+/**
+ * Answers JSON-RPC 2.0 requests from editors and other tools, keeping what it learns about each
+ * project in memory between requests rather than paying to start a `pf` process every time.
+ *
+ * The sources of each project that has been updated are watched for changes with a
+ * `source_watcher`, so later updates need not scan the project again, and are skipped entirely
+ * if nothing changed. CMake caches stay loaded until the file changes, and parsed templates stay
+ * in the process-wide template cache. Where file watching is not supported, the project's
+ * `source_index` is used instead.
+ *
+ * Every request takes an optional `dir` parameter (default: the server's working directory),
+ * from which the base directory is detected as with `pf::detect_base_dir`. Relative paths are
+ * relative to the server's working directory. The methods are:
+ *
+ * - `query` `{ids: [...], build_dir?}`: An object mapping each id (as for `pf query`) to its
+ *   value, or to `null` for a missing CMake cache entry.
+ * - `update` `{}`: Update the source lists of the project, and its `source_manifest` if it is
+ *   built with `pf_auto()`, returning `{project, rewritten}`, where `rewritten` lists the files
+ *   that changed.
+ * - `new`: Create a project described by the fields of a manifest row (see
+ *   `pf::parse_csv_manifest`), returning `{directory}`.
+ * - `shutdown`: Stop reading further requests. `exit` does the same as a notification.
+ *
+ * Errors are reported with the standard JSON-RPC error codes, or -32000 for failures to carry out
+ * a valid request.
+ */
+class server {
+public:
+    explicit server(server_options opts = {});
+    ~server();
+
+    server(const server&) = delete;
+    server& operator=(const server&) = delete;
+
+    /// Handle a single message. Returns the response, or an empty string for a notification.
+    std::string handle(std::string_view message);
+
+    /**
+     * Handle messages framed as by `pf::read_rpc_message` from `in`, and write the responses to
+     * `out`, until the input ends or `done()`. Throws if the framing of the input is invalid.
+     */
+    void run(std::istream& in, std::ostream& out);
+
+    /// `true` once a `shutdown` request or `exit` notification has been handled
+    bool done() const noexcept { return _done; }
+
+    /// The number of projects whose state is being kept
+    std::size_t project_count() const noexcept { return _projects.size(); }
+
+private:
+    using params = boost::property_tree::ptree;
+
+    struct project_state;
+    struct loaded_cache;
+
+    server_options                                     _opts;
+    std::unique_ptr<task_pool>                         _pool;
+    std::map<fs::path, std::unique_ptr<project_state>> _projects;
+    std::map<fs::path, std::unique_ptr<loaded_cache>>  _caches;
+    bool                                               _done = false;
+
+    std::string _query(params const&);
+    std::string _update(params const&);
+    std::string _new(params const&);
+
+    fs::path              _base_dir_for(params const&);
+    fs::path              _cache_file_for(params const&);
+    cmake_cache const&    _cache(fs::path const& cache_file);
+    project_state&        _project(fs::path const& root);
+    std::vector<fs::path> _update_project(project_state&);
+};
+
+}  // namespace pf
+
+#endif  // PF_SERVE_SERVER_HPP_INCLUDED
@@ -0,0 +1,39 @@
+#include "./json.hpp"
+
+std::string pf::json_quote(std::string_view str) {
+    constexpr char hex_digits[] = "0123456789abcdef";
+
+    std::string ret;
+    ret.reserve(str.size() + 2);
+    ret.push_back('"');
+    for (char c : str) {
+        switch (c) {
+        case '"':
+            ret += "\\\"";
+            break;
+        case '\\':
+            ret += "\\\\";
+            break;
+        case '\n':
+            ret += "\\n";
+            break;
+        case '\r':
+            ret += "\\r";
+            break;
+        case '\t':
+            ret += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                ret += "\\u00";
+                ret.push_back(hex_digits[c >> 4]);
+                ret.push_back(hex_digits[c & 0xf]);
+            } else {
+                // Anything else, including UTF-8 sequences, may appear as-is
+                ret.push_back(c);
+            }
+        }
+    }
+    ret.push_back('"');
+    return ret;
+}
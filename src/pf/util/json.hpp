@@ -0,0 +1,16 @@
+#ifndef PF_UTIL_JSON_HPP_INCLUDED
+#define PF_UTIL_JSON_HPP_INCLUDED
+
+#include <string>
+#include <string_view>
+
+namespace pf {
+
+/**
+ * Quote and escape a string as a JSON string literal.
+ */
+std::string json_quote(std::string_view str);
+
+}  // namespace pf
+
+#endif  // PF_UTIL_JSON_HPP_INCLUDED
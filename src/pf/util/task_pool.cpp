@@ -0,0 +1,147 @@
+#include "./task_pool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Identifies the pool (and the slot within it) that the current thread works for
+thread_local const pf::task_pool* tl_pool  = nullptr;
+thread_local std::size_t          tl_index = 0;
+
+}  // namespace
+
+unsigned pf::task_pool::default_concurrency() noexcept {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+pf::task_pool::task_pool(unsigned n_workers) {
+    if (n_workers == 0) {
+        n_workers = default_concurrency();
+    }
+    _workers.reserve(n_workers);
+    for (auto i = 0u; i < n_workers; ++i) {
+        _workers.push_back(std::make_unique<worker>());
+    }
+    // Only start the threads once every worker slot exists, since they steal from each other
+    for (auto i = 0u; i < n_workers; ++i) {
+        _workers[i]->thread = std::thread{[this, i] { _run_worker(i); }};
+    }
+}
+
+pf::task_pool::~task_pool() {
+    {
+        // Let outstanding work drain. Errors are only reported through `wait()`.
+        std::unique_lock lk{_done_mutex};
+        _done_cv.wait(lk, [&] { return _pending == 0; });
+    }
+    {
+        std::lock_guard lk{_sleep_mutex};
+        _stop = true;
+    }
+    _sleep_cv.notify_all();
+    for (auto& w : _workers) {
+        w->thread.join();
+    }
+}
+
+std::size_t pf::task_pool::this_worker_index() const noexcept {
+    if (tl_pool != this) {
+        return _workers.size();
+    }
+    return tl_index;
+}
+
+void pf::task_pool::submit(task t) {
+    auto index = this_worker_index();
+    if (index == _workers.size()) {
+        // Submitted from outside the pool. Spread the work around.
+        index = _next_victim++ % _workers.size();
+    }
+    ++_pending;
+    {
+        auto& w = *_workers[index];
+        std::lock_guard lk{w.mutex};
+        w.tasks.push_back(std::move(t));
+    }
+    ++_queued;
+    // Lock-and-release before notifying so a worker cannot miss the update to `_queued` between
+    // checking its wait predicate and going to sleep.
+    { std::lock_guard lk{_sleep_mutex}; }
+    _sleep_cv.notify_one();
+}
+
+void pf::task_pool::wait() {
+    std::unique_lock lk{_done_mutex};
+    _done_cv.wait(lk, [&] { return _pending == 0; });
+    if (_error) {
+        auto err = std::exchange(_error, nullptr);
+        _failed  = false;
+        std::rethrow_exception(err);
+    }
+}
+
+bool pf::task_pool::_try_pop(std::size_t index, task& out) {
+    auto&           w = *_workers[index];
+    std::lock_guard lk{w.mutex};
+    if (w.tasks.empty()) {
+        return false;
+    }
+    out = std::move(w.tasks.back());
+    w.tasks.pop_back();
+    --_queued;
+    return true;
+}
+
+bool pf::task_pool::_try_steal(std::size_t thief, task& out) {
+    const auto n = _workers.size();
+    for (auto offset = 1u; offset < n; ++offset) {
+        auto&           w = *_workers[(thief + offset) % n];
+        std::lock_guard lk{w.mutex};
+        if (w.tasks.empty()) {
+            continue;
+        }
+        out = std::move(w.tasks.front());
+        w.tasks.pop_front();
+        --_queued;
+        return true;
+    }
+    return false;
+}
+
+void pf::task_pool::_run_task(task& t) {
+    if (!_failed) {
+        try {
+            t();
+        } catch (...) {
+            std::lock_guard lk{_done_mutex};
+            if (!_error) {
+                _error = std::current_exception();
+            }
+            _failed = true;
+        }
+    }
+    t = nullptr;
+    if (--_pending == 0) {
+        { std::lock_guard lk{_done_mutex}; }
+        _done_cv.notify_all();
+    }
+}
+
+void pf::task_pool::_run_worker(std::size_t index) {
+    tl_pool  = this;
+    tl_index = index;
+
+    task t;
+    while (true) {
+        if (_try_pop(index, t) || _try_steal(index, t)) {
+            _run_task(t);
+            continue;
+        }
+        std::unique_lock lk{_sleep_mutex};
+        _sleep_cv.wait(lk, [&] { return _stop || _queued != 0; });
+        if (_stop) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef PF_UTIL_TASK_POOL_HPP_INCLUDED
+#define PF_UTIL_TASK_POOL_HPP_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pf {
+
+/**
+ * A fixed-size pool of worker threads with work-stealing scheduling.
+ *
+ * Each worker owns a deque of tasks. Tasks submitted from within a worker are pushed onto that
+ * worker's own deque and popped LIFO, while idle workers steal from the opposite end of other
+ * workers' deques. This keeps recursive workloads (such as directory traversal) local and
+ * cache-friendly while still balancing uneven subtrees.
+ *
+ * If a task throws, the first exception is kept and rethrown from `wait()`, and all tasks that
+ * have not yet started are discarded.
+ */
+class task_pool {
+public:
+    using task = std::function<void()>;
+
+    /**
+     * Create a pool with the given number of workers. Zero means `default_concurrency()`.
+     */
+    explicit task_pool(unsigned n_workers = 0);
+    ~task_pool();
+
+    task_pool(const task_pool&) = delete;
+    task_pool& operator=(const task_pool&) = delete;
+
+    /**
+     * Queue a task for execution. May be called from within a running task.
+     */
+    void submit(task t);
+
+    /**
+     * Block until every submitted task (including tasks submitted by other tasks) has finished.
+     * Rethrows the first exception thrown by a task, if any.
+     */
+    void wait();
+
+    /// The number of worker threads in the pool
+    unsigned size() const noexcept { return static_cast<unsigned>(_workers.size()); }
+
+    /**
+     * The index of the calling thread within this pool, in `[0, size())`. Returns `size()` if
+     * the calling thread is not one of this pool's workers.
+     */
+    std::size_t this_worker_index() const noexcept;
+
+    /// The number of workers to use when none is specified
+    static unsigned default_concurrency() noexcept;
+
+private:
+    struct worker {
+        std::mutex       mutex;
+        std::deque<task> tasks;
+        std::thread      thread;
+    };
+
+    std::vector<std::unique_ptr<worker>> _workers;
+    std::atomic<std::size_t>             _next_victim{0};
+    std::atomic<std::size_t>             _queued{0};
+    std::atomic<std::size_t>             _pending{0};
+    std::atomic<bool>                    _failed{false};
+    std::atomic<bool>                    _stop{false};
+
+    std::mutex              _sleep_mutex;
+    std::condition_variable _sleep_cv;
+    std::mutex              _done_mutex;
+    std::condition_variable _done_cv;
+    std::exception_ptr      _error;
+
+    bool _try_pop(std::size_t index, task& out);
+    bool _try_steal(std::size_t thief, task& out);
+    void _run_worker(std::size_t index);
+    void _run_task(task& t);
+};
+
+}  // namespace pf
+
+#endif  // PF_UTIL_TASK_POOL_HPP_INCLUDED
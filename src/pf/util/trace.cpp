@@ -0,0 +1,161 @@
+#include "./trace.hpp"
+
+#include <pf/util/json.hpp>
+
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <vector>
+
+using std::chrono::steady_clock;
+
+std::atomic<bool> pf::trace::detail::enabled{false};
+
+namespace {
+
+struct event {
+    const char*                       name;
+    std::string                       detail;
+    steady_clock::time_point          start;
+    steady_clock::time_point          end;
+    pf::trace::detail::counter_values deltas;
+};
+
+// Each thread records into its own buffer, so threads only contend when the trace is written
+struct thread_buffer {
+    std::mutex         mutex;
+    std::vector<event> events;
+    std::size_t        tid = 0;
+};
+
+constexpr const char* CounterNames[pf::trace::counter_count] = {
+    "directories_visited",
+    "entries_examined",
+    "bytes_read",
+    "bytes_written",
+};
+
+std::atomic<std::int64_t> counters[pf::trace::counter_count];
+
+// Guards the members below. Buffers outlive their threads, so events of finished threads are kept.
+std::mutex                                  buffers_mutex;
+std::vector<std::shared_ptr<thread_buffer>> buffers;
+steady_clock::time_point                    epoch;
+
+thread_local std::shared_ptr<thread_buffer> tl_buffer;
+
+thread_buffer& this_thread_buffer() {
+    if (!tl_buffer) {
+        std::lock_guard lk{buffers_mutex};
+        tl_buffer      = std::make_shared<thread_buffer>();
+        tl_buffer->tid = buffers.size();
+        buffers.push_back(tl_buffer);
+    }
+    return *tl_buffer;
+}
+
+}  // namespace
+
+pf::trace::detail::counter_values pf::trace::detail::now_counters() noexcept {
+    counter_values ret;
+    for (auto i = 0u; i < counter_count; ++i) {
+        ret[i] = ::counters[i].load(std::memory_order_relaxed);
+    }
+    return ret;
+}
+
+void pf::trace::detail::add(counter c, std::int64_t n) noexcept {
+    ::counters[static_cast<unsigned>(c)].fetch_add(n, std::memory_order_relaxed);
+}
+
+void pf::trace::detail::record(const char*                           name,
+                               std::string&&                         detail,
+                               std::chrono::steady_clock::time_point start,
+                               counter_values const&                 counters_at_start) {
+    auto const     end    = steady_clock::now();
+    counter_values deltas = now_counters();
+    for (auto i = 0u; i < counter_count; ++i) {
+        deltas[i] -= counters_at_start[i];
+    }
+
+    auto&           buffer = ::this_thread_buffer();
+    std::lock_guard lk{buffer.mutex};
+    buffer.events.push_back(event{name, std::move(detail), start, end, deltas});
+}
+
+void pf::trace::start() {
+    std::lock_guard lk{buffers_mutex};
+    for (auto& buffer : buffers) {
+        std::lock_guard buffer_lk{buffer->mutex};
+        buffer->events.clear();
+    }
+    for (auto& value : ::counters) {
+        value = 0;
+    }
+    epoch = steady_clock::now();
+    detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+void pf::trace::write_json(std::ostream& out) {
+    detail::enabled.store(false, std::memory_order_relaxed);
+    auto const end = steady_clock::now();
+
+    // Timestamps are in microseconds since the trace was started
+    auto const micros = [](steady_clock::duration d) {
+        return std::chrono::duration<double, std::micro>{d}.count();
+    };
+
+    std::lock_guard lk{buffers_mutex};
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto next  = [&]() -> std::ostream& {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        return out;
+    };
+
+    for (auto& buffer : buffers) {
+        std::lock_guard buffer_lk{buffer->mutex};
+        if (buffer->events.empty()) {
+            continue;
+        }
+        next() << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << buffer->tid
+               << R"(,"args":{"name":"thread )" << buffer->tid << "\"}}";
+        for (auto const& ev : buffer->events) {
+            next() << R"({"name":)" << pf::json_quote(ev.name) << R"(,"cat":"pf","ph":"X")"
+                   << R"(,"pid":1,"tid":)" << buffer->tid << R"(,"ts":)" << micros(ev.start - epoch)
+                   << R"(,"dur":)" << micros(ev.end - ev.start) << R"(,"args":{)";
+            bool first_arg = true;
+            if (!ev.detail.empty()) {
+                out << R"("detail":)" << pf::json_quote(ev.detail);
+                first_arg = false;
+            }
+            for (auto i = 0u; i < counter_count; ++i) {
+                if (ev.deltas[i] != 0) {
+                    out << (first_arg ? "\"" : ",\"") << CounterNames[i] << "\":" << ev.deltas[i];
+                    first_arg = false;
+                }
+            }
+            out << "}}";
+        }
+    }
+
+    // The totals, as counter tracks running from the start of the trace to its end
+    for (auto i = 0u; i < counter_count; ++i) {
+        for (auto [ts, value] : {std::pair{0.0, std::int64_t{0}},
+                                 std::pair{micros(end - epoch), ::counters[i].load()}}) {
+            next() << R"({"name":")" << CounterNames[i] << R"(","ph":"C","pid":1,"ts":)" << ts
+                   << R"(,"args":{"value":)" << value << "}}";
+        }
+    }
+    out << "\n]}\n";
+}
+
+void pf::trace::save(const fs::path& file, std::error_code& ec) {
+    std::ostringstream out;
+    write_json(out);
+    pf::write_file(file, out.str(), write_mode::overwrite, ec);
+}
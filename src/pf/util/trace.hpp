@@ -0,0 +1,121 @@
+#ifndef PF_UTIL_TRACE_HPP_INCLUDED
+#define PF_UTIL_TRACE_HPP_INCLUDED
+
+#include <pf/fs/core.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+/**
+ * Records where time goes as spans and counters, which can be written as Chrome trace-event JSON
+ * (viewable in chrome://tracing or https://ui.perfetto.dev).
+ *
+ * Nothing is recorded unless tracing has been started. Until then, a span costs a single relaxed
+ * atomic load when it is created, and adding to a counter costs the same.
+ */
+namespace pf::trace {
+
+enum class counter : unsigned {
+    directories_visited,
+    entries_examined,
+    bytes_read,
+    bytes_written,
+};
+
+constexpr std::size_t counter_count = 4;
+
+namespace detail {
+
+extern std::atomic<bool> enabled;
+
+using counter_values = std::array<std::int64_t, counter_count>;
+
+counter_values now_counters() noexcept;
+void           add(counter c, std::int64_t n) noexcept;
+void           record(const char*                           name,
+                      std::string&&                         detail,
+                      std::chrono::steady_clock::time_point start,
+                      counter_values const&                 counters_at_start);
+
+}  // namespace detail
+
+/// `true` if events are being recorded
+inline bool enabled() noexcept { return detail::enabled.load(std::memory_order_relaxed); }
+
+/// Begin recording events. Events recorded by a previous trace are discarded.
+void start();
+
+/// Stop recording, and write the events as Chrome trace-event JSON
+void write_json(std::ostream& out);
+
+/**
+ * Stop recording, and write the events to `file` as with `write_json`. Fills out `ec` if the
+ * file cannot be written.
+ */
+void save(const fs::path& file, std::error_code& ec);
+
+/// Add `n` to the given counter
+inline void add(counter c, std::int64_t n) noexcept {
+    if (enabled()) {
+        detail::add(c, n);
+    }
+}
+
+/**
+ * Records the time between its construction and destruction as a span named `name`, which must
+ * be a string literal. The span also records how much each counter grew in the meantime, which
+ * includes the work of other threads during the span.
+ */
+class span {
+    const char*                           _name = nullptr;
+    std::string                           _detail;
+    std::chrono::steady_clock::time_point _start;
+    detail::counter_values                _counters{};
+
+public:
+    explicit span(const char* name) noexcept {
+        if (enabled()) {
+            _begin(name);
+        }
+    }
+
+    /// `detail` (a string or a path) is shown with the span. It is only copied while tracing.
+    template <typename Detail>
+    span(const char* name, const Detail& detail) {
+        if (enabled()) {
+            if constexpr (std::is_convertible_v<const Detail&, std::string_view>) {
+                _detail.assign(std::string_view{detail});
+            } else {
+                _detail = detail.string();
+            }
+            _begin(name);
+        }
+    }
+
+    ~span() {
+        if (_name) {
+            detail::record(_name, std::move(_detail), _start, _counters);
+        }
+    }
+
+    span(const span&) = delete;
+    span& operator=(const span&) = delete;
+
+private:
+    void _begin(const char* name) noexcept {
+        _name     = name;
+        _counters = detail::now_counters();
+        _start    = std::chrono::steady_clock::now();
+    }
+};
+
+}  // namespace pf::trace
+
+#endif  // PF_UTIL_TRACE_HPP_INCLUDED
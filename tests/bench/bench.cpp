@@ -0,0 +1,189 @@
+#include "./bench.hpp"
+
+#include <pf/fs/glob.hpp>
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+namespace fs = pf::fs;
+
+using pf::bench::seconds;
+
+namespace {
+
+// Calls faster than this are timed in batches
+constexpr seconds MinSampleTime{1e-3};
+
+// Spread the files over the leaves below `dir`, with file `i` going to leaf `i % n_leaves`
+void create_tree(fs::path const& dir, pf::bench::tree_shape const& shape, int depth, int& leaf) {
+    if (depth == 0) {
+        auto const n_leaves = static_cast<int>(std::pow(shape.fan_out, shape.depth));
+        for (auto i = leaf; i < shape.files; i += n_leaves) {
+            constexpr const char* exts[] = {".cpp", ".hpp", ".txt"};
+            pf::write_file(dir / ("file" + std::to_string(i) + exts[i % 3]), "");
+        }
+        ++leaf;
+        return;
+    }
+    for (auto i = 0; i < shape.fan_out; ++i) {
+        create_tree(dir / ("dir" + std::to_string(i)), shape, depth - 1, leaf);
+    }
+}
+
+}  // namespace
+
+std::vector<std::pair<std::string, pf::bench::bench_fn>>& pf::bench::registry() {
+    static std::vector<std::pair<std::string, bench_fn>> benchmarks;
+    return benchmarks;
+}
+
+std::string pf::bench::format_duration(seconds time) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    auto const s = time.count();
+    if (s < 1e-6) {
+        out << s * 1e9 << " ns";
+    } else if (s < 1e-3) {
+        out << s * 1e6 << " us";
+    } else if (s < 1) {
+        out << s * 1e3 << " ms";
+    } else {
+        out << s << " s";
+    }
+    return out.str();
+}
+
+fs::path pf::bench::scratch_dir(std::string_view name) {
+    auto dir = fs::path{PF_TEST_BINDIR} / "_bench" / fs::path{name};
+    fs::create_directories(dir);
+    return dir;
+}
+
+std::string pf::bench::tree_shape::describe() const {
+    return std::to_string(files) + " files, depth " + std::to_string(depth) + ", fan-out "
+        + std::to_string(fan_out) + ", " + std::to_string(cmakelists_lines) + " CMake lines";
+}
+
+std::string pf::bench::synthetic_cmakelists(std::vector<std::string> const& sources,
+                                            int                             filler_lines) {
+    std::string ret = "add_library(lib\n    # sources\n";
+    for (auto const& source : sources) {
+        ret += "    " + source + "\n";
+    }
+    ret += "    )\n";
+    for (auto i = 0; i < filler_lines / 2; ++i) {
+        ret += "# A comment with (unbalanced parens\n";
+        ret += "set(var" + std::to_string(i) + " \"value ) with parens\")\n";
+    }
+    return ret;
+}
+
+fs::path pf::bench::synthetic_project(tree_shape const& shape) {
+    auto const root  = scratch_dir("project");
+    auto const stamp = root / "shape.txt";
+
+    std::error_code ec;
+    if (fs::exists(stamp) && pf::slurp_file(stamp, ec) == shape.describe()) {
+        return root;
+    }
+
+    std::cout << "Generating a project of " << shape.describe() << " in " << root.string()
+              << '\n';
+    fs::remove_all(root);
+    auto const src_dir = root / "src";
+    auto       leaf    = 0;
+    ::create_tree(src_dir, shape, shape.depth, leaf);
+
+    std::vector<std::string> sources;
+    for (auto const& source : pf::glob_sources(src_dir)) {
+        sources.push_back(fs::relative(source, src_dir).generic_string());
+    }
+    pf::write_file(src_dir / "CMakeLists.txt",
+                   synthetic_cmakelists(sources, shape.cmakelists_lines));
+    pf::write_file(root / "CMakeLists.txt",
+                   "cmake_minimum_required(VERSION 3.12)\n"
+                   "project(bench)\n"
+                   "add_subdirectory(src)\n");
+    // Written last, so an interrupted generation is started again next time
+    pf::write_file(stamp, shape.describe());
+    return root;
+}
+
+pf::bench::result pf::bench::summarize(std::string          name,
+                                       std::vector<seconds> samples,
+                                       std::size_t          batch) {
+    std::sort(samples.begin(), samples.end());
+    auto const n = samples.size();
+
+    result ret;
+    ret.name    = std::move(name);
+    ret.samples = n;
+    ret.batch   = batch;
+    ret.min     = samples.front();
+    ret.max     = samples.back();
+    ret.median  = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    ret.mean    = std::accumulate(samples.begin(), samples.end(), seconds{}) / n;
+    if (n > 1) {
+        double sum_sq = 0;
+        for (auto s : samples) {
+            sum_sq += (s - ret.mean).count() * (s - ret.mean).count();
+        }
+        ret.stddev = seconds{std::sqrt(sum_sq / (n - 1))};
+    }
+    return ret;
+}
+
+pf::bench::result pf::bench::context::_run(std::string const&           name,
+                                           std::function<void()> const& setup,
+                                           std::function<void()> const& fn) {
+    // Warming up also tells us roughly how long a single call takes
+    auto single = seconds::max();
+    for (auto i = 0; i < _opts.warmup; ++i) {
+        if (setup) {
+            setup();
+        }
+        auto const start = clock::now();
+        fn();
+        single = std::min(single, seconds{clock::now() - start});
+    }
+
+    // Calls that need a setup each time cannot be batched
+    std::size_t batch = 1;
+    if (!setup && single < MinSampleTime) {
+        batch = static_cast<std::size_t>(MinSampleTime / std::max(single, seconds{1e-9}));
+    }
+
+    std::vector<seconds> samples;
+    auto const           start = clock::now();
+    while (samples.size() < static_cast<std::size_t>(_opts.max_samples)
+           && (samples.size() < static_cast<std::size_t>(_opts.min_samples)
+               || clock::now() - start < _opts.min_time)) {
+        if (setup) {
+            setup();
+        }
+        auto const sample_start = clock::now();
+        for (auto i = 0u; i < batch; ++i) {
+            fn();
+        }
+        samples.push_back(seconds{clock::now() - sample_start} / batch);
+    }
+    return summarize(name, std::move(samples), batch);
+}
+
+void pf::bench::context::measure(std::string const&           name,
+                                 std::function<void()> const& setup,
+                                 std::function<void()> const& fn) {
+    auto res = _run(name, setup, fn);
+    std::cout << "  " << std::left << std::setw(40) << res.name << std::right << std::setw(10)
+              << format_duration(res.median) << "  (min " << format_duration(res.min)
+              << ", mean " << format_duration(res.mean) << " +/- "
+              << format_duration(res.stddev) << ", " << res.samples << " samples";
+    if (res.batch > 1) {
+        std::cout << " of " << res.batch;
+    }
+    std::cout << ")\n";
+    _results.push_back(std::move(res));
+}
@@ -0,0 +1,137 @@
+#ifndef PF_BENCH_BENCH_HPP_INCLUDED
+#define PF_BENCH_BENCH_HPP_INCLUDED
+
+#include <pf/fs.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace pf::bench {
+
+using clock   = std::chrono::steady_clock;
+using seconds = std::chrono::duration<double>;
+
+/// Format a duration with a unit suited to its magnitude, such as "12.34 ms"
+std::string format_duration(seconds time);
+
+/**
+ * Get a scratch directory for the named benchmark. The directory is not cleared, so benchmarks
+ * may reuse expensive fixtures between runs.
+ */
+fs::path scratch_dir(std::string_view name);
+
+/**
+ * The shape of a synthetic Pitchfork project, as made by `synthetic_project`.
+ */
+struct tree_shape {
+    /// The number of files below src/, spread evenly over the leaf directories
+    int files = 20'480;
+    /// The number of directory levels below src/
+    int depth = 3;
+    /// The number of subdirectories of each non-leaf directory
+    int fan_out = 8;
+    /// The number of lines of other code in src/CMakeLists.txt, besides the source list
+    int cmakelists_lines = 50'000;
+
+    /// A short description, such as "20480 files, depth 3, fan-out 8, 50000 CMake lines"
+    std::string describe() const;
+};
+
+/**
+ * Get the root of a synthetic project of the given shape. Two thirds of the files are sources,
+ * and src/CMakeLists.txt lists them all. The project is generated within `scratch_dir` on first
+ * use, and regenerated only if the shape changes.
+ */
+fs::path synthetic_project(tree_shape const& shape);
+
+/**
+ * The contents of a src/CMakeLists.txt with a single source list of `sources`, followed by
+ * `filler_lines` lines of other code (including parentheses in comments and strings).
+ */
+std::string synthetic_cmakelists(std::vector<std::string> const& sources, int filler_lines);
+
+struct run_options {
+    /// Untimed runs before measuring, also used to choose the batch size
+    int warmup = 2;
+    /// Take at least this many samples, and keep sampling until `min_time` has passed
+    int     min_samples = 5;
+    seconds min_time{0.25};
+    /// Never take more than this many samples
+    int max_samples = 1000;
+};
+
+/// Statistics of the duration of a single call, over all samples
+struct result {
+    std::string name;
+    std::size_t samples = 0;
+    // The number of calls timed together in each sample
+    std::size_t batch = 1;
+    seconds     min{};
+    seconds     median{};
+    seconds     mean{};
+    seconds     stddev{};
+    seconds     max{};
+};
+
+/**
+ * Summarize the durations of a single call. `samples` must not be empty.
+ */
+result summarize(std::string name, std::vector<seconds> samples, std::size_t batch);
+
+/**
+ * Passed to each benchmark to measure the operations it is interested in.
+ */
+class context {
+    tree_shape          _shape;
+    run_options         _opts;
+    std::vector<result> _results;
+
+    result _run(std::string const&           name,
+                std::function<void()> const& setup,
+                std::function<void()> const& fn);
+
+public:
+    context(tree_shape shape, run_options opts)
+        : _shape(shape)
+        , _opts(opts) {}
+
+    tree_shape const& shape() const noexcept { return _shape; }
+
+    /**
+     * Time `fn` and record the results under `name`. Calls that are much faster than a
+     * millisecond are timed in batches, so the overhead of reading the clock does not skew the
+     * results.
+     */
+    void measure(std::string const& name, std::function<void()> const& fn) {
+        measure(name, nullptr, fn);
+    }
+
+    /// As above, but call `setup` before each call to `fn`, without timing it
+    void measure(std::string const&           name,
+                 std::function<void()> const& setup,
+                 std::function<void()> const& fn);
+
+    std::vector<result> const& results() const noexcept { return _results; }
+};
+
+using bench_fn = void (*)(context&);
+
+std::vector<std::pair<std::string, bench_fn>>& registry();
+
+struct registration {
+    registration(std::string name, bench_fn fn) { registry().emplace_back(std::move(name), fn); }
+};
+
+}  // namespace pf::bench
+
+#define PF_BENCHMARK(name)                                                                         \
+    static void                             name(::pf::bench::context&);                           \
+    static const ::pf::bench::registration name##_registration{#name, &name};                     \
+    static void                             name(::pf::bench::context& ctx)
+
+#endif  // PF_BENCH_BENCH_HPP_INCLUDED
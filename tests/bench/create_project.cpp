@@ -0,0 +1,71 @@
+#include "./bench.hpp"
+
+#include <pf/new.hpp>
+
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace fs = pf::fs;
+
+namespace {
+
+std::string synthetic_manifest(int n_projects) {
+    std::string ret = "name,namespace,split_headers,build_system\n";
+    for (auto i = 0; i < n_projects; ++i) {
+        auto const name = "service-" + std::to_string(i);
+        ret += name + ",acme::service" + std::to_string(i) + "," + (i % 2 ? "yes" : "no")
+            + ",cmake\n";
+    }
+    return ret;
+}
+
+// Time creating `n` projects in `dir` from a manifest, as `pf new --from-manifest` does
+void measure_many(pf::bench::context& ctx, fs::path const& dir, int n) {
+    auto const                          name = "create_projects/" + std::to_string(n);
+    std::vector<pf::new_project_params> all;
+    for (auto& entry : pf::parse_csv_manifest(synthetic_manifest(n), dir)) {
+        if (!entry.params) {
+            throw std::runtime_error(name + ": " + entry.error);
+        }
+        all.push_back(std::move(*entry.params));
+    }
+    ctx.measure(
+        name,
+        [&] { fs::remove_all(dir); },
+        [&] {
+            for (auto const& error : pf::create_projects(all)) {
+                if (!error.empty()) {
+                    throw std::runtime_error(name + ": " + error);
+                }
+            }
+        });
+    fs::remove_all(dir);
+    std::cout << name << ": " << std::fixed << std::setprecision(0)
+              << n / ctx.results().back().median.count() << " projects/s\n";
+}
+
+}  // namespace
+
+PF_BENCHMARK(create_project) {
+    auto const base = pf::bench::scratch_dir("create_project");
+
+    pf::new_project_params params{"bench-project",
+                                  "acme::bench",
+                                  "bench-project",
+                                  base / "bench-project"};
+    params.build_system     = pf::build_system::cmake;
+    params.create_examples  = true;
+    params.create_extras    = true;
+    params.separate_headers = true;
+    ctx.measure(
+        "create_project",
+        [&] { fs::remove_all(params.directory); },
+        [&] { pf::create_project(params); });
+
+    std::cout << "Using " << pf::task_pool::default_concurrency() << " threads\n";
+    for (auto n : {1'000, 10'000}) {
+        ::measure_many(ctx, base / "many", n);
+    }
+    fs::remove_all(base);
+}
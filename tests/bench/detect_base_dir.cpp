@@ -0,0 +1,27 @@
+#include "./bench.hpp"
+
+#include <pf/existing/detect_base_dir.hpp>
+
+namespace fs = pf::fs;
+
+PF_BENCHMARK(detect_base_dir) {
+    auto const root = pf::bench::synthetic_project(ctx.shape());
+
+    auto deepest = root / "src";
+    for (auto i = 0; i < ctx.shape().depth; ++i) {
+        deepest /= "dir0";
+    }
+    ctx.measure("detect_base_dir/project_root", [&] { pf::detect_base_dir(root); });
+    ctx.measure("detect_base_dir/deepest", [&] { pf::detect_base_dir(deepest); });
+
+    // A build directory outside of the project, which must be resolved through its CMake cache
+    auto const  build_dir = pf::bench::scratch_dir("detect_base_dir") / "build";
+    std::string cache     = "# A cache of typical size\n";
+    for (auto i = 0; i < 500; ++i) {
+        cache += "SOME_VARIABLE_" + std::to_string(i) + ":STRING=some value\n";
+    }
+    cache += "CMAKE_HOME_DIRECTORY:INTERNAL=" + root.string() + "\n";
+    fs::create_directories(build_dir / "CMakeFiles");
+    pf::write_file(build_dir / "CMakeCache.txt", cache, pf::write_mode::atomic_if_changed);
+    ctx.measure("detect_base_dir/build_dir", [&] { pf::detect_base_dir(build_dir); });
+}
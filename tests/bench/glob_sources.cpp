@@ -0,0 +1,46 @@
+#include "./bench.hpp"
+
+#include <pf/fs/dir_reader.hpp>
+#include <pf/fs/glob.hpp>
+#include <pf/fs/source_index.hpp>
+#include <pf/util/task_pool.hpp>
+
+#include <iostream>
+
+namespace fs = pf::fs;
+
+PF_BENCHMARK(glob_sources) {
+    auto const root    = pf::bench::synthetic_project(ctx.shape());
+    auto const src_dir = root / "src";
+    std::cout << "Found " << pf::glob_sources(src_dir).size() << " sources\n";
+
+    for (auto jobs = 1u;; jobs *= 2) {
+        jobs = std::min(jobs, pf::task_pool::default_concurrency());
+
+        pf::glob_options opts;
+        opts.jobs = jobs;
+        ctx.measure("glob_sources/jobs=" + std::to_string(jobs),
+                    [&] { pf::glob_sources(src_dir, opts); });
+        if (pf::dir_reader::supported) {
+            // For comparison. Try --files=1000000 to see the difference on a large tree.
+            opts.use_std_filesystem = true;
+            ctx.measure("glob_sources/std_filesystem/jobs=" + std::to_string(jobs),
+                        [&] { pf::glob_sources(src_dir, opts); });
+        }
+
+        if (jobs == pf::task_pool::default_concurrency()) {
+            break;
+        }
+    }
+
+    // With an up-to-date index, as for a repeated `pf update`
+    auto const index_file = pf::bench::scratch_dir("glob_sources") / "index";
+    {
+        pf::source_index index{root};
+        index.glob_sources(src_dir);
+        index.save(index_file);
+    }
+    ctx.measure("glob_sources/index", [&] {
+        pf::source_index::load(root, index_file).glob_sources(src_dir);
+    });
+}
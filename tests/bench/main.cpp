@@ -0,0 +1,217 @@
+#include "./bench.hpp"
+
+#include <pf/util/json.hpp>
+
+#include <args.hxx>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace fs = pf::fs;
+
+namespace {
+
+std::string results_json(pf::bench::tree_shape const&          shape,
+                         std::vector<pf::bench::result> const& results) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    auto const ns = [](pf::bench::seconds time) { return time.count() * 1e9; };
+
+    out << "{\n  \"shape\": {\"files\": " << shape.files << ", \"depth\": " << shape.depth
+        << ", \"fan_out\": " << shape.fan_out
+        << ", \"cmakelists_lines\": " << shape.cmakelists_lines << "},\n";
+    out << "  \"benchmarks\": [";
+    for (auto const& res : results) {
+        out << (&res == &results.front() ? "\n" : ",\n");
+        out << "    {\"name\": " << pf::json_quote(res.name) << ", \"samples\": " << res.samples
+            << ", \"batch\": " << res.batch << ", \"min_ns\": " << ns(res.min)
+            << ", \"median_ns\": " << ns(res.median) << ", \"mean_ns\": " << ns(res.mean)
+            << ", \"stddev_ns\": " << ns(res.stddev) << ", \"max_ns\": " << ns(res.max) << "}";
+    }
+    out << "\n  ]\n}\n";
+    return out.str();
+}
+
+/**
+ * Compare the medians of `results` with those recorded in `baseline_file`, and return the number
+ * that are more than `threshold` (a fraction) slower.
+ */
+int compare(fs::path const&                       baseline_file,
+            pf::bench::tree_shape const&          shape,
+            std::vector<pf::bench::result> const& results,
+            double                                threshold) {
+    namespace pt = boost::property_tree;
+
+    pt::ptree baseline;
+    pt::read_json(baseline_file.string(), baseline);
+
+    pf::bench::tree_shape baseline_shape;
+    baseline_shape.files            = baseline.get<int>("shape.files");
+    baseline_shape.depth            = baseline.get<int>("shape.depth");
+    baseline_shape.fan_out          = baseline.get<int>("shape.fan_out");
+    baseline_shape.cmakelists_lines = baseline.get<int>("shape.cmakelists_lines");
+    if (baseline_shape.describe() != shape.describe()) {
+        std::cout << "WARNING: The baseline was measured with a different project ("
+                  << baseline_shape.describe() << ")\n";
+    }
+
+    std::map<std::string, pf::bench::seconds> medians;
+    for (auto const& [key, bench] : baseline.get_child("benchmarks")) {
+        medians[bench.get<std::string>("name")]
+            = pf::bench::seconds{bench.get<double>("median_ns") / 1e9};
+    }
+
+    std::cout << "\nCompared to " << baseline_file.string() << " (threshold +"
+              << threshold * 100 << "%):\n";
+    int n_regressed = 0;
+    for (auto const& res : results) {
+        std::cout << "  " << std::left << std::setw(40) << res.name << std::right;
+        auto const found = medians.find(res.name);
+        if (found == medians.end()) {
+            std::cout << "(not in the baseline)\n";
+            continue;
+        }
+        auto const change = res.median / found->second - 1;
+        std::cout << std::setw(10) << pf::bench::format_duration(found->second) << " -> "
+                  << std::setw(10) << pf::bench::format_duration(res.median) << "  "
+                  << std::showpos << std::fixed << std::setprecision(1) << change * 100
+                  << std::noshowpos << '%';
+        if (change > threshold) {
+            std::cout << "  REGRESSION";
+            ++n_regressed;
+        }
+        std::cout << '\n';
+    }
+    if (n_regressed != 0) {
+        std::cout << n_regressed << " benchmark(s) regressed\n";
+    }
+    return n_regressed;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    pf::bench::tree_shape  shape;
+    pf::bench::run_options opts;
+
+    args::ArgumentParser parser{"Benchmarks for Pitchfork"};
+    args::HelpFlag       help{parser, "help", "Print this help message", {'h', "help"}};
+    args::Flag           list{parser, "list", "List the benchmarks, and exit", {"list"}};
+    args::PositionalList<std::string> selected{parser,
+                                               "benchmark",
+                                               "Only run these benchmarks (Default: all)"};
+
+    args::Group          shape_group{parser, "Shape of the synthetic project:"};
+    args::ValueFlag<int> files{shape_group, "n", "Files below src/", {"files"}, shape.files};
+    args::ValueFlag<int> depth{shape_group,
+                               "n",
+                               "Directory levels below src/",
+                               {"depth"},
+                               shape.depth};
+    args::ValueFlag<int> fan_out{shape_group,
+                                 "n",
+                                 "Subdirectories per directory",
+                                 {"fan-out"},
+                                 shape.fan_out};
+    args::ValueFlag<int> cmakelists_lines{shape_group,
+                                          "n",
+                                          "Lines of other code in src/CMakeLists.txt",
+                                          {"cmakelists-lines"},
+                                          shape.cmakelists_lines};
+
+    args::Group             run_group{parser, "Measurement:"};
+    args::ValueFlag<int>    warmup{run_group, "n", "Untimed warmup runs", {"warmup"}, opts.warmup};
+    args::ValueFlag<int>    samples{run_group,
+                                 "n",
+                                 "Minimum number of samples",
+                                 {"samples"},
+                                 opts.min_samples};
+    args::ValueFlag<double> min_time{run_group,
+                                     "seconds",
+                                     "Keep sampling each benchmark for at least this long",
+                                     {"min-time"},
+                                     opts.min_time.count()};
+
+    args::Group               output_group{parser, "Output:"};
+    args::ValueFlag<fs::path> json{output_group, "file", "Write the results as JSON", {"json"}};
+    args::ValueFlag<fs::path> baseline{output_group,
+                                       "file",
+                                       "Compare with the results in this JSON file, and fail if "
+                                       "any benchmark regressed",
+                                       {"baseline"}};
+    args::ValueFlag<double>   threshold{output_group,
+                                        "percent",
+                                        "How much slower a median may be than in the baseline "
+                                        "before it counts as a regression",
+                                        {"threshold"},
+                                        10};
+
+    try {
+        parser.ParseCLI(argc, argv);
+    } catch (args::Help const&) {
+        std::cout << parser;
+        return 0;
+    } catch (args::Error const& e) {
+        std::cerr << e.what() << '\n' << parser;
+        return 1;
+    }
+
+    if (list) {
+        for (auto& [name, fn] : pf::bench::registry()) {
+            std::cout << name << '\n';
+        }
+        return 0;
+    }
+
+    shape.files            = files.Get();
+    shape.depth            = depth.Get();
+    shape.fan_out          = fan_out.Get();
+    shape.cmakelists_lines = cmakelists_lines.Get();
+    if (shape.files < 1 || shape.depth < 1 || shape.fan_out < 1 || shape.cmakelists_lines < 0) {
+        std::cerr << "The project needs at least one file, directory level, and subdirectory\n";
+        return 1;
+    }
+    opts.warmup      = warmup.Get();
+    opts.min_samples = std::max(samples.Get(), 1);
+    opts.min_time    = pf::bench::seconds{min_time.Get()};
+
+    pf::bench::context ctx{shape, opts};
+    int                n_run = 0;
+    for (auto& [name, fn] : pf::bench::registry()) {
+        auto const& names = selected.Get();
+        if (!names.empty() && std::find(names.begin(), names.end(), name) == names.end()) {
+            continue;
+        }
+        std::cout << "== " << name << '\n';
+        fn(ctx);
+        ++n_run;
+    }
+
+    if (n_run == 0) {
+        std::cerr << "No benchmarks matched. Available benchmarks:\n";
+        for (auto& [name, fn] : pf::bench::registry()) {
+            std::cerr << "  " << name << '\n';
+        }
+        return 1;
+    }
+
+    if (json) {
+        pf::write_file(json.Get(), ::results_json(shape, ctx.results()));
+    }
+    if (!baseline) {
+        return 0;
+    }
+    try {
+        return ::compare(baseline.Get(), shape, ctx.results(), threshold.Get() / 100) == 0 ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to read the baseline " << baseline.Get().string() << ": " << e.what()
+                  << '\n';
+        return 1;
+    }
+}
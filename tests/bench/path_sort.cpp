@@ -0,0 +1,27 @@
+#include "./bench.hpp"
+
+#include <pf/fs/glob.hpp>
+#include <pf/fs/path_sort.hpp>
+#include <pf/util/task_pool.hpp>
+
+#include <algorithm>
+#include <random>
+
+namespace fs = pf::fs;
+
+PF_BENCHMARK(path_sort) {
+    auto const src_dir = pf::bench::synthetic_project(ctx.shape()) / "src";
+
+    auto       sources  = pf::glob_sources(src_dir);
+    auto const shuffled = [&] {
+        std::mt19937 rng{42};
+        std::shuffle(sources.begin(), sources.end(), rng);
+    };
+    pf::task_pool pool;
+
+    ctx.measure("path_sort/std_sort", shuffled, [&] { std::sort(sources.begin(), sources.end()); });
+    ctx.measure("path_sort/radix", shuffled, [&] { pf::sort_paths(sources, src_dir); });
+    ctx.measure("path_sort/radix_parallel", shuffled, [&] {
+        pf::sort_paths(sources, src_dir, &pool);
+    });
+}
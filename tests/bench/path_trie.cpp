@@ -0,0 +1,81 @@
+#include "./bench.hpp"
+
+#include <pf/fs/glob.hpp>
+#include <pf/fs/path_trie.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+namespace fs = pf::fs;
+
+namespace {
+
+// The heap a string holds beyond the object itself, if it is too long to be stored inline
+template <typename String>
+std::size_t heap_size(String const& str) {
+    return str.capacity() > String{}.capacity() ? (str.capacity() + 1) * sizeof(str[0]) : 0;
+}
+
+// How sources were made relative before path_trie, for comparison
+std::vector<std::string> relative_strings(std::vector<fs::path> const& sources,
+                                          fs::path const&              base_dir) {
+    std::vector<std::string> ret;
+    ret.reserve(sources.size());
+    for (auto const& path : sources) {
+        auto result = fs::relative(path, base_dir).string();
+        std::replace(result.begin(), result.end(), '\\', '/');
+        ret.push_back(std::move(result));
+    }
+    return ret;
+}
+
+}  // namespace
+
+PF_BENCHMARK(path_trie) {
+    auto const src_dir = pf::bench::synthetic_project(ctx.shape()) / "src";
+
+    auto const sources  = pf::glob_sources(src_dir);
+    auto const relative = relative_strings(sources, src_dir);
+    auto       vector_bytes
+        = sources.capacity() * sizeof(fs::path) + relative.capacity() * sizeof(std::string);
+    for (auto const& path : sources) {
+        vector_bytes += heap_size(path.native());
+    }
+    for (auto const& str : relative) {
+        vector_bytes += heap_size(str);
+    }
+
+    pf::path_trie trie;
+    pf::glob_sources(src_dir, pf::glob_options{}, trie);
+    std::cout << sources.size() << " sources take " << vector_bytes / 1024
+              << " KiB as paths and relative strings, and " << trie.memory_usage() / 1024
+              << " KiB in a trie\n";
+
+    std::size_t n_bytes = 0;
+    ctx.measure("path_trie/relative_strings", [&] {
+        n_bytes = 0;
+        for (auto const& str : relative_strings(sources, src_dir)) {
+            n_bytes += str.size();
+        }
+    });
+    ctx.measure("path_trie/for_each", [&] {
+        n_bytes = 0;
+        trie.for_each([&](std::string_view path) { n_bytes += path.size(); });
+    });
+    ctx.measure("path_trie/insert", [&] {
+        pf::path_trie copy;
+        for (auto const& str : relative) {
+            copy.insert(str);
+        }
+    });
+
+    // From the tree to the strings written to the CMakeLists.txt
+    ctx.measure("path_trie/glob+relative_strings", [&] {
+        relative_strings(pf::glob_sources(src_dir), src_dir);
+    });
+    ctx.measure("path_trie/glob+for_each", [&] {
+        pf::path_trie fresh;
+        pf::glob_sources(src_dir, pf::glob_options{}, fresh);
+        fresh.for_each([&](std::string_view path) { n_bytes += path.size(); });
+    });
+}
@@ -0,0 +1,29 @@
+#include "./bench.hpp"
+
+#include <pf/file_template.hpp>
+#include <pf/new/files.hpp>
+#include <pf/new/project.hpp>
+
+namespace fs = pf::fs;
+
+PF_BENCHMARK(render_templates) {
+    pf::new_project_params params{"bench-project",
+                                  "acme::bench",
+                                  "bench-project",
+                                  pf::bench::scratch_dir("render_templates") / "bench-project"};
+    params.build_system    = pf::build_system::cmake;
+    params.create_examples = true;
+
+    auto const            plan    = pf::plan_project(params);
+    auto const            context = pf::template_context_for(params);
+    pf::template_renderer renderer{params.directory, context};
+
+    ctx.measure("template_renderer/first_source",
+                [&] { renderer.render("base/first_source.in.cpp"); });
+    ctx.measure("template_renderer/project", [&] {
+        for (auto const& file : plan.files) {
+            renderer.render(file.template_path);
+        }
+    });
+    ctx.measure("template_context_for", [&] { pf::template_context_for(params); });
+}
@@ -0,0 +1,82 @@
+#include "./bench.hpp"
+
+#include <pf/fs/glob.hpp>
+#include <pf/fs/source_patterns.hpp>
+
+#include <iostream>
+#include <unordered_set>
+
+namespace fs = pf::fs;
+
+namespace {
+
+struct path_hash {
+    auto operator()(fs::path const& path) const { return fs::hash_value(path); }
+};
+
+// How sources were selected before source_patterns, for comparison
+std::unordered_set<fs::path, path_hash> const ExtensionSet{
+    ".c",
+    ".cc",
+    ".cpp",
+    ".cxx",
+    ".c++",
+    ".h",
+    ".hh",
+    ".hpp",
+    ".hxx",
+    ".h++",
+};
+
+}  // namespace
+
+PF_BENCHMARK(source_patterns) {
+    auto const root    = pf::bench::synthetic_project(ctx.shape());
+    auto const src_dir = root / "src";
+
+    std::vector<fs::path>    paths;
+    std::vector<std::string> relative;
+    for (auto const& entry : fs::recursive_directory_iterator{src_dir}) {
+        paths.push_back(entry.path());
+        relative.push_back(entry.path().lexically_relative(src_dir).generic_string());
+    }
+
+    auto const& defaults = pf::source_patterns::defaults();
+    // The kind of list a project's pitchfork.json might add
+    pf::source_patterns const custom{[&] {
+        auto globs = pf::source_patterns::default_globs();
+        globs.insert(globs.end(), {"*.cu", "*.ixx", "!**/generated/**", "!third_party/"});
+        return globs;
+    }()};
+
+    std::size_t n_selected = 0;
+    ctx.measure("source_patterns/extension_set", [&] {
+        n_selected = 0;
+        for (auto const& path : paths) {
+            n_selected += ExtensionSet.count(path.extension());
+        }
+    });
+    std::cout << "Extension set selected " << n_selected << " of " << paths.size() << " paths\n";
+
+    ctx.measure("source_patterns/defaults", [&] {
+        n_selected = 0;
+        for (auto const& path : relative) {
+            n_selected += defaults.matches(path);
+        }
+    });
+    std::cout << "Default patterns selected " << n_selected << " paths\n";
+
+    ctx.measure("source_patterns/custom", [&] {
+        n_selected = 0;
+        for (auto const& path : relative) {
+            n_selected += custom.matches(path);
+        }
+    });
+
+    ctx.measure("source_patterns/compile", [&] { pf::source_patterns{custom.globs()}; });
+
+    pf::glob_options opts;
+    opts.jobs     = 1;
+    opts.patterns = &custom;
+    ctx.measure("source_patterns/glob_sources", [&] { pf::glob_sources(src_dir, opts); });
+}
@@ -0,0 +1,63 @@
+#include "./bench.hpp"
+
+#include <pf/existing/update_source_files.hpp>
+#include <pf/fs/glob.hpp>
+#include <pf/fs/path_set.hpp>
+
+#include <iostream>
+
+namespace fs = pf::fs;
+
+PF_BENCHMARK(update_source_files) {
+    auto const src_dir    = pf::bench::synthetic_project(ctx.shape()) / "src";
+    auto const cmakelists = src_dir / "CMakeLists.txt";
+
+    auto const               sources = pf::glob_sources(src_dir);
+    std::vector<std::string> source_strings;
+    for (auto const& source : sources) {
+        source_strings.push_back(fs::relative(source, src_dir).generic_string());
+    }
+    // The same file with an empty source list, so every entry must be added
+    auto const stale = pf::bench::synthetic_cmakelists({}, ctx.shape().cmakelists_lines);
+    std::cout << "CMakeLists.txt is " << pf::slurp_file(cmakelists).size() / 1024 << " KiB\n";
+
+    ctx.measure("rewrite_source_lists", [&] {
+        pf::rewrite_source_lists(stale, source_strings);
+    });
+    // A fixed size, whatever the shape: 50k entries to replace, and 50k lines of other code
+    {
+        std::vector<std::string> old_entries;
+        std::vector<std::string> new_entries;
+        for (auto i = 0; i < 50'000; ++i) {
+            old_entries.push_back("lib/old_file" + std::to_string(i) + ".cpp");
+            new_entries.push_back("lib/new_file" + std::to_string(i) + ".cpp");
+        }
+        auto const large = pf::bench::synthetic_cmakelists(old_entries, 50'000);
+        ctx.measure("rewrite_source_lists/100k-lines", [&] {
+            pf::rewrite_source_lists(large, new_entries);
+        });
+    }
+    ctx.measure(
+        "update_source_files/changed",
+        [&] { pf::write_file(cmakelists, stale); },
+        [&] { pf::update_source_files(cmakelists, sources); });
+    ctx.measure("update_source_files/unchanged", [&] {
+        pf::update_source_files(cmakelists, sources);
+    });
+
+    // As `pf update` does it, streaming from the walk into a set that spills once it holds more
+    // than the limit. The smaller limit makes for about ten runs at the default shape.
+    for (std::size_t limit : {pf::path_set::default_memory_limit, std::size_t{64} * 1024}) {
+        std::size_t runs = 0;
+        ctx.measure("update_source_files/streamed/limit=" + std::to_string(limit / 1024) + "KiB",
+                    [&] {
+                        pf::path_set set{limit};
+                        pf::for_each_source(src_dir, {}, [&](pf::source_entry const& source) {
+                            set.insert_in(source.dir, source.name);
+                        });
+                        pf::update_source_files(cmakelists, set);
+                        runs = set.spilled_runs();
+                    });
+        std::cout << "Spilled " << runs << " runs\n";
+    }
+}
@@ -0,0 +1,106 @@
+#include <pf/existing/cmake_cache.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+
+namespace fs = pf::fs;
+
+namespace {
+
+constexpr std::string_view SampleCache = R"(# This is the CMakeCache file.
+
+//Choose the type of build
+CMAKE_BUILD_TYPE:STRING=Release
+CMAKE_CXX_FLAGS:STRING=-O2 -Wall  )"
+                                         "\r\n"
+                                         R"("QUOTED:KEY":BOOL=ON
+UNTYPED=value=with=equals
+EMPTY:STRING=
+CMAKE_BUILD_TYPE:STRING=Debug
+not an entry
+)";
+
+}  // namespace
+
+TEST_CASE("read CMake cache") {
+    auto const dir        = fs::path{PF_TEST_BINDIR} / "_cmake_cache";
+    auto const cache_file = dir / "CMakeCache.txt";
+    fs::remove_all(dir);
+    pf::write_file(cache_file, SampleCache);
+
+    auto const cache = pf::cmake_cache::load(cache_file);
+    CHECK_FALSE(cache.loaded_from_index());
+    CHECK(cache.size() == 6);
+
+    // The last entry wins
+    auto build_type = cache.find("CMAKE_BUILD_TYPE");
+    REQUIRE(build_type);
+    CHECK(build_type->type == "STRING");
+    CHECK(build_type->value == "Debug");
+
+    CHECK(cache.find("CMAKE_CXX_FLAGS")->value == "-O2 -Wall");
+    CHECK(cache.find("QUOTED:KEY")->value == "ON");
+    CHECK(cache.find("UNTYPED")->type.empty());
+    CHECK(cache.find("UNTYPED")->value == "value=with=equals");
+    CHECK(cache.find("EMPTY")->value.empty());
+    CHECK_FALSE(cache.find("MISSING"));
+    CHECK_FALSE(cache.find("not an entry"));
+
+    std::error_code ec;
+    pf::cmake_cache::load(dir / "missing.txt", ec);
+    CHECK(ec);
+}
+
+TEST_CASE("reuse the CMake cache index") {
+    auto const dir        = fs::path{PF_TEST_BINDIR} / "_cmake_cache_index";
+    auto const cache_file = dir / "CMakeCache.txt";
+    fs::remove_all(dir);
+    pf::write_file(cache_file, SampleCache);
+
+    // No CMakeFiles/, so nowhere to save the index
+    pf::cmake_cache::load(cache_file);
+    CHECK_FALSE(fs::exists(pf::cmake_cache::index_path(cache_file)));
+
+    // A freshly modified cache might change again without its mtime changing, so it isn't indexed
+    fs::create_directories(dir / "CMakeFiles");
+    pf::cmake_cache::load(cache_file);
+    CHECK_FALSE(fs::exists(pf::cmake_cache::index_path(cache_file)));
+
+    auto const past = fs::file_time_type::clock::now() - std::chrono::hours{1};
+    fs::last_write_time(cache_file, past);
+    // Nor is it when only reading
+    pf::cmake_cache::load(cache_file, pf::cmake_cache::index_mode::read_only);
+    CHECK_FALSE(fs::exists(pf::cmake_cache::index_path(cache_file)));
+    CHECK_FALSE(pf::cmake_cache::load(cache_file).loaded_from_index());
+    CHECK(fs::exists(pf::cmake_cache::index_path(cache_file)));
+    CHECK(pf::cmake_cache::load(cache_file, pf::cmake_cache::index_mode::read_only)
+              .loaded_from_index());
+
+    auto const indexed = pf::cmake_cache::load(cache_file);
+    CHECK(indexed.loaded_from_index());
+    CHECK(indexed.size() == 6);
+    CHECK(indexed.find("CMAKE_BUILD_TYPE")->value == "Debug");
+    CHECK(indexed.find("QUOTED:KEY")->value == "ON");
+
+    // An index without an empty bucket would make lookups of missing keys probe forever
+    {
+        auto       bytes    = pf::slurp_file(pf::cmake_cache::index_path(cache_file));
+        auto const buckets  = bytes.size() - 16 * sizeof(std::uint32_t);
+        auto const occupied = std::string{"\x01\0\0\0", 4};
+        for (auto pos = buckets; pos < bytes.size(); pos += occupied.size()) {
+            bytes.replace(pos, occupied.size(), occupied);
+        }
+        pf::write_file(pf::cmake_cache::index_path(cache_file), bytes);
+        auto const full = pf::cmake_cache::load(cache_file);
+        CHECK_FALSE(full.loaded_from_index());
+        CHECK_FALSE(full.find("MISSING"));
+    }
+
+    // Changing the cache invalidates the index
+    pf::write_file(cache_file, "CMAKE_BUILD_TYPE:STRING=MinSizeRel\n");
+    fs::last_write_time(cache_file, past + std::chrono::seconds{1});
+    auto const changed = pf::cmake_cache::load(cache_file);
+    CHECK_FALSE(changed.loaded_from_index());
+    CHECK(changed.find("CMAKE_BUILD_TYPE")->value == "MinSizeRel");
+}
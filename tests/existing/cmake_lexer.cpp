@@ -0,0 +1,99 @@
+#include <pf/existing/cmake_lexer.hpp>
+#include <pf/existing/update_source_files.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<pf::cmake_token> tokenize(std::string_view code) {
+    std::vector<pf::cmake_token> tokens;
+    pf::cmake_lexer              lexer{code};
+    for (auto tok = lexer.next(); tok.kind != pf::cmake_token_kind::eof; tok = lexer.next()) {
+        tokens.push_back(tok);
+    }
+    return tokens;
+}
+
+}  // namespace
+
+TEST_CASE("lex CMake code") {
+    using kind = pf::cmake_token_kind;
+
+    std::string_view const code
+        = "set(foo \"a ) \\\" b\" [==[ ) ]] ]==] # comment (\n"
+          "  #[[ multi\n ) line ]] bar\\ baz -Dx=\"y z\")\n";
+    auto const tokens = tokenize(code);
+
+    std::string joined;
+    for (auto& tok : tokens) {
+        joined += tok.text;
+    }
+    CHECK(joined == code);
+
+    std::vector<kind> kinds;
+    for (auto& tok : tokens) {
+        if (tok.kind != kind::whitespace) {
+            kinds.push_back(tok.kind);
+        }
+    }
+    CHECK(kinds
+          == std::vector<kind>{
+                 kind::unquoted_argument,
+                 kind::open_paren,
+                 kind::unquoted_argument,
+                 kind::quoted_argument,
+                 kind::bracket_argument,
+                 kind::line_comment,
+                 kind::newline,
+                 kind::bracket_comment,
+                 kind::unquoted_argument,
+                 kind::unquoted_argument,
+                 kind::close_paren,
+                 kind::newline,
+             });
+}
+
+TEST_CASE("rewrite source lists") {
+    std::vector<std::string> const sources{"a.cpp", "b.cpp"};
+
+    SECTION("Parentheses in comments and strings") {
+        auto const code
+            = "add_library(foo # a (comment\n"
+              "    \")\"\n"
+              "    # sources\n"
+              "    old.cpp\n"
+              "    )\n";
+        CHECK(pf::rewrite_source_lists(code, sources)
+              == "add_library(foo # a (comment\n"
+                 "    \")\"\n"
+                 "    # sources\n"
+                 "    a.cpp\n"
+                 "    b.cpp\n"
+                 "    )\n");
+    }
+
+    SECTION("Nested parentheses") {
+        auto const code
+            = "target_sources(foo PRIVATE $<$<BOOL:(x)>:y>\n"
+              "  # sources\n"
+              "  old.cpp)\n";
+        CHECK(pf::rewrite_source_lists(code, sources)
+              == "target_sources(foo PRIVATE $<$<BOOL:(x)>:y>\n"
+                 "  # sources\n"
+                 "  a.cpp\n"
+                 "  b.cpp)\n");
+    }
+
+    SECTION("Empty list") {
+        CHECK(pf::rewrite_source_lists("set(x\n  # sources\n)", sources)
+              == "set(x\n  # sources\n  a.cpp\n  b.cpp\n)");
+    }
+
+    SECTION("Markers outside of commands and in bracket comments") {
+        auto const code = "# sources\nset(x #[[\n# sources\n]] y)\n";
+        CHECK(pf::rewrite_source_lists(code, sources) == code);
+    }
+}
@@ -1,7 +1,11 @@
 #include <pf/existing/detect_base_dir.hpp>
 
+#include <pf/existing/cmake_cache.hpp>
+
 #include <catch2/catch.hpp>
 
+#include <chrono>
+
 namespace fs = pf::fs;
 
 TEST_CASE("detect project root") {
@@ -31,3 +35,22 @@ TEST_CASE("no project root") {
     auto basedir = pf::detect_base_dir(path);
     CHECK(basedir == std::nullopt);
 }
+
+TEST_CASE("detect project root from a build directory elsewhere") {
+    auto const root  = fs::path{PF_TEST_BINDIR} / "_detect_base_dir";
+    auto const build = root / "build";
+    fs::remove_all(root);
+    pf::write_file(build / "CMakeCache.txt", "CMAKE_HOME_DIRECTORY:INTERNAL=/some/project\n");
+    fs::create_directories(build / "CMakeFiles");
+    fs::last_write_time(build / "CMakeCache.txt",
+                        fs::file_time_type::clock::now() - std::chrono::hours{1});
+
+    CHECK(pf::detect_base_dir(build) == fs::path{"/some/project"});
+    // Nothing is written to the build directory
+    CHECK_FALSE(fs::exists(pf::cmake_cache::index_path(build / "CMakeCache.txt")));
+
+    // A cache that cannot be read names no project
+    fs::remove(build / "CMakeCache.txt");
+    fs::create_directories(build / "CMakeCache.txt");
+    CHECK(pf::detect_base_dir(build) == std::nullopt);
+}
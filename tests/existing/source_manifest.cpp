@@ -0,0 +1,89 @@
+#include <pf/existing/source_manifest.hpp>
+
+#include <catch2/catch.hpp>
+
+namespace fs = pf::fs;
+
+using kind = pf::source_manifest::kind;
+
+TEST_CASE("Classify sources for pf_auto") {
+    CHECK(pf::source_manifest::classify("src", "main.cpp") == kind::exe);
+    CHECK(pf::source_manifest::classify("src", "notes.txt") == kind::exe);
+    CHECK(pf::source_manifest::classify("src", "lib/a.cpp") == kind::lib);
+    // pf_auto() builds tests into the library, as it always has
+    CHECK(pf::source_manifest::classify("src", "lib/a.test.cpp") == kind::lib);
+    CHECK(pf::source_manifest::classify("include", "a.hpp") == kind::lib);
+}
+
+TEST_CASE("Render a source manifest") {
+    pf::source_manifest manifest;
+    manifest.add("src", "app.cpp");
+    manifest.add("src", "lib/a.cpp");
+    manifest.add("src", "lib/a.test.cpp");
+    manifest.add("include", "lib/a.hpp");
+    CHECK(manifest.render()
+          == "# Generated by `pf update`: The sources of the project, for pf_auto(), so that it\n"
+             "# need not glob for them. Paths are relative to the project directory.\n"
+             "set(PF_EXE_SOURCES\n    [[src/app.cpp]]\n    )\n"
+             "set(PF_LIB_SOURCES\n    [[src/lib/a.cpp]]\n    [[src/lib/a.test.cpp]]\n"
+             "    [[include/lib/a.hpp]]\n    )\n");
+}
+
+TEST_CASE("Render paths that are not plain CMake arguments") {
+    pf::source_manifest manifest;
+    manifest.add("src", "a b;#$\"(x).cpp");
+    manifest.add("src", "lib/]]");
+    manifest.add("src", "lib/x]=]y]");
+    CHECK(manifest.render()
+          == "# Generated by `pf update`: The sources of the project, for pf_auto(), so that it\n"
+             "# need not glob for them. Paths are relative to the project directory.\n"
+             "set(PF_EXE_SOURCES\n    [[src/a b;#$\"(x).cpp]]\n    )\n"
+             "set(PF_LIB_SOURCES\n    [=[src/lib/]]]=]\n    [==[src/lib/x]=]y]]==]\n    )\n");
+}
+
+TEST_CASE("Collect every file for a source manifest") {
+    auto const root = fs::path{PF_TEST_BINDIR} / "_source_manifest_collect";
+    fs::remove_all(root);
+    // pf_auto() globs for every file, not only those with the usual source extensions
+    for (auto const& file : {"src/app.cpp",
+                             "src/a/k.cu",
+                             "src/a/x.inl",
+                             "src/a/y.S",
+                             "src/a/.hidden",
+                             "include/a.hpp",
+                             "include/a/b.ipp"}) {
+        pf::write_file(root / file, "");
+    }
+    fs::create_directories(root / "src/empty");
+    CHECK(pf::source_manifest::collect(root).render()
+          == "# Generated by `pf update`: The sources of the project, for pf_auto(), so that it\n"
+             "# need not glob for them. Paths are relative to the project directory.\n"
+             "set(PF_EXE_SOURCES\n    [[src/app.cpp]]\n    )\n"
+             "set(PF_LIB_SOURCES\n    [[src/a/.hidden]]\n    [[src/a/k.cu]]\n    [[src/a/x.inl]]\n"
+             "    [[src/a/y.S]]\n    [[include/a.hpp]]\n    [[include/a/b.ipp]]\n    )\n");
+
+    // Only written for a project that wants one
+    CHECK_FALSE(pf::update_source_manifest(root));
+    pf::write_file(root / "CMakeLists.txt", "pf_auto()\n");
+    CHECK(pf::update_source_manifest(root));
+    CHECK_FALSE(pf::update_source_manifest(root));
+}
+
+TEST_CASE("Tell which projects want a source manifest") {
+    auto const root = fs::path{PF_TEST_BINDIR} / "_source_manifest";
+    fs::remove_all(root);
+
+    pf::write_file(root / "auto/CMakeLists.txt",
+                   "project(auto)\ninclude(Pitchfork)\n\nPF_AUTO(\n    LINK foo\n    )\n");
+    CHECK(pf::source_manifest::wanted(root / "auto"));
+
+    // Only mentioned, not called
+    pf::write_file(root / "plain/CMakeLists.txt",
+                   "# pf_auto()\nmessage(STATUS pf_auto(x))\nset(x \"pf_auto()\")\n");
+    CHECK_FALSE(pf::source_manifest::wanted(root / "plain"));
+    CHECK_FALSE(pf::source_manifest::wanted(root / "missing"));
+
+    pf::source_manifest{}.write(root / "plain");
+    CHECK(fs::exists(root / "plain/cmake/pf_sources.cmake"));
+    CHECK(pf::source_manifest::wanted(root / "plain"));
+}
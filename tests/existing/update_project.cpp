@@ -0,0 +1,162 @@
+#include <pf/existing/source_manifest.hpp>
+#include <pf/existing/update_project.hpp>
+
+#include <catch2/catch.hpp>
+
+namespace fs = pf::fs;
+
+namespace {
+
+constexpr std::string_view SampleCMakeLists = "add_library(lib\n    # sources\n    )\n";
+
+void make_project(fs::path const& dir) {
+    pf::write_file(dir / "src/CMakeLists.txt", SampleCMakeLists);
+    pf::write_file(dir / "src/lib/lib.cpp", "");
+}
+
+}  // namespace
+
+TEST_CASE("update all projects") {
+    auto const root = fs::path{PF_TEST_BINDIR} / "_update_all";
+    fs::remove_all(root);
+
+    make_project(root / "a");
+    make_project(root / "group/b");
+    pf::write_file(root / "group/b/tests/CMakeLists.txt", SampleCMakeLists);
+    pf::write_file(root / "group/b/tests/b/test.cpp", "");
+    // Has a tests/ directory without a CMakeLists.txt
+    make_project(root / "broken");
+    fs::create_directories(root / "broken/tests");
+    // None of these are searched
+    make_project(root / ".hidden/c");
+    make_project(root / "a/nested");
+    pf::write_file(root / "build/CMakeCache.txt", "");
+    make_project(root / "build/d");
+
+    pf::update_options opts;
+    opts.jobs      = 4;
+    opts.use_index = false;
+
+    auto const results = pf::update_all_projects(root, opts);
+    REQUIRE(results.size() == 3);
+    CHECK(results[0].project_dir == root / "a");
+    CHECK(results[0].ok());
+    CHECK(results[1].project_dir == root / "broken");
+    CHECK_FALSE(results[1].ok());
+    CHECK(results[2].project_dir == root / "group/b");
+    CHECK(results[2].ok());
+
+    CHECK(pf::slurp_file(root / "a/src/CMakeLists.txt")
+          == "add_library(lib\n    # sources\n    lib/lib.cpp\n    )\n");
+    CHECK(pf::slurp_file(root / "group/b/tests/CMakeLists.txt")
+          == "add_library(lib\n    # sources\n    b/test.cpp\n    )\n");
+    CHECK(pf::slurp_file(root / ".hidden/c/src/CMakeLists.txt") == SampleCMakeLists);
+}
+
+TEST_CASE("update a project with source patterns") {
+    auto const root = fs::path{PF_TEST_BINDIR} / "_update_patterns";
+    fs::remove_all(root);
+    make_project(root);
+    pf::write_file(root / "src/lib/kernel.cu", "");
+    pf::write_file(root / "src/lib/gen/generated.cpp", "");
+    pf::write_file(root / "src/lib/mod.ixx", "");
+    pf::write_file(root / "pitchfork.json", R"({"sources": ["*.cu", "!gen/"]})");
+
+    pf::update_options opts;
+    opts.use_index       = false;
+    opts.source_patterns = {"*.ixx"};
+
+    auto const result = pf::update_project(root, opts);
+    CHECK(result.ok());
+    CHECK(pf::slurp_file(root / "src/CMakeLists.txt")
+          == "add_library(lib\n    # sources\n    lib/kernel.cu\n    lib/lib.cpp\n    lib/mod.ixx\n"
+             "    )\n");
+
+    pf::write_file(root / "pitchfork.json", R"({"source": []})");
+    auto const bad = pf::update_project(root, opts);
+    CHECK_FALSE(bad.ok());
+    CHECK(bad.error.find("Unknown setting `source`") != std::string::npos);
+}
+
+TEST_CASE("update a project with sources spilled to disk") {
+    auto const root = fs::path{PF_TEST_BINDIR} / "_update_spilled";
+    fs::remove_all(root);
+    make_project(root);
+    pf::write_file(root / "src/lib/b/two.cpp", "");
+    pf::write_file(root / "src/lib/a.cpp", "");
+    pf::write_file(root / "src/lib-extra/three.cpp", "");
+
+    pf::update_options opts;
+    opts.use_index = false;
+    // Every source goes to its own run
+    opts.source_memory_limit = 1;
+
+    auto const result = pf::update_project(root, opts);
+    CHECK(result.ok());
+    CHECK(pf::slurp_file(root / "src/CMakeLists.txt")
+          == "add_library(lib\n    # sources\n    lib/a.cpp\n    lib/b/two.cpp\n    lib/lib.cpp\n"
+             "    lib-extra/three.cpp\n    )\n");
+}
+
+TEST_CASE("update a project from the git index") {
+    auto const root = fs::path{PF_TEST_BINDIR} / "_update_git_index";
+    fs::remove_all(root);
+    make_project(root);
+
+    pf::update_options opts;
+    opts.use_index      = false;
+    opts.from_git_index = true;
+
+    auto const no_repo = pf::update_project(root, opts);
+    CHECK_FALSE(no_repo.ok());
+    CHECK(no_repo.error.find("Not in a git repository") != std::string::npos);
+
+    // A repository where nothing is tracked yet: The header, then the checksum
+    using namespace std::string_literals;
+    pf::write_file(root / ".git/index", "DIRC\0\0\0\2\0\0\0\0"s + std::string(20, '\0'));
+    auto result = pf::update_project(root, opts);
+    CHECK(result.ok());
+    CHECK(pf::slurp_file(root / "src/CMakeLists.txt").find("lib.cpp") == std::string::npos);
+
+    opts.include_untracked = true;
+    result                 = pf::update_project(root, opts);
+    CHECK(result.ok());
+    auto const cmakelists = pf::slurp_file(root / "src/CMakeLists.txt");
+    CHECK(cmakelists.find("    lib/lib.cpp\n") != std::string::npos);
+}
+
+TEST_CASE("update a project built with pf_auto") {
+    auto const root = fs::path{PF_TEST_BINDIR} / "_update_pf_auto";
+    fs::remove_all(root);
+    pf::write_file(root / "CMakeLists.txt", "project(app)\ninclude(Pitchfork)\npf_auto()\n");
+    pf::write_file(root / "src/app.cpp", "");
+    pf::write_file(root / "src/app/lib.cpp", "");
+    pf::write_file(root / "src/app/lib.test.cpp", "");
+    pf::write_file(root / "src/app/notes.txt", "");
+    pf::write_file(root / "src/app/kernel.cu", "");
+    pf::write_file(root / "include/app.hpp", "");
+    pf::write_file(root / "include/app/lib.hpp", "");
+    pf::write_file(root / "tests/CMakeLists.txt", SampleCMakeLists);
+    pf::write_file(root / "tests/unit/test.cpp", "");
+
+    pf::update_options opts;
+    opts.use_index = false;
+
+    auto const result = pf::update_project(root, opts);
+    CHECK(result.ok());
+    CHECK(pf::slurp_file(pf::source_manifest::path(root))
+          == "# Generated by `pf update`: The sources of the project, for pf_auto(), so that it\n"
+             "# need not glob for them. Paths are relative to the project directory.\n"
+             "set(PF_EXE_SOURCES\n    [[src/app.cpp]]\n    )\n"
+             "set(PF_LIB_SOURCES\n    [[src/app/kernel.cu]]\n    [[src/app/lib.cpp]]\n"
+             "    [[src/app/lib.test.cpp]]\n    [[src/app/notes.txt]]\n    [[include/app.hpp]]\n"
+             "    [[include/app/lib.hpp]]\n    )\n");
+    CHECK(pf::slurp_file(root / "tests/CMakeLists.txt")
+          == "add_library(lib\n    # sources\n    unit/test.cpp\n    )\n");
+    CHECK_FALSE(fs::exists(root / "src/CMakeLists.txt"));
+
+    // Once it has a manifest, the project is found by update_all_projects()
+    auto const results = pf::update_all_projects(root, opts);
+    REQUIRE(results.size() == 1);
+    CHECK(results[0].ok());
+}
@@ -0,0 +1,111 @@
+#include <pf/fs/core.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <iterator>
+
+namespace fs = pf::fs;
+
+TEST_CASE("map files") {
+    auto const dir = fs::path{PF_TEST_BINDIR} / "_mapped_file";
+    fs::create_directories(dir);
+
+    SECTION("Small file") {
+        pf::write_file(dir / "small.txt", "Hello, world!\n");
+        auto file = pf::map_file(dir / "small.txt");
+        CHECK_FALSE(file.is_mapped());
+        CHECK(file.view() == "Hello, world!\n");
+
+        // Moving must not leave the view pointing at the old (inline) buffer
+        auto moved = std::move(file);
+        CHECK(moved.view() == "Hello, world!\n");
+    }
+
+    SECTION("Large file") {
+        std::string const content(pf::mapped_file::map_threshold * 2, 'x');
+        pf::write_file(dir / "large.txt", content);
+        auto file = pf::map_file(dir / "large.txt");
+        CHECK(file.is_mapped());
+        CHECK(file.view() == content);
+        CHECK(pf::slurp_file(dir / "large.txt") == content);
+    }
+
+    SECTION("Empty file") {
+        pf::write_file(dir / "empty.txt", "");
+        CHECK(pf::map_file(dir / "empty.txt").view().empty());
+    }
+
+#if defined(__linux__)
+    SECTION("File that reports a size of zero") {
+        REQUIRE(fs::file_size("/proc/self/status") == 0);
+        CHECK(pf::slurp_file("/proc/self/status").find("Name:") != std::string::npos);
+    }
+#endif
+
+    SECTION("Missing file") {
+        std::error_code ec;
+        pf::map_file(dir / "does-not-exist.txt", ec);
+        CHECK(ec == std::errc::no_such_file_or_directory);
+        CHECK_THROWS_AS(pf::map_file(dir / "does-not-exist.txt"), std::system_error);
+    }
+}
+
+TEST_CASE("write files atomically") {
+    auto const dir = fs::path{PF_TEST_BINDIR} / "_atomic_write";
+    fs::remove_all(dir);
+    auto const file = dir / "sub/file.txt";
+
+    constexpr auto mode = pf::write_mode::atomic_if_changed;
+    CHECK(pf::write_file(file, "first", mode));
+    CHECK(pf::slurp_file(file) == "first");
+
+    SECTION("Unchanged content is not written") {
+        auto const old_time = fs::file_time_type::clock::now() - std::chrono::hours{1};
+        fs::last_write_time(file, old_time);
+        CHECK_FALSE(pf::write_file(file, "first", mode));
+        CHECK(fs::last_write_time(file) == old_time);
+    }
+
+    SECTION("Changed content replaces the file") {
+        fs::permissions(file, fs::perms::owner_read | fs::perms::owner_write);
+        CHECK(pf::write_file(file, "second", mode));
+        CHECK(pf::slurp_file(file) == "second");
+        // Same size, different content
+        CHECK(pf::write_file(file, "SECOND", mode));
+        CHECK(pf::slurp_file(file) == "SECOND");
+        CHECK(fs::status(file).permissions() == (fs::perms::owner_read | fs::perms::owner_write));
+        // No temporary files are left behind
+        CHECK(std::distance(fs::directory_iterator{dir / "sub"}, fs::directory_iterator{}) == 1);
+    }
+
+#if !defined(_WIN32)
+    SECTION("Links are written through, not replaced") {
+        auto const link = dir / "link.txt";
+        fs::create_symlink("sub/file.txt", link);
+        // A chain of links, one of them absolute
+        auto const chain = dir / "chain.txt";
+        fs::create_symlink(link, chain);
+        CHECK(pf::write_file(chain, "through the links", mode));
+        CHECK(fs::is_symlink(chain));
+        CHECK(fs::is_symlink(link));
+        CHECK(pf::slurp_file(file) == "through the links");
+
+        // A dangling link creates its target
+        fs::create_symlink("sub/new.txt", dir / "dangling.txt");
+        CHECK(pf::write_file(dir / "dangling.txt", "new", mode));
+        CHECK(pf::slurp_file(dir / "sub/new.txt") == "new");
+
+        auto const hard_link = dir / "hard.txt";
+        fs::create_hard_link(file, hard_link);
+        CHECK(pf::write_file(hard_link, "shared", mode));
+        CHECK(fs::hard_link_count(file) == 2);
+        CHECK(pf::slurp_file(file) == "shared");
+
+        fs::create_symlink("loop.txt", dir / "loop.txt");
+        std::error_code ec;
+        CHECK_FALSE(pf::write_file(dir / "loop.txt", "x", mode, ec));
+        CHECK(ec == std::errc::too_many_symbolic_link_levels);
+    }
+#endif
+}
@@ -0,0 +1,44 @@
+#include <pf/fs/dir_reader.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <map>
+
+namespace fs = pf::fs;
+
+TEST_CASE("Read directories with dir_reader") {
+    if (!pf::dir_reader::supported) {
+        CHECK_THROWS_AS(pf::dir_reader{PF_TEST_BINDIR}, std::system_error);
+        return;
+    }
+    auto const dir = fs::path{PF_TEST_BINDIR} / "_dir_reader";
+    fs::remove_all(dir);
+    pf::write_file(dir / "file.cpp", "");
+    pf::write_file(dir / "sub/nested.cpp", "");
+    fs::create_directory_symlink("sub", dir / "link");
+
+    pf::dir_reader                        reader{dir};
+    std::map<std::string, fs::file_type> types;
+    pf::dir_reader::entry                 ent;
+    while (reader.next(ent)) {
+        types[std::string{ent.name}] = ent.type;
+        if (ent.type == fs::file_type::symlink) {
+            CHECK(reader.followed_type(ent) == fs::file_type::directory);
+        }
+    }
+    CHECK(types
+          == std::map<std::string, fs::file_type>{{"file.cpp", fs::file_type::regular},
+                                                  {"link", fs::file_type::symlink},
+                                                  {"sub", fs::file_type::directory}});
+    CHECK_FALSE(reader.next(ent));
+
+    // Subdirectories are opened through their parent, and symlinks only if asked to
+    pf::dir_reader sub{reader, "sub"};
+    CHECK(sub.path() == dir / "sub");
+    REQUIRE(sub.next(ent));
+    CHECK(ent.name == "nested.cpp");
+    CHECK_FALSE(sub.next(ent));
+    CHECK_THROWS_AS((pf::dir_reader{reader, "link"}), fs::filesystem_error);
+    CHECK_NOTHROW(pf::dir_reader{reader, "link", true});
+    CHECK_THROWS_AS(pf::dir_reader{dir / "missing"}, fs::filesystem_error);
+}
@@ -0,0 +1,205 @@
+#include <pf/fs/git_index.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+
+namespace fs = pf::fs;
+
+using strings = std::vector<std::string>;
+
+namespace {
+
+struct test_entry {
+    std::string   path;
+    std::uint32_t mode          = 0100644;
+    unsigned      stage         = 0;
+    bool          skip_worktree = false;
+};
+
+void put_be32(std::string& out, std::uint32_t value) {
+    for (auto shift : {24, 16, 8, 0}) {
+        out.push_back(static_cast<char>((value >> shift) & 0xff));
+    }
+}
+
+void put_be16(std::string& out, std::uint16_t value) {
+    out.push_back(static_cast<char>(value >> 8));
+    out.push_back(static_cast<char>(value & 0xff));
+}
+
+// As git encodes the prefix length of a path in version 4
+void put_varint(std::string& out, std::size_t value) {
+    std::string bytes(1, static_cast<char>(value & 0x7f));
+    while (value >>= 7) {
+        --value;
+        bytes.insert(bytes.begin(), static_cast<char>(0x80 | (value & 0x7f)));
+    }
+    out += bytes;
+}
+
+// An index as git would write it, with an empty "TREE" extension, or whichever is given
+std::string index_bytes(std::uint32_t                  version,
+                        std::vector<test_entry> const& entries,
+                        std::string const&             extension = "TREE") {
+    std::string out = "DIRC";
+    put_be32(out, version);
+    put_be32(out, static_cast<std::uint32_t>(entries.size()));
+    std::string last;
+    for (auto const& ent : entries) {
+        auto const start = out.size();
+        out.append(24, '\0');
+        put_be32(out, ent.mode);
+        out.append(8, '\0');
+        put_be32(out, 42);
+        out.append(20, '\x11');
+        auto const name_size = std::min(ent.path.size(), std::size_t{0xfff});
+        auto       flags     = static_cast<std::uint16_t>((ent.stage << 12) | name_size);
+        if (ent.skip_worktree) {
+            flags |= 0x4000;
+        }
+        put_be16(out, flags);
+        if (ent.skip_worktree) {
+            put_be16(out, 0x4000);
+        }
+        if (version == 4) {
+            auto common = std::size_t{0};
+            while (common < last.size() && common < ent.path.size()
+                   && last[common] == ent.path[common]) {
+                ++common;
+            }
+            put_varint(out, last.size() - common);
+            out += ent.path.substr(common);
+            out.push_back('\0');
+            last = ent.path;
+        } else {
+            out += ent.path;
+            out.append(8 - (out.size() - start) % 8, '\0');
+        }
+    }
+    out += extension;
+    put_be32(out, 0);
+    out.append(20, '\0');
+    return out;
+}
+
+std::vector<test_entry> sample_entries() {
+    return {
+        {"README.md"},
+        {"lib/ext", pf::git_index::gitlink_mode},
+        {"proj/src/a-b/x.cpp"},
+        {"proj/src/a.cpp"},
+        {"proj/src/a/conflict.cpp", 0100644, 1},
+        {"proj/src/a/conflict.cpp", 0100644, 2},
+        {"proj/src/a/conflict.cpp", 0100644, 3},
+        {"proj/src/a/" + std::string(300, 'n') + ".hpp"},
+        {"proj/src/a/z.cpp"},
+        {"proj/src/notes.txt"},
+        {"proj/src/sparse.cpp", 0100644, 0, true},
+        {"proj/src/sub", pf::git_index::gitlink_mode},
+        {"proj/src0/b.cpp"},
+        {"proj/tests/t.cpp"},
+        {"proj/tests/unit/t.cpp"},
+    };
+}
+
+fs::path write_index(std::string const& name, std::string const& bytes) {
+    auto const file = fs::path{PF_TEST_BINDIR} / "_git_index" / name;
+    pf::write_file(file, bytes);
+    return file;
+}
+
+strings tracked_sources(pf::git_index const& index, std::string_view root) {
+    strings ret;
+    pf::for_each_tracked_source(index,
+                                root,
+                                pf::source_patterns::defaults(),
+                                [&](pf::source_entry const& source) {
+                                    ret.push_back(std::string{source.dir} + "|"
+                                                  + std::string{source.name});
+                                });
+    return ret;
+}
+
+}  // namespace
+
+TEST_CASE("Read a git index") {
+    auto const version = GENERATE(2u, 3u, 4u);
+    auto       entries = sample_entries();
+    if (version == 2) {
+        // Extended flags are new in version 3
+        entries.erase(std::remove_if(entries.begin(),
+                                     entries.end(),
+                                     [](auto const& ent) { return ent.skip_worktree; }),
+                      entries.end());
+    }
+    auto const index
+        = pf::git_index::load(write_index("v" + std::to_string(version),
+                                          index_bytes(version, entries)));
+    CHECK(index.version() == version);
+    CHECK(index.size() == entries.size());
+
+    strings paths;
+    index.for_each([&](pf::git_index::entry const& ent) {
+        paths.emplace_back(ent.path);
+        CHECK(ent.size == 42);
+    });
+    strings expected;
+    for (auto const& ent : entries) {
+        expected.push_back(ent.path);
+    }
+    CHECK(paths == expected);
+
+    paths.clear();
+    index.for_each_below("proj/src", [&](pf::git_index::entry const& ent) {
+        paths.emplace_back(ent.path);
+    });
+    CHECK(paths.size() == entries.size() - 5);
+    CHECK(paths.front() == "proj/src/a-b/x.cpp");
+    CHECK(paths.back() == "proj/src/sub");
+
+    // Neither files directly within the root, nor submodules, nor paths outside the sparse
+    // checkout, nor conflicting stages
+    CHECK(tracked_sources(index, "proj/src")
+          == strings{"a-b|x.cpp", "a|conflict.cpp", "a|" + std::string(300, 'n') + ".hpp",
+                     "a|z.cpp"});
+    CHECK(tracked_sources(index, "proj/tests") == strings{"unit|t.cpp"});
+    CHECK(tracked_sources(index, "missing").empty());
+}
+
+TEST_CASE("Refuse a git index that is malformed or not supported") {
+    auto const bytes = index_bytes(4, sample_entries());
+    CHECK_THROWS_AS(pf::git_index::load(write_index("bad-signature", "DIRX" + bytes.substr(4))),
+                    std::runtime_error);
+    CHECK_THROWS_AS(pf::git_index::load(write_index("truncated", bytes.substr(0, 200))),
+                    std::runtime_error);
+    CHECK_THROWS_AS(pf::git_index::load(write_index("v5", index_bytes(5, {}))),
+                    std::runtime_error);
+    CHECK_THROWS_AS(pf::git_index::load(write_index("split", index_bytes(2, {}, "link"))),
+                    std::runtime_error);
+    CHECK_THROWS_AS(pf::git_index::load(write_index("empty-file", "")), std::runtime_error);
+    CHECK(pf::git_index::load(write_index("empty", index_bytes(2, {}))).size() == 0);
+}
+
+TEST_CASE("Find a git repository") {
+    auto const root = fs::path{PF_TEST_BINDIR} / "_git_repository";
+    fs::remove_all(root);
+    fs::create_directories(root / "main/.git");
+    fs::create_directories(root / "main/project/src");
+    pf::write_file(root / "main/.git/config", "[extensions]\n\tObjectFormat = sha256\n");
+    // A submodule, whose .git is a file pointing into that of its parent
+    fs::create_directories(root / "main/.git/modules/sub");
+    pf::write_file(root / "main/sub/.git", "gitdir: ../.git/modules/sub\n");
+
+    auto const repo = pf::find_git_repository(root / "main/project/src");
+    REQUIRE(repo);
+    CHECK(repo->work_tree == fs::canonical(root / "main"));
+    CHECK(repo->index_file() == fs::canonical(root / "main/.git") / "index");
+    CHECK(repo->hash_size == 32);
+
+    auto const sub = pf::find_git_repository(root / "main/sub");
+    REQUIRE(sub);
+    CHECK(sub->work_tree == fs::canonical(root / "main/sub"));
+    CHECK(sub->git_dir == fs::canonical(root / "main/.git/modules/sub"));
+    CHECK(sub->hash_size == 20);
+}
@@ -0,0 +1,56 @@
+#include <pf/fs/glob.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+
+namespace fs = pf::fs;
+
+TEST_CASE("glob sources") {
+    auto const src_dir = fs::path{PF_TEST_BINDIR} / "existing/sample/project/src";
+    auto const sources = pf::glob_sources(src_dir);
+
+    CHECK(sources.size() == 20);
+    CHECK(std::is_sorted(sources.begin(), sources.end()));
+    CHECK(sources.front() == src_dir / "project/header1.h");
+    CHECK(sources.back() == src_dir / "project/subfolder/source5.c++");
+
+    for (auto jobs : {0u, 2u, 7u}) {
+        DYNAMIC_SECTION("jobs: " << jobs) {
+            pf::glob_options opts;
+            opts.jobs = jobs;
+            CHECK(pf::glob_sources(src_dir, opts) == sources);
+        }
+    }
+}
+
+TEST_CASE("glob sources with std::filesystem") {
+    auto const dir = fs::path{PF_TEST_BINDIR} / "_glob_backends";
+    fs::remove_all(dir);
+    pf::write_file(dir / "lib/a.cpp", "");
+    pf::write_file(dir / "lib/sub/b.hpp", "");
+    pf::write_file(dir / "other/c.cpp", "");
+    // Symlinks are only followed at the top level, and otherwise count as files
+    fs::create_directory_symlink("other", dir / "linked");
+    fs::create_directory_symlink("../other", dir / "lib/linked.cpp");
+    fs::create_symlink("a.cpp", dir / "lib/alias.cpp");
+
+    auto const expected = std::vector<fs::path>{dir / "lib/a.cpp",
+                                                dir / "lib/alias.cpp",
+                                                dir / "lib/linked.cpp",
+                                                dir / "lib/sub/b.hpp",
+                                                dir / "linked/c.cpp",
+                                                dir / "other/c.cpp"};
+    for (auto jobs : {1u, 3u}) {
+        for (auto use_std_filesystem : {false, true}) {
+            INFO("jobs: " << jobs << ", std::filesystem: " << use_std_filesystem);
+            pf::stat_cache   stats;
+            pf::glob_options opts;
+            opts.jobs               = jobs;
+            opts.stats              = &stats;
+            opts.use_std_filesystem = use_std_filesystem;
+            CHECK(pf::glob_sources(dir, opts) == expected);
+            CHECK(stats.lookups() > 0);
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#include <pf/fs/ignore_rules.hpp>
+
+#include <pf/fs/glob.hpp>
+#include <pf/fs/source_index.hpp>
+
+#include <catch2/catch.hpp>
+
+namespace fs = pf::fs;
+
+using paths = std::vector<fs::path>;
+
+TEST_CASE("Parse .gitignore files") {
+    auto const patterns = pf::compile_gitignore("# A comment\n"
+                                                "*.o\n"
+                                                "build/\n"
+                                                "/only_at_root\n"
+                                                "docs/*.html\n"
+                                                "!keep.o\n"
+                                                "trailing_space   \r\n"
+                                                "escaped\\ \n"
+                                                "\\#not_a_comment\n"
+                                                "[unclosed\n"
+                                                "\n");
+    CHECK(patterns.matches("a.o"));
+    CHECK(patterns.matches("sub/a.o"));
+    CHECK_FALSE(patterns.matches("keep.o"));
+    // Everything below an ignored directory is ignored, as are directories matching a pattern
+    CHECK(patterns.matches("build/"));
+    CHECK(patterns.matches("sub/build/x.cpp"));
+    CHECK(patterns.matches("sub.o/"));
+    // A pattern with a trailing slash only matches directories
+    CHECK_FALSE(patterns.matches("build"));
+    CHECK(patterns.matches("only_at_root"));
+    CHECK_FALSE(patterns.matches("sub/only_at_root"));
+    CHECK(patterns.matches("docs/index.html"));
+    CHECK_FALSE(patterns.matches("docs/api/index.html"));
+    CHECK(patterns.matches("trailing_space"));
+    CHECK(patterns.matches("escaped "));
+    CHECK(patterns.matches("#not_a_comment"));
+    CHECK_FALSE(patterns.matches("# A comment"));
+    CHECK_FALSE(patterns.matches("unclosed"));
+}
+
+TEST_CASE("Rules from nested .gitignore files") {
+    auto const repo = fs::path{PF_TEST_BINDIR} / "_ignore_rules";
+    fs::remove_all(repo);
+    pf::write_file(repo / ".git/info/exclude", "*.local\n*.gen\n");
+    pf::write_file(repo / ".gitignore", "*.tmp\n/src/lib/skipped/\n");
+    pf::write_file(repo / "src/.gitignore", "!important.tmp\n");
+    pf::write_file(repo / "src/lib/.gitignore", "!*.gen\n");
+
+    auto const rules = pf::ignore_rules::for_directory(repo / "src");
+    CHECK(rules.ignored("a.tmp", false));
+    CHECK_FALSE(rules.ignored("important.tmp", false));
+    CHECK(rules.ignored("a.local", false));
+    CHECK(rules.ignored(".git", true));
+    CHECK_FALSE(rules.ignored(".git", false));
+
+    auto lib = rules.enter("lib");
+    CHECK(lib.ignored("skipped", true));
+    CHECK(lib.ignored("a.gen", false));
+    lib.add_file(repo / "src/lib/.gitignore");
+    CHECK_FALSE(lib.ignored("a.gen", false));
+    CHECK(lib.ignored("b.tmp", false));
+    CHECK_FALSE(lib.ignored("important.tmp", false));
+
+    // Starting from within an ignored directory leaves out the rules that ignore it
+    pf::write_file(repo / "src/lib/skipped/.gitignore", "*.cpp\n");
+    auto const skipped = pf::ignore_rules::for_directory(repo / "src/lib/skipped");
+    CHECK(skipped.ignored("a.cpp", false));
+    CHECK_FALSE(skipped.ignored("a.tmp", false));
+}
+
+TEST_CASE("Ignored and build directories are not searched for sources") {
+    auto const repo = fs::path{PF_TEST_BINDIR} / "_glob_ignored";
+    fs::remove_all(repo);
+    fs::create_directories(repo / ".git");
+    pf::write_file(repo / ".gitignore", "vendor/\n");
+    auto const src_dir = repo / "src";
+    pf::write_file(src_dir / "lib/a.cpp", "");
+    pf::write_file(src_dir / "lib/vendor/blob.cpp", "");
+    pf::write_file(src_dir / "lib/_build/CMakeCache.txt", "");
+    pf::write_file(src_dir / "lib/_build/generated.cpp", "");
+    pf::write_file(src_dir / "lib/_build/deeper/generated.cpp", "");
+    pf::write_file(src_dir / "lib/gen/.gitignore", "*.cpp\n!keep.cpp\n");
+    pf::write_file(src_dir / "lib/gen/out.cpp", "");
+    pf::write_file(src_dir / "lib/gen/keep.cpp", "");
+    pf::write_file(src_dir / "lib/.git/hooks.cpp", "");
+    pf::write_file(src_dir / "vendor/c.cpp", "");
+
+    auto const expected = paths{src_dir / "lib/a.cpp", src_dir / "lib/gen/keep.cpp"};
+    for (auto jobs : {1u, 3u}) {
+        INFO("jobs: " << jobs);
+        pf::glob_options opts;
+        opts.jobs = jobs;
+        CHECK(pf::glob_sources(src_dir, opts) == expected);
+
+        pf::source_index index{repo};
+        CHECK(index.glob_sources(src_dir, opts) == expected);
+        // The listings of the index are kept, and its .gitignore files are read again
+        pf::write_file(src_dir / "lib/gen/.gitignore", "*.cpp\n");
+        CHECK(index.glob_sources(src_dir, opts) == paths{src_dir / "lib/a.cpp"});
+        pf::write_file(src_dir / "lib/gen/.gitignore", "*.cpp\n!keep.cpp\n");
+    }
+}
@@ -0,0 +1,57 @@
+#include <pf/fs/glob.hpp>
+#include <pf/fs/path_set.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+
+namespace fs = pf::fs;
+
+using strings = std::vector<std::string>;
+
+namespace {
+
+strings contents(pf::path_set const& set) {
+    strings ret;
+    set.for_each([&](std::string_view path) { ret.emplace_back(path); });
+    return ret;
+}
+
+}  // namespace
+
+TEST_CASE("Path sets spill to disk") {
+    auto const expected = strings{"a/x.cpp", "a/y.cpp", "a-b/z.cpp", "a.cpp", "b.cpp"};
+    for (std::size_t limit : {std::size_t{1}, pf::path_set::default_memory_limit}) {
+        INFO("limit: " << limit);
+        pf::path_set set{limit};
+        set.insert("b.cpp");
+        set.insert_in("a", "y.cpp");
+        set.insert("a-b/z.cpp");
+        set.insert_in("a", "x.cpp");
+        set.insert("a.cpp");
+        // Comes out once, though it may be in more than one run
+        set.insert("b.cpp");
+
+        CHECK((set.spilled_runs() > 0) == (limit == 1));
+        CHECK(contents(set) == expected);
+        // The runs can be read more than once
+        CHECK(contents(set) == expected);
+    }
+}
+
+TEST_CASE("Stream the sources of a glob") {
+    auto const src_dir = fs::path{PF_TEST_BINDIR} / "existing/sample/project/src";
+    auto const sources = pf::glob_sources(src_dir);
+
+    for (auto jobs : {1u, 3u}) {
+        INFO("jobs: " << jobs);
+        pf::glob_options opts;
+        opts.jobs = jobs;
+        std::vector<fs::path> found;
+        pf::for_each_source(src_dir, opts, [&](pf::source_entry const& source) {
+            found.push_back(src_dir / source.dir / source.name);
+        });
+        std::sort(found.begin(), found.end());
+        CHECK(found == sources);
+    }
+}
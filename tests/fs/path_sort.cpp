@@ -0,0 +1,81 @@
+#include <pf/fs/path_sort.hpp>
+#include <pf/util/task_pool.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <random>
+
+namespace fs = pf::fs;
+
+namespace {
+
+std::vector<fs::path> shuffled(std::vector<fs::path> paths) {
+    std::mt19937 rng{42};
+    std::shuffle(paths.begin(), paths.end(), rng);
+    return paths;
+}
+
+}  // namespace
+
+TEST_CASE("Sort paths") {
+    fs::path const        base = "/project/src";
+    std::vector<fs::path> paths;
+    for (std::string name : {"a", "a-b", "a.cpp", "a b", "a/x", "a-b/x", "a/b/c", "B", "b", "~",
+                             "\xc3\xa9", "a/x.cpp", "a.cpp/x", "ab", "a/"}) {
+        paths.push_back(base / name);
+    }
+    paths.push_back(base);
+
+    auto expected = paths;
+    std::sort(expected.begin(), expected.end());
+    // Component by component: "a/x" sorts before "a-b" and "a.cpp", as "a" is a prefix of those
+    CHECK(std::find(expected.begin(), expected.end(), base / "a/x")
+          < std::find(expected.begin(), expected.end(), base / "a-b"));
+
+    auto sorted = shuffled(paths);
+    pf::sort_paths(sorted, base);
+    CHECK(sorted == expected);
+
+    // The base may end with a separator
+    sorted = shuffled(paths);
+    pf::sort_paths(sorted, "/project/src/");
+    CHECK(sorted == expected);
+
+    // Paths that are not below the base are still sorted
+    paths.push_back("/project/srcx/a.cpp");
+    paths.push_back("/other.cpp");
+    expected = paths;
+    std::sort(expected.begin(), expected.end());
+    sorted = shuffled(paths);
+    pf::sort_paths(sorted, base);
+    CHECK(sorted == expected);
+}
+
+TEST_CASE("Sort many paths on a pool") {
+    fs::path const        base = "src";
+    std::vector<fs::path> paths;
+    for (auto dir = 0; dir < 40; ++dir) {
+        auto const dir_name = (dir % 2 ? "d-" : "d.") + std::to_string(dir);
+        for (auto file = 0; file < 1'000; ++file) {
+            paths.push_back(base / dir_name / ("f" + std::to_string(file) + ".cpp"));
+            paths.push_back(base / ("d" + std::to_string(dir)) / ("g" + std::to_string(file)));
+        }
+    }
+    auto expected = paths;
+    std::sort(expected.begin(), expected.end());
+
+    auto sorted = shuffled(paths);
+    pf::sort_paths(sorted, base);
+    CHECK(sorted == expected);
+
+    pf::task_pool pool{4};
+    sorted = shuffled(paths);
+    pf::sort_paths(sorted, base, &pool);
+    CHECK(sorted == expected);
+
+    // Relative to the empty path
+    sorted = shuffled(paths);
+    pf::sort_paths(sorted, fs::path{}, &pool);
+    CHECK(sorted == expected);
+}
@@ -0,0 +1,81 @@
+#include <pf/fs/glob.hpp>
+#include <pf/fs/path_trie.hpp>
+#include <pf/fs/source_index.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+
+namespace fs = pf::fs;
+
+using strings = std::vector<std::string>;
+
+TEST_CASE("Path trie") {
+    pf::path_trie trie;
+    CHECK(trie.empty());
+    CHECK(trie.insert("src/b.cpp"));
+    CHECK(trie.insert("src/a-b/x.cpp"));
+    CHECK(trie.insert("src/a/y.cpp"));
+    CHECK(trie.insert("//src//a.cpp"));
+    CHECK_FALSE(trie.insert("src/b.cpp"));
+    CHECK_FALSE(trie.insert(""));
+    CHECK(trie.size() == 4);
+
+    CHECK(trie.contains("src/a.cpp"));
+    CHECK_FALSE(trie.contains("src"));
+    CHECK_FALSE(trie.contains("src/c.cpp"));
+
+    // Paths relative to a node, such as a directory being walked
+    auto const dir = trie.find_or_add("src/a");
+    CHECK(trie.insert("z.cpp", dir));
+    CHECK(trie.size() == 5);
+
+    // Ordered as fs::path orders: "a/" sorts first as a component, though not as a string
+    auto const expected = strings{"src/a/y.cpp", "src/a/z.cpp", "src/a-b/x.cpp", "src/a.cpp",
+                                  "src/b.cpp"};
+    CHECK(trie.strings() == expected);
+    std::vector<fs::path> paths(expected.begin(), expected.end());
+    CHECK(std::is_sorted(paths.begin(), paths.end()));
+}
+
+TEST_CASE("Many paths in a trie") {
+    pf::path_trie trie;
+    strings       expected;
+    for (auto dir = 0; dir < 50; ++dir) {
+        for (auto file = 0; file < 100; ++file) {
+            expected.push_back("d" + std::to_string(dir) + "/f" + std::to_string(file) + ".cpp");
+        }
+    }
+    for (auto it = expected.rbegin(); it != expected.rend(); ++it) {
+        CHECK(trie.insert(*it));
+    }
+    std::vector<fs::path> paths(expected.begin(), expected.end());
+    std::sort(paths.begin(), paths.end());
+    std::transform(paths.begin(), paths.end(), expected.begin(), [](auto const& p) {
+        return p.generic_string();
+    });
+    CHECK(trie.strings() == expected);
+}
+
+TEST_CASE("glob sources into a trie") {
+    auto const src_dir = fs::path{PF_TEST_BINDIR} / "existing/sample/project/src";
+    auto const sources = pf::glob_sources(src_dir);
+    strings    expected;
+    for (auto const& source : sources) {
+        expected.push_back(source.lexically_relative(src_dir).generic_string());
+    }
+
+    for (auto jobs : {1u, 3u}) {
+        INFO("jobs: " << jobs);
+        pf::glob_options opts;
+        opts.jobs = jobs;
+        pf::path_trie trie;
+        pf::glob_sources(src_dir, opts, trie);
+        CHECK(trie.strings() == expected);
+
+        pf::source_index index{src_dir.parent_path()};
+        pf::path_trie    indexed;
+        index.glob_sources(src_dir, opts, indexed);
+        CHECK(indexed.strings() == expected);
+    }
+}
@@ -0,0 +1,95 @@
+#include <pf/fs/source_index.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+namespace fs = pf::fs;
+
+namespace {
+
+// Freshly modified directories are never trusted by the index, so age the whole tree
+void backdate_dirs(fs::path const& root) {
+    auto past = fs::file_time_type::clock::now() - std::chrono::hours{1};
+    fs::last_write_time(root, past);
+    for (auto& entry : fs::recursive_directory_iterator{root}) {
+        if (entry.is_directory()) {
+            fs::last_write_time(entry.path(), past);
+        }
+    }
+}
+
+}  // namespace
+
+TEST_CASE("source index") {
+    auto const root = fs::path{PF_TEST_BINDIR} / "_source_index";
+    fs::remove_all(root);
+    fs::create_directories(root / "src/proj/sub");
+    fs::create_directories(root / "src/proj/gone");
+    pf::write_file(root / "src/proj/a.cpp", "");
+    pf::write_file(root / "src/proj/a.txt", "");
+    pf::write_file(root / "src/proj/sub/b.hpp", "");
+    pf::write_file(root / "src/proj/gone/c.cpp", "");
+    backdate_dirs(root);
+
+    auto const src_dir    = root / "src";
+    auto const index_path = pf::source_index::default_path(root);
+
+    auto index = pf::source_index::load(root, index_path);
+    CHECK(index.glob_sources(src_dir) == pf::glob_sources(src_dir));
+    CHECK(index.dirty());
+    CHECK(index.directories_listed() == 4);
+    index.save(index_path);
+
+    SECTION("Nothing changed") {
+        auto reloaded = pf::source_index::load(root, index_path);
+        CHECK(reloaded.glob_sources(src_dir) == pf::glob_sources(src_dir));
+        CHECK_FALSE(reloaded.dirty());
+        CHECK(reloaded.directories_listed() == 0);
+    }
+
+    SECTION("File added") {
+        pf::write_file(root / "src/proj/sub/new.cpp", "");
+        auto reloaded = pf::source_index::load(root, index_path);
+        auto sources  = reloaded.glob_sources(src_dir);
+        CHECK(sources == pf::glob_sources(src_dir));
+        CHECK(std::count(sources.begin(), sources.end(), src_dir / "proj/sub/new.cpp") == 1);
+        CHECK(reloaded.directories_listed() == 1);
+    }
+
+    SECTION("Directory removed") {
+        fs::remove_all(root / "src/proj/gone");
+        auto reloaded = pf::source_index::load(root, index_path);
+        auto sources  = reloaded.glob_sources(src_dir);
+        CHECK(sources == pf::glob_sources(src_dir));
+        CHECK(sources.size() == 2);
+        CHECK(reloaded.dirty());
+    }
+
+    SECTION("Parallel walk") {
+        pf::glob_options opts;
+        opts.jobs     = 4;
+        auto reloaded = pf::source_index::load(root, index_path);
+        CHECK(reloaded.glob_sources(src_dir, opts) == pf::glob_sources(src_dir));
+        CHECK(reloaded.directories_listed() == 0);
+    }
+
+    SECTION("Stat cache") {
+        pf::stat_cache   stats;
+        pf::glob_options opts;
+        opts.stats = &stats;
+        pf::source_index fresh{root};
+        CHECK(fresh.glob_sources(src_dir, opts) == pf::glob_sources(src_dir));
+        // The listing of src/ recorded its subdirectories
+        CHECK(stats.is_directory(src_dir / "proj"));
+        CHECK(stats.syscalls() == 0);
+    }
+
+    SECTION("Corrupt index") {
+        pf::write_file(index_path, "garbage");
+        auto reloaded = pf::source_index::load(root, index_path);
+        CHECK(reloaded.glob_sources(src_dir) == pf::glob_sources(src_dir));
+        CHECK(reloaded.directories_listed() == 4);
+    }
+}
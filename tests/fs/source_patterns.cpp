@@ -0,0 +1,118 @@
+#include <pf/fs/glob.hpp>
+#include <pf/fs/source_patterns.hpp>
+
+#include <catch2/catch.hpp>
+
+namespace fs = pf::fs;
+
+TEST_CASE("Default source patterns") {
+    auto const& patterns = pf::source_patterns::defaults();
+    CHECK(patterns.matches("main.cpp"));
+    CHECK(patterns.matches("project/subfolder/source5.c++"));
+    CHECK(patterns.matches("a/b/c.h"));
+    CHECK_FALSE(patterns.matches("main.cpp.in"));
+    CHECK_FALSE(patterns.matches("CMakeLists.txt"));
+    CHECK_FALSE(patterns.matches("cpp"));
+    CHECK_FALSE(patterns.matches(""));
+
+    // Every directory may hold sources
+    auto const dir = patterns.enter_directory(patterns.start(), "project");
+    CHECK(patterns.can_select_below(dir));
+    CHECK(patterns.selected(patterns.advance(dir, "file.cc")));
+    CHECK_FALSE(patterns.selected(dir));
+}
+
+TEST_CASE("Include and exclude source patterns") {
+    pf::source_patterns const patterns{{
+        "*.cpp",
+        "**/*.cu",
+        "!generated/",
+        "/gpu/*.ptx",
+        "!*_old.cpp",
+        "keep_old.cpp",
+        "mod[0-9].ixx",
+        "[!a-z]?.h",
+    }};
+
+    CHECK(patterns.matches("a.cpp"));
+    CHECK(patterns.matches("x/y/kernel.cu"));
+    CHECK(patterns.matches("kernel.cu"));
+    CHECK_FALSE(patterns.matches("generated/a.cpp"));
+    CHECK_FALSE(patterns.matches("x/generated/kernel.cu"));
+    CHECK(patterns.matches("gpu/kernel.ptx"));
+    CHECK_FALSE(patterns.matches("x/gpu/kernel.ptx"));
+    CHECK_FALSE(patterns.matches("gpu/x/kernel.ptx"));
+    CHECK_FALSE(patterns.matches("lib_old.cpp"));
+    CHECK(patterns.matches("x/keep_old.cpp"));
+    CHECK(patterns.matches("mod7.ixx"));
+    CHECK_FALSE(patterns.matches("modx.ixx"));
+    CHECK(patterns.matches("Ab.h"));
+    CHECK_FALSE(patterns.matches("ab.h"));
+    CHECK_FALSE(patterns.matches("A/.h"));
+
+    // The last glob to match decides, even below an excluded directory
+    CHECK(patterns.matches("generated/keep_old.cpp"));
+    auto const generated = patterns.enter_directory(patterns.start(), "generated");
+    CHECK(patterns.can_select_below(generated));
+}
+
+TEST_CASE("Excluded directories need not be walked") {
+    pf::source_patterns const patterns{{"*.cpp", "!generated/", "!/third_party/"}};
+    auto const                root = patterns.start();
+    CHECK_FALSE(patterns.can_select_below(patterns.enter_directory(root, "generated")));
+    CHECK_FALSE(patterns.can_select_below(patterns.enter_directory(root, "third_party")));
+    CHECK(patterns.can_select_below(patterns.enter_directory(root, "generated_not")));
+
+    auto const sub = patterns.enter_directory(root, "sub");
+    CHECK_FALSE(patterns.can_select_below(patterns.enter_directory(sub, "generated")));
+    CHECK(patterns.can_select_below(patterns.enter_directory(sub, "third_party")));
+}
+
+TEST_CASE("Escapes in source patterns") {
+    pf::source_patterns const patterns{{"\\*.cpp", "[*?].h", "\\!bang.c"}};
+    CHECK(patterns.matches("*.cpp"));
+    CHECK_FALSE(patterns.matches("a.cpp"));
+    CHECK(patterns.matches("?.h"));
+    CHECK_FALSE(patterns.matches("a.h"));
+    CHECK(patterns.matches("!bang.c"));
+}
+
+TEST_CASE("Malformed source patterns") {
+    CHECK_THROWS_AS(pf::source_patterns{{"[abc"}}, std::runtime_error);
+    CHECK_THROWS_AS(pf::source_patterns{{"[z-a]"}}, std::runtime_error);
+    CHECK_THROWS_AS(pf::source_patterns{{"foo\\"}}, std::runtime_error);
+    CHECK_THROWS_AS(pf::source_patterns{{"!"}}, std::runtime_error);
+    CHECK_THROWS_AS(pf::source_patterns{{"/"}}, std::runtime_error);
+}
+
+TEST_CASE("Source patterns fingerprint") {
+    auto const& defaults = pf::source_patterns::defaults();
+    CHECK(pf::source_patterns{defaults.globs()}.fingerprint() == defaults.fingerprint());
+    CHECK(pf::source_patterns{{"ab"}}.fingerprint()
+          != pf::source_patterns{{"a", "b"}}.fingerprint());
+}
+
+TEST_CASE("glob sources with patterns") {
+    auto const dir = fs::path{PF_TEST_BINDIR} / "_glob_patterns";
+    fs::remove_all(dir);
+    pf::write_file(dir / "lib/a.cpp", "");
+    pf::write_file(dir / "lib/kernel.cu", "");
+    pf::write_file(dir / "lib/generated/b.cpp", "");
+    pf::write_file(dir / "lib/sub/generated/c.cpp", "");
+    pf::write_file(dir / "lib/sub/d.hpp", "");
+    pf::write_file(dir / "generated/e.cpp", "");
+    // A directory is never listed, whatever its name
+    fs::create_directories(dir / "lib/dir.cpp");
+
+    pf::source_patterns const patterns{{"*.cpp", "*.hpp", "*.cu", "!generated/"}};
+    for (auto jobs : {1u, 3u}) {
+        INFO("jobs: " << jobs);
+        pf::glob_options opts;
+        opts.jobs     = jobs;
+        opts.patterns = &patterns;
+        CHECK(pf::glob_sources(dir, opts)
+              == std::vector<fs::path>{dir / "lib/a.cpp",
+                                       dir / "lib/kernel.cu",
+                                       dir / "lib/sub/d.hpp"});
+    }
+}
@@ -0,0 +1,104 @@
+#include <pf/fs/source_watcher.hpp>
+
+#include <pf/fs/glob.hpp>
+
+#include <catch2/catch.hpp>
+
+#if defined(__linux__)
+
+namespace fs = pf::fs;
+
+using std::chrono::milliseconds;
+
+TEST_CASE("watch sources") {
+    auto const root = fs::path{PF_TEST_BINDIR} / "_source_watcher";
+    fs::remove_all(root);
+    auto const src_dir = root / "src";
+    pf::write_file(src_dir / "proj/a.cpp", "");
+    pf::write_file(src_dir / "top_level.cpp", "");
+
+    pf::source_watcher watcher{{src_dir}};
+    CHECK(watcher.sources(src_dir) == pf::glob_sources(src_dir));
+    CHECK(watcher.watch_count() == 2);
+
+    auto const wait = [&] {
+        return watcher.wait_for_changes(milliseconds{50}, milliseconds{2000});
+    };
+    auto const changed = std::vector<fs::path>{src_dir};
+
+    pf::write_file(src_dir / "proj/b.hpp", "");
+    CHECK(wait() == changed);
+    CHECK(watcher.sources(src_dir) == pf::glob_sources(src_dir));
+
+    // A burst of changes, including to a new directory tree, is reported at once
+    for (auto i = 0; i < 20; ++i) {
+        pf::write_file(src_dir / "proj/new/deeper" / ("f" + std::to_string(i) + ".cpp"), "");
+    }
+    CHECK(wait() == changed);
+    CHECK(watcher.sources(src_dir) == pf::glob_sources(src_dir));
+    CHECK(watcher.watch_count() == 4);
+
+    fs::rename(src_dir / "proj/new", src_dir / "proj/renamed");
+    CHECK(wait() == changed);
+    CHECK(watcher.sources(src_dir) == pf::glob_sources(src_dir));
+
+    fs::remove_all(src_dir / "proj/renamed");
+    CHECK(wait() == changed);
+    CHECK(watcher.sources(src_dir) == pf::glob_sources(src_dir));
+    CHECK(watcher.watch_count() == 2);
+
+    // Changes that do not affect the sources are not reported
+    pf::write_file(src_dir / "proj/notes.txt", "");
+    pf::write_file(src_dir / "another_top_level.cpp", "");
+    CHECK(watcher.wait_for_changes(milliseconds{50}, milliseconds{200}).empty());
+}
+
+TEST_CASE("watch every file, and narrow the sources") {
+    auto const root = fs::path{PF_TEST_BINDIR} / "_source_watcher_all";
+    fs::remove_all(root);
+    auto const src_dir = root / "src";
+    pf::write_file(src_dir / "proj/a.cpp", "");
+
+    pf::source_watcher watcher{{src_dir}, pf::source_patterns{{"*"}}};
+    pf::write_file(src_dir / "proj/kernel.cu", "");
+    CHECK(watcher.wait_for_changes(milliseconds{50}, milliseconds{2000})
+          == std::vector<fs::path>{src_dir});
+    CHECK(watcher.sources(src_dir)
+          == std::vector<fs::path>{src_dir / "proj/a.cpp", src_dir / "proj/kernel.cu"});
+    CHECK(watcher.sources(src_dir, pf::source_patterns::defaults()) == pf::glob_sources(src_dir));
+}
+
+TEST_CASE("watch sources with ignored directories") {
+    auto const root = fs::path{PF_TEST_BINDIR} / "_source_watcher_ignored";
+    fs::remove_all(root);
+    fs::create_directories(root / ".git");
+    auto const src_dir = root / "src";
+    pf::write_file(src_dir / "proj/a.cpp", "");
+    pf::write_file(src_dir / "proj/gen/b.cpp", "");
+    pf::write_file(src_dir / "proj/_build/CMakeCache.txt", "");
+    pf::write_file(src_dir / "proj/_build/c.cpp", "");
+
+    pf::source_watcher watcher{{src_dir}};
+    CHECK(watcher.sources(src_dir) == pf::glob_sources(src_dir));
+    CHECK(watcher.sources(src_dir).size() == 2);
+
+    auto const wait = [&] {
+        return watcher.wait_for_changes(milliseconds{50}, milliseconds{2000});
+    };
+    auto const changed = std::vector<fs::path>{src_dir};
+
+    pf::write_file(src_dir / "proj/.gitignore", "gen/\n");
+    CHECK(wait() == changed);
+    CHECK(watcher.sources(src_dir) == std::vector<fs::path>{src_dir / "proj/a.cpp"});
+
+    // Nothing in a build directory counts, until it stops being one
+    pf::write_file(src_dir / "proj/_build/d.cpp", "");
+    pf::write_file(src_dir / "proj/gen/e.cpp", "");
+    CHECK(watcher.wait_for_changes(milliseconds{50}, milliseconds{200}).empty());
+    fs::remove(src_dir / "proj/_build/CMakeCache.txt");
+    CHECK(wait() == changed);
+    CHECK(watcher.sources(src_dir) == pf::glob_sources(src_dir));
+    CHECK(watcher.sources(src_dir).size() == 3);
+}
+
+#endif
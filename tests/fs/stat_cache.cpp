@@ -0,0 +1,54 @@
+#include <pf/fs/stat_cache.hpp>
+
+#include <pf/existing/detect_base_dir.hpp>
+
+#include <catch2/catch.hpp>
+
+namespace fs = pf::fs;
+
+TEST_CASE("stat cache") {
+    auto const dir = fs::path{PF_TEST_BINDIR} / "_stat_cache";
+    fs::remove_all(dir);
+    pf::write_file(dir / "file.txt", "");
+
+    pf::stat_cache stats;
+    CHECK(stats.is_directory(dir));
+    CHECK(stats.is_regular_file(dir / "file.txt"));
+    CHECK_FALSE(stats.exists(dir / "missing"));
+    CHECK(stats.syscalls() == 3);
+
+    // Answered from the cache, even though the filesystem has changed
+    pf::write_file(dir / "missing", "");
+    CHECK(stats.exists(dir));
+    CHECK_FALSE(stats.exists(dir / "missing"));
+    CHECK(stats.syscalls() == 3);
+    CHECK(stats.syscalls_avoided() == 2);
+
+    stats.forget(dir / "missing");
+    CHECK(stats.exists(dir / "missing"));
+    CHECK(stats.syscalls() == 4);
+
+    // The modification time is cached separately from the status
+    std::error_code ec;
+    CHECK(stats.last_write_time(dir / "file.txt", ec) == fs::last_write_time(dir / "file.txt"));
+    CHECK_FALSE(ec);
+    CHECK(stats.syscalls() == 5);
+
+    stats.remember(dir / "virtual", fs::file_type::directory);
+    CHECK(stats.is_directory(dir / "virtual"));
+    CHECK(stats.syscalls() == 5);
+}
+
+TEST_CASE("detect base dir with a stat cache") {
+    auto const from = fs::path{PF_TEST_BINDIR} / "existing/sample/project/src";
+
+    pf::stat_cache stats;
+    auto const     found = pf::detect_base_dir(from, stats);
+    CHECK(found == pf::detect_base_dir(from));
+    // The second walk up the tree revisits directories the first one already checked
+    CHECK(stats.syscalls_avoided() > 0);
+
+    auto const syscalls = stats.syscalls();
+    CHECK(pf::detect_base_dir(from, stats) == found);
+    CHECK(stats.syscalls() == syscalls);
+}
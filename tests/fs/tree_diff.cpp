@@ -0,0 +1,66 @@
+#include <pf/fs/tree_diff.hpp>
+
+#include <catch2/catch.hpp>
+
+namespace fs = pf::fs;
+
+using paths = std::vector<fs::path>;
+
+TEST_CASE("Compare a tree with its expected content") {
+    auto const dir = fs::path{PF_TEST_BINDIR} / "_tree_diff";
+    fs::remove_all(dir);
+    pf::write_file(dir / "same.txt", "content");
+    pf::write_file(dir / "sub/same_size.txt", "abc");
+    pf::write_file(dir / "sub/other_size.txt", "abc");
+    pf::write_file(dir / "sub/unexpected.txt", "");
+    pf::write_file(dir / "file_not_dir/file.txt", "");
+    pf::write_file(dir / "skipped/file.txt", "");
+    fs::create_directories(dir / "empty");
+
+    pf::expected_tree expected;
+    expected.directories.push_back("empty");
+    expected.directories.push_back("missing_dir");
+    expected.files["same.txt"]                 = "content";
+    expected.files["sub/same_size.txt"]        = "abd";
+    expected.files["sub/other_size.txt"]       = "abcd";
+    expected.files["sub/deeper/missing.txt"]   = "";
+    expected.files["file_not_dir"]             = "";
+    expected.files["skipped/not_compared.txt"] = "";
+
+    for (auto jobs : {1u, 4u}) {
+        INFO("jobs: " << jobs);
+        pf::tree_diff_options opts;
+        opts.jobs   = jobs;
+        opts.ignore = [](const fs::path& path) { return path == "skipped"; };
+
+        auto const diff = pf::diff_tree(dir, expected, opts);
+        INFO(diff);
+        CHECK(diff.missing_files == paths{"missing_dir", "sub/deeper", "sub/deeper/missing.txt"});
+        CHECK(diff.unexpected_files == paths{"file_not_dir/file.txt", "sub/unexpected.txt"});
+        CHECK(diff.different_files
+              == paths{"file_not_dir", "sub/other_size.txt", "sub/same_size.txt"});
+    }
+
+    // Everything is missing from a tree that does not exist, including what was ignored above
+    auto const diff = pf::diff_tree(dir / "nonexistent", expected);
+    CHECK(diff.missing_files.size() == 11);
+    CHECK(diff.unexpected_files.empty());
+    CHECK(diff.different_files.empty());
+}
+
+TEST_CASE("Compare two trees") {
+    auto const dir = fs::path{PF_TEST_BINDIR} / "_tree_diffs";
+    fs::remove_all(dir);
+    pf::write_file(dir / "a/same.txt", "same");
+    pf::write_file(dir / "a/changed.txt", "one");
+    pf::write_file(dir / "a/added.txt", "");
+    pf::write_file(dir / "b/same.txt", "same");
+    pf::write_file(dir / "b/changed.txt", "two");
+    pf::write_file(dir / "b/removed/file.txt", "");
+
+    auto const diff = pf::diff_trees(dir / "a", dir / "b");
+    CHECK(diff.missing_files == paths{"removed", "removed/file.txt"});
+    CHECK(diff.unexpected_files == paths{"added.txt"});
+    CHECK(diff.different_files == paths{"changed.txt"});
+    CHECK_FALSE(pf::diff_trees(dir / "a", dir / "a"));
+}
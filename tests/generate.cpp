@@ -50,3 +50,32 @@ TEST_CASE("Simple project with CMake") {
     params.build_system = pf::build_system::cmake;
     generate_and_compare(params, "simple-cmake");
 }
+
+TEST_CASE("A freshly generated project has not drifted") {
+    auto params         = make_project_params("drift", "drift");
+    params.build_system = pf::build_system::cmake;
+    auto const dir      = create_test_project(params);
+
+    auto results = pf::diff_projects({params}, 2);
+    REQUIRE(results.size() == 1);
+    CHECK(results[0].error.empty());
+    CHECK_FALSE(results[0].diff);
+
+    // Same size, different content
+    auto source = pf::slurp_file(dir / "src/drift/drift.cpp");
+    source[0]   = source[0] == 'x' ? 'y' : 'x';
+    pf::write_file(dir / "src/drift/drift.cpp", source);
+    pf::write_file(dir / "src/extra.cpp", "");
+    fs::remove(dir / "tests/my_test.cpp");
+
+    results = pf::diff_projects({params}, 2);
+    auto const& diff = results[0].diff;
+    INFO(diff);
+    CHECK(diff.different_files == std::vector<fs::path>{"src/drift/drift.cpp"});
+    CHECK(diff.unexpected_files == std::vector<fs::path>{"src/extra.cpp"});
+    CHECK(diff.missing_files == std::vector<fs::path>{"tests/my_test.cpp"});
+
+    params.directory = params.directory / "missing";
+    results          = pf::diff_projects({params}, 2);
+    CHECK_FALSE(results[0].error.empty());
+}
@@ -0,0 +1,109 @@
+#include <catch2/catch.hpp>
+
+#include <pf/new.hpp>
+
+#include "../compare_fs.hpp"
+
+namespace fs = pf::fs;
+
+TEST_CASE("parse CSV manifest") {
+    auto const base = fs::path{PF_TEST_BINDIR} / "_manifest";
+
+    auto entries = pf::parse_csv_manifest(
+        "name,namespace,directory,tests,build_system\r\n"
+        "plain,,,,\r\n"
+        "\r\n"
+        "custom,\"my::ns\",\"sub/dir, with comma\",no,none\r\n"
+        "\"multi\nline\",,,,\n"
+        ",ns,,,\n"
+        "bad-bool,,,maybe,\n"
+        "too,many,cells,,,\n",
+        base);
+    REQUIRE(entries.size() == 6);
+
+    CHECK(entries[0].row == 2);
+    REQUIRE(entries[0].params);
+    CHECK(entries[0].params->name == "plain");
+    CHECK(entries[0].params->root_namespace == "plain");
+    CHECK(entries[0].params->first_file_stem == "plain");
+    CHECK(entries[0].params->directory == fs::absolute(base / "plain"));
+    CHECK(entries[0].params->create_tests);
+    CHECK(entries[0].params->build_system == pf::build_system::cmake);
+
+    CHECK(entries[1].row == 4);
+    REQUIRE(entries[1].params);
+    CHECK(entries[1].params->root_namespace == "my::ns");
+    CHECK(entries[1].params->directory == fs::absolute(base / "sub/dir, with comma"));
+    CHECK(entries[1].params->first_file_stem == "dir, with comma");
+    CHECK_FALSE(entries[1].params->create_tests);
+    CHECK(entries[1].params->build_system == pf::build_system::none);
+
+    CHECK(entries[2].row == 5);
+    REQUIRE(entries[2].params);
+    CHECK(entries[2].params->name == "multi\nline");
+
+    CHECK(entries[3].row == 7);
+    CHECK_FALSE(entries[3].params);
+    CHECK(entries[4].row == 8);
+    CHECK_FALSE(entries[4].params);
+    CHECK(entries[5].row == 9);
+    CHECK_FALSE(entries[5].params);
+
+    CHECK_THROWS_AS(pf::parse_csv_manifest("name,colour\nfoo,red\n", base), std::runtime_error);
+    CHECK_THROWS_AS(pf::parse_csv_manifest("name\n\"foo\n", base), std::runtime_error);
+}
+
+TEST_CASE("parse JSON manifest") {
+    auto const base = fs::path{PF_TEST_BINDIR} / "_manifest";
+
+    auto entries = pf::parse_json_manifest(R"([
+        {"name": "plain"},
+        {"name": "custom", "split_headers": true, "examples": "no", "first_file": "main"},
+        {"namespace": "no_name"},
+        {"name": "nested", "tests": {"yes": true}},
+        "not an object"
+    ])",
+                                           base);
+    REQUIRE(entries.size() == 5);
+
+    REQUIRE(entries[0].params);
+    CHECK(entries[0].params->name == "plain");
+    REQUIRE(entries[1].params);
+    CHECK(entries[1].params->separate_headers);
+    CHECK_FALSE(entries[1].params->create_examples);
+    CHECK(entries[1].params->first_file_stem == "main");
+    CHECK_FALSE(entries[2].params);
+    CHECK_FALSE(entries[3].params);
+    CHECK(entries[4].row == 5);
+    CHECK_FALSE(entries[4].params);
+
+    CHECK_THROWS_AS(pf::parse_json_manifest(R"({"name": "foo"})", base), std::runtime_error);
+    CHECK_THROWS_AS(pf::parse_json_manifest("[{]", base), std::runtime_error);
+}
+
+TEST_CASE("create projects from a manifest") {
+    auto const base = fs::path{PF_TEST_BINDIR} / "_manifest";
+    fs::remove_all(base);
+    fs::create_directories(base / "exists");
+
+    auto const entries = pf::parse_csv_manifest("name,namespace\n"
+                                                "simple-cmake,simple\n"
+                                                "exists,\n"
+                                                "simple-cmake,other\n",
+                                                base);
+    std::vector<pf::new_project_params> all;
+    for (auto const& entry : entries) {
+        REQUIRE(entry.params);
+        all.push_back(*entry.params);
+    }
+
+    auto const errors = pf::create_projects(all, 2);
+    REQUIRE(errors.size() == 3);
+    CHECK(errors[0].empty());
+    CHECK_FALSE(errors[1].empty());
+    CHECK_FALSE(errors[2].empty());
+
+    auto diff = pf::test::compare_fs_tree(base / "simple-cmake",
+                                          fs::path{PF_TEST_SRCDIR} / "expected/simple-cmake");
+    CHECK_FALSE(diff);
+}
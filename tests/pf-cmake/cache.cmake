@@ -0,0 +1,100 @@
+# Configures a small project that includes Pitchfork.cmake, serving the modules in extras/pf-cmake
+# from a local directory, and checks when the module cache is used rather than the server.
+#
+# Run with -D PF_SOURCE_DIR=<root of this repository> -D WORK_DIR=<scratch directory>
+cmake_minimum_required(VERSION 3.12)
+
+set(version 0.1.0)
+set(server "${WORK_DIR}/server")
+set(mirror "${WORK_DIR}/mirror")
+set(cache "${WORK_DIR}/cache")
+set(project "${WORK_DIR}/project")
+
+file(REMOVE_RECURSE "${WORK_DIR}")
+file(WRITE "${project}/CMakeLists.txt" [[
+cmake_minimum_required(VERSION 3.12)
+project(pf-cmake-cache NONE)
+include(Pitchfork)
+if(NOT COMMAND pf_auto)
+    message(FATAL_ERROR "pf_auto() was not defined")
+endif()
+]])
+
+function(serve dir)
+    file(GLOB modules "${PF_SOURCE_DIR}/extras/pf-cmake/*")
+    file(COPY ${modules} DESTINATION "${dir}/${version}")
+endfunction()
+
+set(run 0)
+# Configure the project in a new build directory, and check whether that succeeds
+function(configure expect)
+    math(EXPR run "${run} + 1")
+    set(run "${run}" PARENT_SCOPE)
+    execute_process(
+        COMMAND "${CMAKE_COMMAND}"
+            -S "${project}"
+            -B "${WORK_DIR}/build-${run}"
+            "-DCMAKE_MODULE_PATH=${PF_SOURCE_DIR}/cmake"
+            "-DPF_VERSION=${version}"
+            "-D_PF_BASEDIR=${cache}"
+            ${ARGN}
+        RESULT_VARIABLE rc
+        OUTPUT_VARIABLE out
+        ERROR_VARIABLE out
+        )
+    if(expect STREQUAL "PASS" AND NOT rc EQUAL 0)
+        message(FATAL_ERROR "Configure #${run} failed:\n${out}")
+    elseif(expect STREQUAL "FAIL" AND rc EQUAL 0)
+        message(FATAL_ERROR "Configure #${run} should have failed:\n${out}")
+    endif()
+endfunction()
+
+function(expect_cached fname)
+    file(SHA256 "${PF_SOURCE_DIR}/extras/pf-cmake/${fname}" expected)
+    file(SHA256 "${cache}/${version}/${fname}" actual)
+    if(NOT actual STREQUAL expected)
+        message(FATAL_ERROR "The cached ${fname} does not match the original")
+    endif()
+endfunction()
+
+# A server given as a plain directory fills the cache
+serve("${server}")
+configure(PASS "-DPF_URL_BASE=${server}")
+expect_cached(manifest.txt)
+expect_cached(entry.cmake)
+expect_cached(auto.cmake)
+
+# Once the cache is valid, the server is not needed at all
+file(REMOVE_RECURSE "${server}")
+configure(PASS "-DPF_URL_BASE=http://localhost:1/pf-cmake")
+
+# A damaged module is fetched again, which fails without a server...
+file(APPEND "${cache}/${version}/auto.cmake" "# damaged\n")
+configure(FAIL "-DPF_URL_BASE=http://localhost:1/pf-cmake")
+
+# ...and is refused if the server has a module other than the one in its manifest
+serve("${server}")
+file(APPEND "${server}/${version}/auto.cmake" "# tampered\n")
+configure(FAIL "-DPF_URL_BASE=file://${server}")
+
+# A mirror is tried first, and repairs the cache
+serve("${mirror}")
+configure(PASS "-DPF_URL_BASE=file://${server}" "-DPF_MIRRORS=file://${mirror}")
+expect_cached(auto.cmake)
+
+# The manifest can be pinned
+configure(FAIL "-DPF_URL_BASE=${mirror}" "-DPF_MANIFEST_SHA256=0000")
+file(SHA256 "${mirror}/${version}/manifest.txt" manifest_hash)
+configure(PASS "-DPF_URL_BASE=${mirror}" "-DPF_MANIFEST_SHA256=${manifest_hash}")
+
+# A local source with another manifest replaces the cache
+file(APPEND "${mirror}/${version}/entry.cmake" "set(PF_CACHE_TEST_CHANGED TRUE)\n")
+file(SHA256 "${mirror}/${version}/entry.cmake" entry_hash)
+file(READ "${mirror}/${version}/manifest.txt" manifest)
+string(REGEX REPLACE "[0-9a-f]+  entry.cmake" "${entry_hash}  entry.cmake" manifest "${manifest}")
+file(WRITE "${mirror}/${version}/manifest.txt" "${manifest}")
+configure(PASS "-DPF_URL_BASE=${mirror}")
+file(SHA256 "${cache}/${version}/entry.cmake" cached_hash)
+if(NOT cached_hash STREQUAL entry_hash)
+    message(FATAL_ERROR "The cache did not follow the changed manifest of a local source")
+endif()
@@ -0,0 +1,194 @@
+#include <pf/serve.hpp>
+
+#include <pf/existing/source_manifest.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <sstream>
+
+namespace fs = pf::fs;
+
+namespace {
+
+constexpr std::string_view SampleCMakeLists = "add_library(lib\n    # sources\n    )\n";
+
+std::string request(std::string_view method, std::string_view params) {
+    return R"({"jsonrpc":"2.0","id":1,"method":")" + std::string{method} + R"(","params":)"
+        + std::string{params} + "}";
+}
+
+std::string result(std::string_view json) {
+    return R"({"jsonrpc":"2.0","id":1,"result":)" + std::string{json} + "}";
+}
+
+}  // namespace
+
+TEST_CASE("rpc framing") {
+    std::stringstream strm;
+    pf::write_rpc_message(strm, R"({"a":1})");
+    pf::write_rpc_message(strm, "");
+    CHECK(strm.str() == "Content-Length: 7\r\n\r\n{\"a\":1}Content-Length: 0\r\n\r\n");
+
+    CHECK(pf::read_rpc_message(strm) == R"({"a":1})");
+    CHECK(pf::read_rpc_message(strm) == "");
+    CHECK(pf::read_rpc_message(strm) == std::nullopt);
+
+    std::istringstream other_headers{
+        "\r\ncontent-type: application/vscode-jsonrpc\r\ncontent-length: 2\r\n\r\n{}"};
+    CHECK(pf::read_rpc_message(other_headers) == "{}");
+
+    std::istringstream truncated{"Content-Length: 10\r\n\r\n{}"};
+    CHECK_THROWS_AS(pf::read_rpc_message(truncated), std::runtime_error);
+    std::istringstream no_length{"Content-Type: foo\r\n\r\n{}"};
+    CHECK_THROWS_AS(pf::read_rpc_message(no_length), std::runtime_error);
+}
+
+TEST_CASE("json quoting") {
+    CHECK(pf::json_quote("plain") == R"("plain")");
+    CHECK(pf::json_quote("a\"b\\c\nd\x01") == R"("a\"b\\c\nd\u0001")");
+    CHECK(pf::json_quote("ünïcode") == "\"ünïcode\"");
+}
+
+TEST_CASE("serve requests") {
+    auto const root = fs::path{PF_TEST_BINDIR} / "_serve";
+    fs::remove_all(root);
+    auto const project = root / "proj";
+    pf::write_file(project / "src/CMakeLists.txt", SampleCMakeLists);
+    pf::write_file(project / "src/proj/a.cpp", "");
+    pf::write_file(root / "build/CMakeCache.txt",
+                   "CMAKE_BUILD_TYPE:STRING=Debug\nCMAKE_HOME_DIRECTORY:INTERNAL=/some/where\n");
+
+    pf::server_options opts;
+    opts.base_dir = project;
+    pf::server server{opts};
+
+    SECTION("query") {
+        auto const build_dir = pf::json_quote((root / "build").string());
+        CHECK(server.handle(request("query",
+                                    R"({"build_dir":)" + build_dir
+                                        + R"(,"ids":["project.root","cache.CMAKE_BUILD_TYPE",)"
+                                          R"("cache.MISSING"]})"))
+              == result(R"({"project.root":)" + pf::json_quote(project.string())
+                        + R"(,"cache.CMAKE_BUILD_TYPE":"Debug","cache.MISSING":null})"));
+
+        pf::write_file(root / "build/CMakeCache.txt", "CMAKE_BUILD_TYPE:STRING=Release\n");
+        CHECK(server.handle(request("query",
+                                    R"({"build_dir":)" + build_dir
+                                        + R"(,"ids":["cache.CMAKE_BUILD_TYPE"]})"))
+              == result(R"({"cache.CMAKE_BUILD_TYPE":"Release"})"));
+    }
+
+    SECTION("update") {
+        auto const cmakelists = project / "src/CMakeLists.txt";
+        auto const expected   = result(R"({"project":)" + pf::json_quote(project.string())
+                                     + R"(,"rewritten":[)" + pf::json_quote(cmakelists.string())
+                                     + "]}");
+        CHECK(server.handle(request("update", "{}")) == expected);
+        CHECK(pf::slurp_file(cmakelists)
+              == "add_library(lib\n    # sources\n    proj/a.cpp\n    )\n");
+        CHECK(server.project_count() == 1);
+
+        // Nothing changed
+        auto const unchanged
+            = result(R"({"project":)" + pf::json_quote(project.string()) + R"(,"rewritten":[]})");
+        CHECK(server.handle(request("update", "{}")) == unchanged);
+
+        pf::write_file(project / "src/proj/b.cpp", "");
+        CHECK(server.handle(request("update", "{}")) == expected);
+        CHECK(pf::slurp_file(cmakelists)
+              == "add_library(lib\n    # sources\n    proj/a.cpp\n    proj/b.cpp\n    )\n");
+
+        // Edits to the CMakeLists.txt are noticed even when the sources are the same
+        pf::write_file(cmakelists, SampleCMakeLists);
+        CHECK(server.handle(request("update", "{}")) == expected);
+    }
+
+    SECTION("new") {
+        auto const directory = pf::json_quote((root / "made").string());
+        auto const params    = R"({"name":"made","tests":false,"directory":)" + directory + "}";
+        CHECK(server.handle(request("new", params))
+              == result(R"({"directory":)" + directory + "}"));
+        CHECK(fs::exists(root / "made/src/made/made.cpp"));
+        CHECK_FALSE(fs::exists(root / "made/tests"));
+
+        // The directory now exists
+        CHECK(server.handle(request("new", params)).find(R"("error":{"code":-32000,)")
+              != std::string::npos);
+    }
+
+    SECTION("errors") {
+        CHECK(server.handle("{").find(R"("id":null,"error":{"code":-32700,)") != std::string::npos);
+        CHECK(server.handle(R"({"id":"x","method":"frobnicate"})")
+              == R"({"jsonrpc":"2.0","id":"x","error":{"code":-32601,)"
+                 R"("message":"Unknown method `frobnicate`"}})");
+        CHECK(server.handle(request("query", R"({"ids":["bogus"]})"))
+                  .find(R"("code":-32602,)")
+              != std::string::npos);
+        CHECK(server.handle(request("new", R"({"nom":"x"})")).find(R"("code":-32602,)")
+              != std::string::npos);
+        // Ids are echoed back as they came, including their type
+        auto const shutdown_with_id = [&](std::string_view id) {
+            return server.handle(R"({"method":"shutdown","params":{"id":1},"id":)"
+                                 + std::string{id} + "}");
+        };
+        CHECK(shutdown_with_id(R"("7")") == R"({"jsonrpc":"2.0","id":"7","result":null})");
+        CHECK(shutdown_with_id("7") == R"({"jsonrpc":"2.0","id":7,"result":null})");
+        CHECK(shutdown_with_id("-1.5e3") == R"({"jsonrpc":"2.0","id":-1.5e3,"result":null})");
+        CHECK(shutdown_with_id(R"("null")") == R"({"jsonrpc":"2.0","id":"null","result":null})");
+        CHECK(shutdown_with_id(R"( "a\"b" )") == R"({"jsonrpc":"2.0","id":"a\"b","result":null})");
+        CHECK(shutdown_with_id(R"({"x":1})").find(R"("id":null,"error":{"code":-32600,)")
+              != std::string::npos);
+        // Notifications get no response, even when they fail
+        CHECK(server.handle(R"({"method":"frobnicate"})").empty());
+    }
+
+    SECTION("run") {
+        std::stringstream in;
+        pf::write_rpc_message(in, request("query", R"({"ids":["project.root"]})"));
+        pf::write_rpc_message(in, R"({"id":2,"method":"shutdown"})");
+        pf::write_rpc_message(in, request("query", R"({"ids":["project.root"]})"));
+
+        std::stringstream out;
+        server.run(in, out);
+        CHECK(server.done());
+        CHECK(pf::read_rpc_message(out)
+              == result(R"({"project.root":)" + pf::json_quote(project.string()) + "}"));
+        CHECK(pf::read_rpc_message(out) == R"({"jsonrpc":"2.0","id":2,"result":null})");
+        // Nothing is read after the shutdown
+        CHECK(pf::read_rpc_message(out) == std::nullopt);
+    }
+}
+
+TEST_CASE("serve updates to a project built with pf_auto") {
+    auto const root = fs::path{PF_TEST_BINDIR} / "_serve_pf_auto";
+    fs::remove_all(root);
+    // No src/CMakeLists.txt: The sources are only listed in the manifest
+    pf::write_file(root / "CMakeLists.txt", "project(app)\ninclude(Pitchfork)\npf_auto()\n");
+    pf::write_file(root / "src/app/a.cpp", "");
+    pf::write_file(root / "include/app/a.hpp", "");
+
+    pf::server_options opts;
+    opts.base_dir = root;
+    pf::server server{opts};
+
+    auto const manifest = pf::source_manifest::path(root);
+    auto const expected = result(R"({"project":)" + pf::json_quote(root.string())
+                                 + R"(,"rewritten":[)" + pf::json_quote(manifest.string()) + "]}");
+    CHECK(server.handle(request("update", "{}")) == expected);
+    CHECK(pf::slurp_file(manifest).find("    [[src/app/a.cpp]]\n    [[include/app/a.hpp]]\n")
+          != std::string::npos);
+
+    auto const unchanged
+        = result(R"({"project":)" + pf::json_quote(root.string()) + R"(,"rewritten":[]})");
+    CHECK(server.handle(request("update", "{}")) == unchanged);
+
+    // Files of any kind reach the manifest, wherever they are added
+    pf::write_file(root / "src/app/kernel.cu", "");
+    CHECK(server.handle(request("update", "{}")) == expected);
+    pf::write_file(root / "include/app/b.inl", "");
+    CHECK(server.handle(request("update", "{}")) == expected);
+    CHECK(pf::slurp_file(manifest).find("    [[src/app/a.cpp]]\n    [[src/app/kernel.cu]]\n"
+                                        "    [[include/app/a.hpp]]\n    [[include/app/b.inl]]\n")
+          != std::string::npos);
+    CHECK_FALSE(fs::exists(root / "src/CMakeLists.txt"));
+}
@@ -0,0 +1,78 @@
+#include <pf/util/trace.hpp>
+
+#include <pf/fs/glob.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <optional>
+#include <sstream>
+
+namespace fs = pf::fs;
+namespace pt = boost::property_tree;
+
+namespace {
+
+pt::ptree write_trace() {
+    std::stringstream out;
+    pf::trace::write_json(out);
+    pt::ptree tree;
+    pt::read_json(out, tree);
+    return tree;
+}
+
+// Find the complete ("X") event with the given name
+std::optional<pt::ptree> find_span(pt::ptree const& trace, std::string const& name) {
+    for (auto const& [key, event] : trace.get_child("traceEvents")) {
+        if (event.get<std::string>("ph") == "X" && event.get<std::string>("name") == name) {
+            return event;
+        }
+    }
+    return std::nullopt;
+}
+
+}  // namespace
+
+TEST_CASE("Nothing is traced until tracing starts") {
+    CHECK_FALSE(pf::trace::enabled());
+    {
+        pf::trace::span span{"untraced"};
+        pf::trace::add(pf::trace::counter::bytes_read, 10);
+    }
+    pf::trace::start();
+    CHECK(pf::trace::enabled());
+    auto const trace = ::write_trace();
+    CHECK_FALSE(pf::trace::enabled());
+    CHECK_FALSE(::find_span(trace, "untraced"));
+}
+
+TEST_CASE("Spans record their detail and counters") {
+    auto const dir = fs::path{PF_TEST_BINDIR} / "_trace";
+    fs::remove_all(dir);
+    pf::write_file(dir / "src/a/one.cpp", "");
+    pf::write_file(dir / "src/a/b/two.hpp", "");
+    pf::write_file(dir / "src/README.md", "");
+
+    pf::trace::start();
+    {
+        pf::trace::span span{"outer", std::string{"with \"quotes\""}};
+        pf::write_file(dir / "written.txt", "12345", pf::write_mode::overwrite);
+        CHECK(pf::glob_sources(dir / "src").size() == 2);
+    }
+    auto const trace = ::write_trace();
+
+    auto const outer = ::find_span(trace, "outer");
+    REQUIRE(outer);
+    CHECK(outer->get<std::string>("args.detail") == "with \"quotes\"");
+    CHECK(outer->get<int>("args.bytes_written") == 5);
+    // src/, src/a/, and src/a/b/, which hold five entries between them
+    CHECK(outer->get<int>("args.directories_visited") == 3);
+    CHECK(outer->get<int>("args.entries_examined") == 5);
+
+    auto const glob = ::find_span(trace, "glob_sources");
+    REQUIRE(glob);
+    CHECK(glob->get<std::string>("args.detail") == (dir / "src").string());
+    CHECK(outer->get<double>("dur") >= glob->get<double>("dur"));
+}